@@ -18,6 +18,7 @@
 
 #include "psfproperty.hpp"
 #include "psftypes.hpp"
+#include "psfstats.hpp"
 
 namespace psf {
 
@@ -30,6 +31,99 @@ namespace psf {
     static constexpr uint32_t TRACE_START = 3;
     static constexpr uint32_t VALUE_START = 4;
 
+    // default number of sweep points buffered per trace before writing to HDF5.
+    static constexpr uint32_t DEFAULT_BLOCK_POINTS = 65536;
+    // default upper bound on the memory used by value buffers, in bytes.
+    static constexpr size_t DEFAULT_BUFFER_BYTES = 64 * 1024 * 1024;
+    // default number of value blocks in flight when decoding and writing are pipelined.
+    static constexpr uint32_t DEFAULT_PIPELINE_DEPTH = 2;
+    // HDF5 limits the size of one chunk to 4 GB.
+    static constexpr hsize_t MAX_CHUNK_BYTES = 0xffffffffu;
+    // number of chunk cache hash slots used with a user specified chunk cache size.
+    static constexpr size_t CHUNK_CACHE_SLOTS = 10007;
+    // name of the dataset holding the number of valid points in each row of 2-D value datasets.
+    static constexpr const char * ROW_POINTS_NAME = "__num_points__";
+    // name of the group holding interned properties, and of the attribute that
+    // references the interned properties of a dataset.
+    static constexpr const char * SHARED_PROPS_NAME = "__properties__";
+    // name of the group holding the value tables of a non-sweep file.
+    static constexpr const char * TABLES_NAME = "__tables__";
+    // name of the group holding the trace matrices of a flat sweep.
+    static constexpr const char * MATRICES_NAME = "__matrices__";
+
+    // options that control how a PSF file is converted to HDF5.
+    class ConvertOptions {
+    public:
+        ConvertOptions() : m_block_points(DEFAULT_BLOCK_POINTS), m_buffer_bytes(DEFAULT_BUFFER_BYTES),
+            m_window_batch(0), m_pipeline(true), m_pipeline_depth(DEFAULT_PIPELINE_DEPTH),
+            m_chunk_points(0), m_deflate_level(-1), m_shuffle(false), m_fletcher32(false),
+            m_filter_id(0), m_chunk_cache_bytes(0), m_regex(false), m_value_tables(false),
+            m_trace_matrix(false), m_intern_properties(false) {}
+        ~ConvertOptions() {}
+
+        /**
+         * Returns the number of sweep points to buffer per block, given the
+         * number of bytes one sweep point occupies across all traces.
+         */
+        uint32_t get_block_points(size_t point_size, uint64_t num_points) const;
+
+        /**
+         * Returns the number of PSF windows to gather per trace before writing
+         * to HDF5, given the size of one sweep point and the points per window.
+         * A batch holds at most 2^32 - 1 points, even with m_window_batch set.
+         */
+        uint32_t get_window_batch(size_t point_size, uint64_t num_points, uint32_t np_window) const;
+
+        // returns the number of value blocks that are in memory at the same time.
+        uint32_t get_pipeline_blocks() const;
+
+        // maximum number of sweep points decoded before flushing to HDF5.
+        uint32_t m_block_points;
+        // memory budget for value buffers.  The block size is reduced to fit.
+        size_t m_buffer_bytes;
+        // number of PSF windows written per HDF5 write.  0 sizes it from the block
+        // size and memory budget.
+        uint32_t m_window_batch;
+        // if true, HDF5 writes run on a dedicated writer thread while the next block is decoded.
+        bool m_pipeline;
+        // number of value blocks in flight when pipelined (at least 2).  The memory
+        // budget is shared among them.
+        uint32_t m_pipeline_depth;
+        // chunk size of sweep value datasets in points.  0 uses the number of points
+        // written per block.  Datasets are contiguous unless this or a filter is set.
+        hsize_t m_chunk_points;
+        // deflate (gzip) compression level 0-9 of value datasets, or -1 to disable.
+        int m_deflate_level;
+        // apply the shuffle filter to value datasets.
+        bool m_shuffle;
+        // add fletcher32 checksums to value dataset chunks.
+        bool m_fletcher32;
+        // id of an extra registered HDF5 filter for value datasets (for example 32001
+        // for Blosc), or 0 for none.
+        unsigned int m_filter_id;
+        // client data values passed to the extra filter.
+        std::vector<unsigned int> m_filter_params;
+        // size of the HDF5 raw data chunk cache in bytes, or 0 for the HDF5 default.
+        size_t m_chunk_cache_bytes;
+        // patterns of the trace names to convert.  Empty converts all traces.
+        // Sweep variables are always converted.
+        std::vector<std::string> m_include;
+        // patterns of the trace names not to convert.
+        std::vector<std::string> m_exclude;
+        // if true, patterns are regular expressions instead of globs.
+        bool m_regex;
+        // if true, the values of a non-sweep file are written as one table per
+        // type (see ValueTable) instead of one dataset per value.
+        bool m_value_tables;
+        // if true, the traces of a flat sweep are written as one 2-D [trace, point]
+        // dataset per type (see create_matrix_datasets()) instead of one dataset
+        // per trace.
+        bool m_trace_matrix;
+        // if true, each distinct set of dataset properties is written once, and
+        // datasets reference it (see SharedProps) instead of holding attributes.
+        bool m_intern_properties;
+    };
+
     // a value in a non-sweep simulation result.
     class NonSweepValue {
     public:
@@ -49,11 +143,36 @@ namespace psf {
         PropDict m_prop_dict;
     };
 
+    /**
+     * Convert a PSF file to HDF5 after configuring the loggers.  If stats is
+     * not null, it is filled with statistics of the conversion.
+     */
     void read_psf(const std::string& psf_filename, const std::string& hdf5_filename,
-        bool print_msg = false);
+        bool print_msg = false, const ConvertOptions & opts = ConvertOptions(), ConvertStats * stats = nullptr);
 
+    /**
+     * Same as above, but trace messages also go to log_filename, unless it is
+     * empty.  Each call logs to its own logger, so concurrent calls do not
+     * interfere.
+     */
     void read_psf(const std::string& psf_filename, const std::string& hdf5_filename,
-        const std::string& log_filename, bool print_msg = false);
+        const std::string& log_filename, bool print_msg = false,
+        const ConvertOptions & opts = ConvertOptions(), ConvertStats * stats = nullptr);
+
+    /**
+     * Configure the default logger, which receives the trace messages of
+     * conversions that do not log to their own sink, e.g. convert_psf().  An
+     * empty log_filename disables the log file.  Other loggers are left alone.
+     */
+    void configure_logging(const std::string& log_filename, bool print_msg);
+
+    /**
+     * Convert a PSF file to HDF5 without touching the logger configuration.
+     * Safe to call from several threads at once; HDF5 calls are serialized.
+     * If stats is not null, it is filled with statistics of the conversion.
+     */
+    void convert_psf(const std::string& psf_filename, const std::string& hdf5_filename,
+        const ConvertOptions & opts = ConvertOptions(), ConvertStats * stats = nullptr);
 }
 
 #endif
@@ -0,0 +1,124 @@
+#ifndef LIBPSF_ASCII_H_
+#define LIBPSF_ASCII_H_
+
+/**
+ *  This header file define the reader of ASCII PSF files.
+ */
+
+#include <complex>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "psf.hpp"
+
+namespace psf {
+
+    // a type defined in the TYPE section of an ASCII PSF file.
+    class AsciiType {
+    public:
+        enum kind {FLOAT, INT, COMPLEX, STRING, STRUCT};
+
+        AsciiType() : m_kind(kind::FLOAT), m_is_array(false) {}
+        ~AsciiType() {}
+
+        // returns the size of one value in memory, or 0 if values are not numbers.
+        size_t get_value_size() const;
+
+        std::string m_name;
+        AsciiType::kind m_kind;
+        bool m_is_array;
+        // members of a struct.
+        std::vector<AsciiType> m_members;
+        PropDict m_prop_dict;
+    };
+
+    // a value of an ASCII PSF file.
+    class AsciiValue {
+    public:
+        enum kind {DOUBLE, INT, COMPLEX, STRING, LIST};
+
+        AsciiValue() : m_kind(kind::DOUBLE), m_dval(0.0), m_ival(0) {}
+        ~AsciiValue() {}
+
+        AsciiValue::kind m_kind;
+        double m_dval;
+        int32_t m_ival;
+        std::complex<double> m_cval;
+        std::string m_sval;
+        // elements of an array, or members of a struct.
+        std::vector<AsciiValue> m_items;
+    };
+
+    // a sweep variable, trace or value of an ASCII PSF file.
+    class AsciiVar {
+    public:
+        AsciiVar() {}
+        ~AsciiVar() {}
+
+        std::string m_name;
+        std::string m_type_name;
+        PropDict m_prop_dict;
+        // the value of a non-sweep file.
+        AsciiValue m_value;
+    };
+
+    // the contents of an ASCII PSF file.
+    class AsciiPsf {
+    public:
+        AsciiPsf() : m_num_points(0) {}
+        ~AsciiPsf() {}
+
+        // returns the type with the given name.
+        const AsciiType & get_type(const std::string & type_name) const;
+
+        PropDict m_prop_dict;
+        std::vector<AsciiType> m_types;
+        std::vector<AsciiVar> m_sweeps;
+        // traces, with groups expanded.
+        std::vector<AsciiVar> m_traces;
+        // values of a non-sweep file.
+        std::vector<AsciiVar> m_values;
+        // number of sweep points.
+        uint64_t m_num_points;
+        // values of each sweep variable, then each trace, in native layout.
+        std::vector<std::vector<char>> m_columns;
+    };
+
+    /**
+     * Parse a decimal floating point number that spans [begin, end).  Numbers
+     * with at most 19 significant digits and a small exponent are converted
+     * exactly with one multiplication or division (Clinger's fast path); others
+     * fall back to strtod().  Returns false if the text is not a number.
+     */
+    bool parse_double(const char * begin, const char * end, double & ans);
+
+    // returns true if the file starts with an ASCII PSF header.
+    bool is_ascii_psf(const std::string & filename);
+
+    /**
+     * Read an ASCII PSF file into memory.  Single sweeps with number, integer
+     * or complex sweep variables and traces are supported.
+     */
+    std::unique_ptr<AsciiPsf> read_psf_ascii(const std::string & psf_filename);
+
+    /**
+     * Read the header, type, sweep and trace sections of an ASCII PSF file,
+     * and count the sweep points by tokenizing the values, without
+     * converting numbers.
+     */
+    std::unique_ptr<AsciiPsf> scan_psf_ascii(const std::string & psf_filename);
+
+    /**
+     * Convert an ASCII PSF file to HDF5, with the same layout as binary PSF
+     * files.  Sweep values are written while the file is parsed.  Values of
+     * non-sweep files that hold strings or arrays have no HDF5 equivalent in
+     * that layout, and are skipped.  If stats is not null, it is filled with
+     * statistics of the conversion, except section bytes.
+     */
+    void convert_psf_ascii(const std::string & psf_filename, const std::string & hdf5_filename,
+        const ConvertOptions & opts = ConvertOptions(), ConvertStats * stats = nullptr);
+
+}
+
+#endif
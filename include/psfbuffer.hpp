@@ -0,0 +1,110 @@
+#ifndef LIBPSF_BUFFER_H_
+#define LIBPSF_BUFFER_H_
+
+/**
+ *  This header file define the encoder of binary PSF words, the inverse of
+ *  the decoders in psfcommon.hpp.
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "psfcommon.hpp"
+#include "psfproperty.hpp"
+
+namespace psf {
+
+    static constexpr uint32_t STRING_PROP_CODE = 33;
+    static constexpr uint32_t INT_PROP_CODE = 34;
+    static constexpr uint32_t DOUBLE_PROP_CODE = 35;
+
+    // a byte buffer that encodes PSF words in big-endian order.
+    class PsfBuffer {
+    public:
+        PsfBuffer() {}
+        ~PsfBuffer() {}
+
+        size_t size() const { return m_data.size(); }
+
+        void put_uint32(uint32_t val) {
+            char buf[WORD_SIZE];
+            for (int idx = 0; idx < WORD_SIZE; ++idx) {
+                buf[idx] = static_cast<char>((val >> (8 * (WORD_SIZE - 1 - idx))) & 0xff);
+            }
+            m_data.insert(m_data.end(), buf, buf + WORD_SIZE);
+        }
+
+        // 64-bit values are two words, high word first.
+        void put_uint64(uint64_t val) {
+            put_uint32(static_cast<uint32_t>(val >> 32));
+            put_uint32(static_cast<uint32_t>(val & 0xffffffffu));
+        }
+
+        void put_double(double val) {
+            uint64_t bits;
+            memcpy(&bits, &val, sizeof(bits));
+            put_uint64(bits);
+        }
+
+        // strings are stored as a length word, then the characters padded to a whole word.
+        void put_str(const std::string & val) {
+            put_uint32(static_cast<uint32_t>(val.size()));
+            m_data.insert(m_data.end(), val.begin(), val.end());
+            m_data.resize(m_data.size() + (((val.size() + 3) & ~static_cast<size_t>(3)) - val.size()), 0);
+        }
+
+        void put_prop(const std::string & name, const std::string & val) {
+            put_uint32(STRING_PROP_CODE);
+            put_str(name);
+            put_str(val);
+        }
+
+        void put_prop(const std::string & name, int32_t val) {
+            put_uint32(INT_PROP_CODE);
+            put_str(name);
+            put_uint32(static_cast<uint32_t>(val));
+        }
+
+        void put_prop(const std::string & name, double val) {
+            put_uint32(DOUBLE_PROP_CODE);
+            put_str(name);
+            put_double(val);
+        }
+
+        // write the properties of prop_dict, as PropDict::read() reads them.
+        void put_props(const PropDict & prop_dict) {
+            for (auto itp = prop_dict.begin(); itp != prop_dict.end(); ++itp) {
+                const Property & prop = itp->second;
+                switch (prop.m_type) {
+                case Property::type::INT:
+                    put_prop(prop.m_name, static_cast<int32_t>(prop.m_ival));
+                    break;
+                case Property::type::DOUBLE:
+                    put_prop(prop.m_name, prop.m_dval);
+                    break;
+                default:
+                    put_prop(prop.m_name, prop.m_sval);
+                }
+            }
+        }
+
+        void put_zeros(size_t num) {
+            m_data.resize(m_data.size() + num, 0);
+        }
+
+        // overwrite the word at pos.
+        void set_uint32(size_t pos, uint32_t val) {
+            for (int idx = 0; idx < WORD_SIZE; ++idx) {
+                m_data[pos + idx] = static_cast<char>((val >> (8 * (WORD_SIZE - 1 - idx))) & 0xff);
+            }
+        }
+
+        void clear() { m_data.clear(); }
+
+        std::vector<char> m_data;
+    };
+
+}
+
+#endif
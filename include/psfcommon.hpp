@@ -14,7 +14,9 @@
 #include <fstream>
 #include <iostream>
 
-#include "easylogging++.h"
+#include "psflog.hpp"
+
+#include "psfcursor.hpp"
 
 
 namespace psf {
@@ -23,9 +25,8 @@ namespace psf {
     static constexpr int32_t WORD_SIZE = sizeof(uint32_t);
     static constexpr int32_t BYTE_SIZE = sizeof(uint8_t);
 
-    inline uint32_t read_uint32(std::ifstream& data) {
-        char buf[WORD_SIZE];
-        data.read(buf, WORD_SIZE);
+    inline uint32_t read_uint32(ByteCursor & data) {
+        const char * buf = data.read(WORD_SIZE);
         // convert from BE to LE
         return uint32_t((uint32_t(buf[0] & 255) << 24) |
             (uint32_t(buf[1] & 255) << 16) |
@@ -33,24 +34,28 @@ namespace psf {
             (uint32_t(buf[3] & 255)));
     }
 
-    inline void undo_read_uint32(std::ifstream & data) {
-        data.seekg(-WORD_SIZE, std::ios::cur);
+    inline void undo_read_uint32(ByteCursor & data) {
+        data.unread(WORD_SIZE);
     }
 
-    inline int32_t read_int32(std::ifstream & data) {
+    inline int32_t read_int32(ByteCursor & data) {
         return static_cast<int32_t>(read_uint32(data));
     }
 
-    inline int8_t read_int8(std::ifstream & data) {
-        char buf[WORD_SIZE];
-        data.read(buf, WORD_SIZE);
-        uint8_t ans = *(reinterpret_cast<uint8_t*>(buf + WORD_SIZE - BYTE_SIZE));
+    // 64-bit values are two words, high word first.
+    inline uint64_t read_uint64(ByteCursor & data) {
+        uint64_t high = read_uint32(data);
+        return (high << 32) | read_uint32(data);
+    }
+
+    inline int8_t read_int8(ByteCursor & data) {
+        const char * buf = data.read(WORD_SIZE);
+        uint8_t ans = *(reinterpret_cast<const uint8_t*>(buf + WORD_SIZE - BYTE_SIZE));
         return static_cast<int8_t>(ans);
     }
 
-    inline double read_double(std::ifstream & data) {
-        char buf[DOUB_SIZE];
-        data.read(buf, DOUB_SIZE);
+    inline double read_double(ByteCursor & data) {
+        const char * buf = data.read(DOUB_SIZE);
         // convert from BE to LE
         uint64_t val = uint64_t((uint64_t((buf[0] & 255)) << 56) +
             (uint64_t(buf[1] & 255) << 48) +
@@ -66,24 +71,13 @@ namespace psf {
         return ans;
     }
 
-    inline std::string read_str(std::ifstream & data) {
-        uint32_t len = read_int32(data);
+    inline std::string read_str(ByteCursor & data) {
+        uint32_t len = read_uint32(data);
         // number of extra bytes to read to word-align the string length.
         uint32_t extras = ((len + 3) & ~0x00000003) - len;
-        constexpr uint32_t buf_size = 100;
-        char buf[buf_size];
-        data.read(buf, std::min(len, buf_size));
-        uint32_t num_read = static_cast<uint32_t>(data.gcount());
-        std::string ans(buf, num_read);
-        len -= num_read;
-        while (len > 0) {
-            data.read(buf, std::min(len, buf_size));
-            num_read = static_cast<uint32_t>(data.gcount());
-            ans.append(buf, num_read);
-            len -= num_read;
-        }
+        std::string ans(data.read(len), len);
         // finish reading up to round len
-        data.read(buf, extras);
+        data.skip(extras);
         return ans;
     }
 
@@ -0,0 +1,103 @@
+#ifndef LIBPSF_CURSOR_H_
+#define LIBPSF_CURSOR_H_
+
+/**
+ *  This header file define the byte cursor used to read PSF files.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+
+namespace psf {
+
+    /**
+     * A forward read cursor over the bytes of a PSF file.
+     *
+     * Regular files are memory-mapped, so every read is pointer arithmetic and
+     * the returned pointers stay valid for the lifetime of the cursor.  Inputs
+     * that cannot be mapped (pipes, FIFOs) fall back to a buffered stream, in
+     * which case returned pointers are only valid until the next read or skip.
+     */
+    class ByteCursor {
+    public:
+        // default buffer size of the stream fallback.
+        static constexpr size_t STREAM_BUFFER_SIZE = 1 << 20;
+        // number of bytes kept behind the cursor in stream mode, so unread() works.
+        static constexpr size_t STREAM_KEEP_SIZE = 64;
+
+        explicit ByteCursor(const std::string & filename);
+        ~ByteCursor();
+
+        ByteCursor(const ByteCursor &) = delete;
+        ByteCursor & operator=(const ByteCursor &) = delete;
+
+        // true if the file was opened successfully.
+        bool good() const { return m_good; }
+
+        // true if the file is memory-mapped.
+        bool is_mapped() const { return m_map != nullptr; }
+
+        // returns a pointer to the next num bytes, and advance the cursor past them.
+        inline const char * read(size_t num) {
+            if (m_map != nullptr) {
+                if (num > m_size - m_pos) {
+                    throw_eof(num);
+                }
+                const char * ans = m_map + m_pos;
+                m_pos += num;
+                return ans;
+            }
+            return read_stream(num);
+        }
+
+        // copy the next num bytes into buf.
+        inline void read(char * buf, size_t num) {
+            memcpy(buf, read(num), num);
+        }
+
+        // advance the cursor by num bytes without decoding them.
+        void skip(uint64_t num);
+
+        // move the cursor back by num bytes.
+        void unread(size_t num);
+
+        // move the cursor to file position pos.
+        void seek(uint64_t pos);
+
+        // returns the current file position.
+        uint64_t tell() const { return m_pos; }
+
+        // returns the file size, or 0 if unknown (stream input).
+        uint64_t size() const { return m_size; }
+
+        // release the file mapping or stream.
+        void close();
+
+    private:
+        const char * read_stream(size_t num);
+        [[noreturn]] void throw_eof(size_t num) const;
+
+        bool m_good;
+        uint64_t m_pos;
+        uint64_t m_size;
+
+        // memory-mapped input.
+        const char * m_map;
+#ifdef _WIN32
+        void * m_file_handle;
+        void * m_map_handle;
+#endif
+
+        // buffered stream fallback.  m_buf holds file bytes starting at m_buf_start.
+        std::ifstream m_stream;
+        std::vector<char> m_buf;
+        uint64_t m_buf_start;
+        size_t m_buf_len;
+    };
+
+}
+
+#endif
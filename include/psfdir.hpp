@@ -0,0 +1,93 @@
+#ifndef LIBPSF_DIR_H_
+#define LIBPSF_DIR_H_
+
+/**
+ *  This header file define functions that convert all PSF files under a directory.
+ */
+
+#include <string>
+#include <vector>
+
+#include "psf.hpp"
+
+namespace psf {
+
+    // options that control how a directory of PSF files is converted.
+    class DirOptions {
+    public:
+        DirOptions() : m_num_threads(0), m_job_memory_bytes(0) {}
+        ~DirOptions() {}
+
+        /**
+         * Returns the options used to convert one file, with the value buffer
+         * budget m_buffer_bytes, which all blocks in flight share, capped at
+         * m_job_memory_bytes.
+         */
+        ConvertOptions get_job_options() const;
+
+        // options used to convert each file.
+        ConvertOptions m_convert;
+        // number of files converted concurrently.  0 uses the number of hardware threads.
+        unsigned int m_num_threads;
+        // upper bound on the value buffer memory of one conversion, in bytes.  0 means no cap.
+        size_t m_job_memory_bytes;
+    };
+
+    // the outcome of converting one file.
+    class DirResult {
+    public:
+        DirResult() : m_ok(false) {}
+        ~DirResult() {}
+
+        std::string m_psf_filename;
+        std::string m_hdf5_filename;
+        bool m_ok;
+        std::string m_error;
+        // statistics of the conversion, as far as it got.
+        ConvertStats m_stats;
+    };
+
+    /**
+     * Returns true if the file starts with a binary PSF header.
+     */
+    bool is_binary_psf(const std::string & filename);
+
+    /**
+     * Create dir_name and all missing parent directories.
+     */
+    void make_dirs(const std::string & dir_name);
+
+    /**
+     * Returns the paths of all binary PSF files under dir_name, relative to
+     * dir_name with '/' separators, in sorted order.
+     */
+    std::vector<std::string> find_psf_files(const std::string & dir_name);
+
+    /**
+     * Returns the HDF5 file name for the PSF file at rel_name.  The output
+     * tree mirrors the input tree under out_dir, so names never collide
+     * and do not depend on the order files are converted in.
+     */
+    std::string get_hdf5_filename(const std::string & rel_name, const std::string & out_dir);
+
+    /**
+     * Returns the paths of the file rel_name in every run directory of a
+     * parametric sweep, i.e. run_dir/<run>/rel_name.  Runs are sorted by
+     * number when the run directory names are numbers, as ADE names them.
+     */
+    std::vector<std::string> find_param_runs(const std::string & run_dir, const std::string & rel_name);
+
+    /**
+     * Convert all binary PSF files under in_dir to HDF5 files under out_dir,
+     * several files at a time.  Missing output directories are created.
+     *
+     * Errors in one file do not stop the others; they are reported in the
+     * result of that file.  Results are sorted by PSF file name.  Messages
+     * go to the default logger; call configure_logging() first if needed.
+     */
+    std::vector<DirResult> convert_psf_dir(const std::string & in_dir, const std::string & out_dir,
+        const DirOptions & opts = DirOptions());
+
+}
+
+#endif
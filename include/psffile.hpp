@@ -0,0 +1,184 @@
+#ifndef LIBPSF_FILE_H_
+#define LIBPSF_FILE_H_
+
+/**
+ *  This header file define the in-process PSF file reader, which returns values without HDF5.
+ */
+
+#include <complex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "psf.hpp"
+#include "psfcursor.hpp"
+
+namespace psf {
+
+    class PsfIndex;
+    class PsfSections;
+
+    /**
+     * A read-only view of size contiguous values of type T.  Does not own the values.
+     */
+    template <typename T>
+    class Span {
+    public:
+        Span() : m_data(nullptr), m_size(0) {}
+        Span(const T * data, size_t size) : m_data(data), m_size(size) {}
+        ~Span() {}
+
+        const T * data() const { return m_data; }
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        const T & operator[](size_t idx) const { return m_data[idx]; }
+        const T * begin() const { return m_data; }
+        const T * end() const { return m_data + m_size; }
+
+    private:
+        const T * m_data;
+        size_t m_size;
+    };
+
+    // a range of sweep points, m_size points from m_first.
+    class PointRange {
+    public:
+        PointRange() : m_first(0), m_size(0) {}
+        PointRange(uint64_t first, uint64_t size) : m_first(first), m_size(size) {}
+        ~PointRange() {}
+
+        uint64_t m_first;
+        uint64_t m_size;
+    };
+
+    /**
+     * Reads a PSF file in memory.
+     *
+     * The header, type, sweep and trace sections are read when the file is
+     * opened.  Values of a signal are only decoded the first time they are
+     * requested, straight from the memory-mapped file into a buffer owned by
+     * the PsfFile.  Spans stay valid until the signal is released or the
+     * PsfFile is destroyed.
+     *
+     * Signals are the sweep variables and traces of a sweep file, or the
+     * values of a non-sweep file, which have one point each.  Nested sweeps
+     * are returned flattened, with one point per innermost sweep point.
+     *
+     * With use_index, the metadata is read from the PsfIndex of the file,
+     * which is built and saved next to it first if missing or stale.
+     */
+    class PsfFile {
+    public:
+        explicit PsfFile(const std::string & psf_filename, bool use_index = false);
+        ~PsfFile();
+
+        PsfFile(const PsfFile &) = delete;
+        PsfFile & operator=(const PsfFile &) = delete;
+
+        // header properties.
+        const PropDict & get_properties() const;
+        const TypeMap & get_type_map() const;
+        const VarList & get_sweeps() const;
+        const VarList & get_traces() const;
+        // values of a non-sweep file, with their properties.
+        const VarList & get_values() const { return m_value_list; }
+
+        // number of points of every signal.
+        uint64_t get_num_points() const { return m_num_points; }
+
+        // returns the names of all signals, sweep variables first.
+        std::vector<std::string> get_names() const;
+
+        bool has_signal(const std::string & name) const;
+
+        // returns the type of the given signal.
+        const TypeDef & get_type(const std::string & name) const;
+
+        /**
+         * Returns the values of a signal, decoding them if needed.  Throws if
+         * the signal does not exist or has a different type.
+         */
+        Span<double> get_double(const std::string & name);
+        Span<std::complex<double>> get_complex(const std::string & name);
+        Span<int32_t> get_int32(const std::string & name);
+        Span<int8_t> get_int8(const std::string & name);
+
+        /**
+         * Returns the records of a struct signal, m_value_size bytes per point.
+         * Members are packed in order, at the m_dst_offset of each step of the
+         * m_plan of the signal type.
+         */
+        Span<char> get_struct(const std::string & name);
+
+        /**
+         * Returns the points whose sweep value is in [t_start, t_stop].  The
+         * sweep values must be increasing, as in transient analyses.  The
+         * sweep is binary searched one value at a time, so only the values
+         * compared are decoded.  Throws for non-sweep files and nested sweeps.
+         */
+        PointRange find_range(double t_start, double t_stop);
+
+        /**
+         * Returns a copy of the values of a signal in range.  Only the windows,
+         * or points of simple sweeps, in range are decoded, unless the signal
+         * is decoded already.  Throws like the whole-signal getters, for
+         * nested sweeps, or if the range is past the last point.
+         */
+        std::vector<double> get_double(const std::string & name, const PointRange & range);
+        std::vector<std::complex<double>> get_complex(const std::string & name, const PointRange & range);
+        std::vector<int32_t> get_int32(const std::string & name, const PointRange & range);
+        std::vector<int8_t> get_int8(const std::string & name, const PointRange & range);
+        std::vector<char> get_struct(const std::string & name, const PointRange & range);
+
+        // free the decoded values of a signal.  Its spans are no longer valid.
+        void release(const std::string & name);
+
+        // free the decoded values of all signals.
+        void release_all();
+
+    private:
+        // a signal, and its decoded values if requested.
+        class Column {
+        public:
+            Column() : m_type(nullptr), m_pos(0), m_stride(0), m_decoded(false) {}
+            ~Column() {}
+
+            std::string m_name;
+            const TypeDef * m_type;
+            // file position of the first value.
+            uint64_t m_pos;
+            // distance between consecutive windows in the file, or consecutive
+            // points if not windowed.
+            uint64_t m_stride;
+            bool m_decoded;
+            std::vector<char> m_values;
+        };
+
+        void add_column(const std::string & name, const TypeDef * type, uint64_t pos, uint64_t stride);
+        void read_swp_columns();
+        void add_swp_columns(uint64_t start);
+        void read_index_columns(const PsfIndex & index);
+        void read_no_swp_columns();
+        Column & find_column(const std::string & name, uint32_t data_type);
+        const char * get_column(const std::string & name, uint32_t data_type);
+        void decode_column(Column & col);
+        uint64_t get_value_pos(const Column & col, uint64_t idx) const;
+        double get_sweep_value(uint64_t idx);
+        uint64_t find_point(double t, bool after);
+        std::vector<char> read_range(const std::string & name, uint32_t data_type, const PointRange & range);
+
+        std::unique_ptr<ByteCursor> m_data;
+        std::unique_ptr<PsfSections> m_sections;
+        VarList m_value_list;
+        std::vector<Column> m_columns;
+        std::unordered_map<std::string, size_t> m_column_index;
+        uint64_t m_num_points;
+        // points per window and bytes per window and signal, or 0 if not windowed.
+        uint32_t m_np_window;
+        uint32_t m_win_size;
+    };
+
+}
+
+#endif
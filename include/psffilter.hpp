@@ -0,0 +1,52 @@
+#ifndef LIBPSF_FILTER_H_
+#define LIBPSF_FILTER_H_
+
+/**
+ *  This header file define the filter that selects which traces are converted.
+ */
+
+#include <string>
+#include <vector>
+#include <regex>
+
+namespace psf {
+
+    /**
+     * Returns true if name matches the glob pattern.  '*' matches any string,
+     * '?' matches any character, and "[...]" matches any character in the set
+     * ("[!...]" any character not in the set).
+     */
+    bool glob_match(const std::string & pattern, const std::string & name);
+
+    /**
+     * Selects variables by name.
+     *
+     * A name is selected if it matches any include pattern (or there are no
+     * include patterns), and matches no exclude pattern.  Patterns are globs,
+     * or ECMAScript regular expressions that must match the whole name.
+     */
+    class NameFilter {
+    public:
+        NameFilter(const std::vector<std::string> & include, const std::vector<std::string> & exclude,
+            bool use_regex);
+        ~NameFilter() {}
+
+        // returns true if no name is ever rejected.
+        bool is_empty() const { return m_include.empty() && m_exclude.empty(); }
+
+        bool match(const std::string & name) const;
+
+    private:
+        bool match_any(const std::vector<std::string> & patterns, const std::vector<std::regex> & regexes,
+            const std::string & name) const;
+
+        std::vector<std::string> m_include;
+        std::vector<std::string> m_exclude;
+        bool m_use_regex;
+        std::vector<std::regex> m_include_regex;
+        std::vector<std::regex> m_exclude_regex;
+    };
+
+}
+
+#endif
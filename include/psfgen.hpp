@@ -0,0 +1,77 @@
+#ifndef LIBPSF_GEN_H_
+#define LIBPSF_GEN_H_
+
+/**
+ *  This header file define the generator of synthetic binary PSF files.
+ */
+
+#include <string>
+
+#include "psf.hpp"
+
+namespace psf {
+
+    // the shape of a synthetic binary PSF file.
+    class GenOptions {
+    public:
+        enum layout {NO_SWEEP, SIMPLE, WINDOWED, NESTED};
+
+        GenOptions() : m_layout(layout::WINDOWED), m_num_points(1000), m_num_double(10), m_num_complex(0),
+            m_num_int32(0), m_num_struct(0), m_window_size(4096), m_num_rows(1), m_use_group(false) {}
+        ~GenOptions() {}
+
+        GenOptions::layout m_layout;
+        // number of sweep points, or of inner sweep points of each row of a
+        // nested sweep.  Ignored without a sweep.
+        uint32_t m_num_points;
+        // number of traces (or values, without a sweep) of each type.  Windowed
+        // sweeps only support double traces.
+        uint32_t m_num_double;
+        uint32_t m_num_complex;
+        uint32_t m_num_int32;
+        // structs have two double members and an int32 member.
+        uint32_t m_num_struct;
+        // bytes per window and trace of windowed sweeps.
+        uint32_t m_window_size;
+        // number of outer sweep points (rows) of nested sweeps.
+        uint32_t m_num_rows;
+        // if true, traces are listed in one group, as transient analyses do.
+        bool m_use_group;
+    };
+
+    /**
+     * Returns the sweep variable value of the given point.
+     */
+    double get_synthetic_sweep(uint32_t point);
+
+    /**
+     * Returns the outer sweep variable value of the given row of a nested
+     * sweep.  Values repeat in pairs, as in corner sweeps, so rows cannot be
+     * told apart by them.
+     */
+    double get_synthetic_outer(uint32_t row);
+
+    /**
+     * Returns the value of trace (or non-sweep value) signal at the given
+     * point.  Points of nested sweeps are numbered across rows.  Values are
+     * exact in binary, so readers can compare them for equality.  Complex
+     * values are (value, -value), int32 values are the value truncated, and
+     * structs hold (value, 2 * value, int32 value).
+     */
+    double get_synthetic_value(uint32_t signal, uint32_t point);
+
+    /**
+     * Write a synthetic binary PSF file, with the section, preamble, index and
+     * trailer layout Spectre uses.  Traces are named d<n>, c<n>, i<n> and s<n>
+     * by type, numbered from 0 in that order.  Points of nested sweeps
+     * store the outer sweep variable "vdd" and the inner sweep variable "time"
+     * before the traces, as simple sweeps do.  Returns the file size.  Files
+     * larger than 4 GB store the low 32 bits of their offsets, as readers
+     * expect (see unwrap_offset()).  Throws if the shape cannot be written,
+     * e.g. non-double traces in a windowed sweep.
+     */
+    uint64_t write_synthetic_psf(const std::string & psf_filename, const GenOptions & opts);
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef LIBPSF_INDEX_H_
+#define LIBPSF_INDEX_H_
+
+/**
+ *  This header file define the sidecar index of binary PSF files, which
+ *  saves later opens from parsing the metadata again.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "psftypes.hpp"
+
+namespace psf {
+
+    class PsfSections;
+
+    // appended to the name of a PSF file to get the name of its index.
+    static constexpr const char * INDEX_SUFFIX = ".psfidx";
+
+    // identifies the contents of a PSF file an index was built from.
+    class SourceStamp {
+    public:
+        SourceStamp() : m_size(0), m_mtime(0), m_metadata_bytes(0), m_checksum(0) {}
+        ~SourceStamp() {}
+
+        bool operator==(const SourceStamp & other) const {
+            return m_size == other.m_size && m_mtime == other.m_mtime &&
+                m_metadata_bytes == other.m_metadata_bytes && m_checksum == other.m_checksum;
+        }
+        bool operator!=(const SourceStamp & other) const { return !(*this == other); }
+
+        uint64_t m_size;
+        // modification time, in seconds since the epoch.
+        int64_t m_mtime;
+        // number of bytes before the values, which m_checksum covers.
+        uint64_t m_metadata_bytes;
+        // FNV-1a hash of the first m_metadata_bytes bytes, in 8-byte words.
+        uint64_t m_checksum;
+    };
+
+    /**
+     * The parsed metadata of a binary PSF file, and where its values are.
+     *
+     * An index is saved next to its PSF file, with INDEX_SUFFIX appended to
+     * the name.  It is encoded in PSF words, and read from a memory-mapped
+     * file:
+     *  - magic word, version
+     *  - source stamp: size, modification time, metadata bytes, checksum
+     *  - number of points, window size, points per window, value position
+     *  - header properties, then a zero word
+     *  - type count, then type definitions as in the type section
+     *  - sweep count and sweep variables, then trace count and traces, as in
+     *    the trace section with groups expanded
+     *  - non-sweep value count, then a variable and value position each
+     *  - magic word
+     *
+     * Types and variables are stored as PSF records, so they are read by the
+     * same code as PSF files, but without the section and index checks.
+     */
+    class PsfIndex {
+    public:
+        PsfIndex();
+        ~PsfIndex();
+
+        PsfIndex(const PsfIndex &) = delete;
+        PsfIndex & operator=(const PsfIndex &) = delete;
+
+        // returns the name of the index of psf_filename.
+        static std::string get_index_filename(const std::string & psf_filename);
+
+        // returns the stamp of the PSF file as it is now, given the size of its metadata.
+        static SourceStamp get_stamp(const std::string & psf_filename, uint64_t metadata_bytes);
+
+        // parse the metadata of a PSF file, and find where its values are.
+        static std::unique_ptr<PsfIndex> build(const std::string & psf_filename);
+
+        /**
+         * Read the index of a PSF file.  Returns null if there is no index,
+         * it cannot be read, or its stamp does not match the PSF file.
+         */
+        static std::unique_ptr<PsfIndex> load(const std::string & psf_filename);
+
+        /**
+         * Read the index of a PSF file, or build it and save it if it is
+         * missing or stale.  An index that cannot be saved, e.g. in a read-only
+         * directory, is still returned.
+         */
+        static std::unique_ptr<PsfIndex> open(const std::string & psf_filename);
+
+        // write the index to index_filename, replacing it as a whole.
+        void write(const std::string & index_filename) const;
+
+        SourceStamp m_stamp;
+        std::unique_ptr<PsfSections> m_sections;
+        // values of a non-sweep file, and the file position of each value.
+        VarList m_value_list;
+        std::vector<uint64_t> m_value_pos_list;
+        // file position of the first window, or of the first point of simple sweeps.
+        uint64_t m_value_pos;
+        // points per window, or 0 if not windowed.
+        uint32_t m_np_window;
+    };
+
+}
+
+#endif
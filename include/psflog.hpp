@@ -0,0 +1,63 @@
+#ifndef LIBPSF_LOG_H_
+#define LIBPSF_LOG_H_
+
+/**
+ *  This header file define the trace logging of PSF conversions.
+ */
+
+#include <string>
+
+#include "easylogging++.h"
+
+namespace psf {
+
+    // id of the logger used by threads without a LogScope.
+    static constexpr const char * DEFAULT_LOGGER_ID = "psf";
+
+    /**
+     * Sends the trace messages of the calling thread to a logger of its own
+     * while in scope, so concurrent conversions log to different sinks
+     * without reconfiguring the global loggers.  Scopes nest; the previous
+     * scope of the thread is restored on destruction.  If neither
+     * log_filename nor print_msg is given, messages are dropped without
+     * being formatted.
+     */
+    class LogScope {
+    public:
+        LogScope(const std::string & log_filename, bool print_msg);
+        ~LogScope();
+
+        LogScope(const LogScope &) = delete;
+        LogScope & operator=(const LogScope &) = delete;
+
+        const char * get_id() const { return m_id.c_str(); }
+        bool is_enabled() const { return m_enabled; }
+
+    private:
+        std::string m_id;
+        bool m_enabled;
+        LogScope * m_prev;
+    };
+
+    // returns the logger id of the calling thread.
+    const char * get_log_id();
+
+    // returns true if trace messages of the calling thread are written anywhere.
+    bool is_trace_enabled();
+
+}
+
+/**
+ * Log a trace message to the logger of the calling thread, e.g.
+ * PSF_LOG_TRACE << "value = " << value;
+ *
+ * The message is only formatted if the thread logs anywhere.  Building with
+ * PSF_NO_TRACE_LOG removes trace messages at compile time.
+ */
+#ifdef PSF_NO_TRACE_LOG
+#define PSF_LOG_TRACE if (true) {} else CLOG(TRACE, psf::DEFAULT_LOGGER_ID)
+#else
+#define PSF_LOG_TRACE if (!psf::is_trace_enabled()) {} else CLOG(TRACE, psf::get_log_id())
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef LIBPSF_MERGE_H_
+#define LIBPSF_MERGE_H_
+
+/**
+ *  This header file define functions that merge the PSF files of a parametric sweep.
+ */
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "psf.hpp"
+
+namespace psf {
+
+    // name of the group holding one dataset per design variable.
+    static constexpr const char * MERGE_PARAM_GROUP = "__params__";
+    // name of the design variable file written by ADE.
+    static constexpr const char * DESIGN_VAR_FILENAME = "variables_file";
+    // name of the ADE log file that lists the results of a run.
+    static constexpr const char * ARTIST_LOG_FILENAME = "artistLogFile";
+
+    typedef std::vector<std::pair<std::string, double>> DesignVarList;
+
+    /**
+     * Read design variables from an ASCII PSF design variable file, such as
+     * variables_file, with read_psf_ascii().  Returns (name, value) pairs in
+     * file order.  Values other than numbers, or structs whose first member
+     * is a number, are skipped.
+     */
+    DesignVarList read_design_vars(const std::string & filename);
+
+    /**
+     * Returns the design variable file of the run that produced psf_filename.
+     * This is the data file of the design_variables entry in the artistLogFile
+     * next to psf_filename, or variables_file if the log does not name one.
+     * Returns an empty string if the file does not exist.
+     */
+    std::string find_design_var_file(const std::string & psf_filename);
+
+    /**
+     * Merge the sweep PSF files of a parametric run into one HDF5 file.
+     *
+     * All files must have the same sweep and trace variables.  Each variable is
+     * written as a 2-D [param_index, sweep_point] dataset, where row i holds the
+     * values of psf_filenames[i].  Rows shorter than the longest run are padded
+     * with zeros; the number of valid points of each row is stored in the
+     * ROW_POINTS_NAME dataset.  The design variables of each run are stored
+     * as 1-D datasets in the MERGE_PARAM_GROUP group, with NaN for variables a
+     * run does not define.  Header properties are taken from the first file.
+     */
+    void merge_psf(const std::vector<std::string> & psf_filenames, const std::string & hdf5_filename,
+        const ConvertOptions & opts = ConvertOptions());
+
+}
+
+#endif
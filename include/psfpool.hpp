@@ -0,0 +1,68 @@
+#ifndef LIBPSF_POOL_H_
+#define LIBPSF_POOL_H_
+
+/**
+ *  This header file define the thread pool used to convert many PSF files at once.
+ */
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace psf {
+
+    /**
+     * A work-stealing thread pool.
+     *
+     * Every worker has its own job queue.  Jobs are submitted round-robin; a
+     * worker takes jobs from the front of its own queue, and when that is empty
+     * steals from the back of the other queues, so long jobs do not leave the
+     * remaining workers idle.  Jobs must not throw.
+     */
+    class ThreadPool {
+    public:
+        // num_threads = 0 uses the number of hardware threads.
+        explicit ThreadPool(unsigned int num_threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+        unsigned int size() const { return static_cast<unsigned int>(m_threads.size()); }
+
+        // queue a job.
+        void submit(std::function<void()> job);
+
+        // wait until all submitted jobs are done.
+        void wait();
+
+    private:
+        class Worker {
+        public:
+            std::deque<std::function<void()>> m_jobs;
+            std::mutex m_mutex;
+        };
+
+        bool pop_job(unsigned int idx, std::function<void()> & job);
+        void run(unsigned int idx);
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        // jobs sitting in worker queues.
+        size_t m_queued;
+        // jobs submitted but not finished.
+        size_t m_pending;
+        unsigned int m_next;
+        bool m_stop;
+    };
+
+}
+
+#endif
@@ -22,7 +22,7 @@ namespace psf {
         Property() : m_type(type::INT), m_ival(0), m_dval(0.0), m_name(""), m_sval("") {}
         ~Property() {}
 
-        bool read(std::ifstream & data);
+        bool read(ByteCursor & data);
         Property::type m_type;
         int m_ival;
         double m_dval;
@@ -36,7 +36,7 @@ namespace psf {
         PropDict() {}
         ~PropDict() {}
 
-        bool read(std::ifstream & data);
+        bool read(ByteCursor & data);
     };
 
     typedef std::unordered_map<std::string, std::unique_ptr<PropDict>> NestPropDict;
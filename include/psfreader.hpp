@@ -0,0 +1,140 @@
+#ifndef LIBPSF_READER_H_
+#define LIBPSF_READER_H_
+
+/**
+ *  This header file define the section and value readers shared by the PSF converters.
+ */
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "H5Cpp.h"
+
+#include "psf.hpp"
+#include "psfwriter.hpp"
+#include "psffilter.hpp"
+
+namespace psf {
+
+    // an entry of a type or trace section index.  Trace entries have two extra words.
+    class IndexEntry {
+    public:
+        IndexEntry() : m_id(0), m_offset(0), m_extra1(0), m_extra2(0) {}
+        ~IndexEntry() {}
+
+        uint32_t m_id;
+        int32_t m_offset;
+        int32_t m_extra1;
+        int32_t m_extra2;
+    };
+
+    typedef std::vector<IndexEntry> SectionIndex;
+
+    /**
+     * Interns the properties of value datasets.  Traces share nearly the same
+     * properties, so each distinct PropDict is written once, as the attributes
+     * of a group SHARED_PROPS_NAME/<n>, and each dataset only gets a
+     * SHARED_PROPS_NAME object reference attribute to that group.
+     */
+    class SharedProps {
+    public:
+        explicit SharedProps(H5::H5File * file) : m_file(file) {}
+        ~SharedProps() {}
+
+        SharedProps(const SharedProps &) = delete;
+        SharedProps & operator=(const SharedProps &) = delete;
+
+        // write a reference to the interned copy of prop_dict to loc.
+        void write(const PropDict & prop_dict, H5::H5Location * loc, ConvertStats * stats = nullptr);
+
+    private:
+        H5::H5File * m_file;
+        H5::Group m_group;
+        // reference to the group of each distinct PropDict, by its key.
+        std::unordered_map<std::string, hobj_ref_t> m_refs;
+    };
+
+    // the sections of a PSF file that precede the values.
+    class PsfSections {
+    public:
+        PsfSections() : m_win_size(0), m_num_points(0) {}
+        ~PsfSections() {}
+
+        std::unique_ptr<PropDict> m_prop_dict;
+        std::unique_ptr<TypeMap> m_type_map;
+        std::unique_ptr<VarList> m_sweep_list;
+        std::unique_ptr<VarList> m_trace_list;
+        SectionIndex m_type_index;
+        SectionIndex m_trace_index;
+        // PSF window size in bytes, 0 if values are not windowed.
+        uint32_t m_win_size;
+        // number of sweep points, 0 if there is no sweep.
+        uint64_t m_num_points;
+    };
+
+    std::unique_ptr<H5::H5File> create_hdf5_file(const std::string& hdf5_filename, const ConvertOptions & opts);
+    /**
+     * Read all sections before the value section.  The caller holds the HDF5
+     * lock, or releases h5_lock so it is only taken while types are read.
+     */
+    std::unique_ptr<PsfSections> read_sections(ByteCursor & data, ConvertStats * stats = nullptr,
+        H5Lock * h5_lock = nullptr);
+    /**
+     * Returns the file position of a 32-bit PSF offset read at pos.  Offsets
+     * wrap around in files larger than 4 GB, so this is the first position at
+     * or after pos with the same low 32 bits.
+     */
+    uint64_t unwrap_offset(uint32_t offset, uint64_t pos);
+    uint64_t read_section_preamble(ByteCursor & data, uint32_t section_code);
+    uint32_t read_window_header(ByteCursor & data, uint64_t num_points);
+    void check_sweep_types(const PsfSections & sections);
+    hsize_t get_sweep_block_points(const PsfSections & sections, const VarList & out_vars,
+        const ConvertOptions & opts, size_t & max_value_size);
+    void create_value_datasets(H5::H5File * file, const VarList & out_vars, const TypeMap & type_map,
+        const H5::DataSpace & file_space, const H5::DSetCreatPropList & dset_props, DataSetList * dsets,
+        std::list<TypeDef> * out_types, ConvertStats * stats = nullptr, SharedProps * shared_props = nullptr);
+
+    /**
+     * Create the value datasets of a flat sweep in matrix layout, and set the
+     * row of each output variable in target.
+     *
+     * The sweep variable, first in out_vars, gets a 1-D dataset as usual.
+     * Traces are grouped by type, and each type becomes a group of the
+     * MATRICES_NAME group, named after the type with escape_link_name() (and
+     * a numeric suffix if taken), holding:
+     *  - values: a 2-D [trace, point] dataset.
+     *  - names: the trace names, sorted, one per row of values, so a trace
+     *    is found by binary search.
+     *  - properties: the trace properties, as written by write_property_table().
+     */
+    void create_matrix_datasets(H5::H5File * file, const VarList & out_vars, const TypeMap & type_map,
+        const ConvertOptions & opts, hsize_t num_points, hsize_t block_points, size_t max_value_size,
+        DataSetList * dsets, std::list<TypeDef> * out_types, WriteTarget & target, ConvertStats * stats = nullptr);
+    std::vector<bool> select_traces(const PsfSections & sections, const VarList & out_vars,
+        const ConvertOptions & opts);
+    VarList get_selected(const VarList & out_vars, const std::vector<bool> & keep);
+    void read_values_swp(ByteCursor & data, const PsfSections & sections, const std::vector<bool> & keep,
+        DataSetList * dsets, std::list<TypeDef> * type_list, const ConvertOptions & opts, H5Lock & h5_lock,
+        WriteTarget & target, ConvertStats * stats = nullptr);
+    /**
+     * Write properties as attributes of dset, or as a reference to their
+     * interned copy if shared_props is not null.
+     */
+    void write_properties(const PropDict & prop_dict, H5::H5Location * dset, ConvertStats * stats = nullptr,
+        SharedProps * shared_props = nullptr);
+
+    // returns the SharedProps of file if opts interns properties, or null.
+    std::unique_ptr<SharedProps> make_shared_props(H5::H5File * file, const ConvertOptions & opts);
+
+    /**
+     * Returns the creation property list of sweep value datasets.  num_rows is
+     * 0 for 1-D datasets, or the number of rows of 2-D datasets.
+     */
+    H5::DSetCreatPropList make_value_props(const ConvertOptions & opts, hsize_t num_points,
+        hsize_t block_points, size_t max_value_size, hsize_t num_rows = 0);
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef LIBPSF_SCAN_H_
+#define LIBPSF_SCAN_H_
+
+/**
+ *  This header file define the metadata scan of PSF files, which lists
+ *  their contents without reading values.
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "psfproperty.hpp"
+
+namespace psf {
+
+    // a type defined in a PSF file.
+    class TypeSummary {
+    public:
+        TypeSummary() : m_value_size(0) {}
+        ~TypeSummary() {}
+
+        std::string m_name;
+        // the data type, e.g. "double", "complex" or "struct( double, int32, )".
+        std::string m_data_type;
+        // size of one decoded value in bytes, or 0 if values are not numbers.
+        size_t m_value_size;
+        PropDict m_prop_dict;
+    };
+
+    // a sweep variable or trace of a PSF file.
+    class SignalSummary {
+    public:
+        SignalSummary() {}
+        ~SignalSummary() {}
+
+        std::string m_name;
+        // name of the type of the values.
+        std::string m_type_name;
+        PropDict m_prop_dict;
+    };
+
+    // the metadata of a PSF file, as returned by scan_psf().
+    class PsfSummary {
+    public:
+        PsfSummary() : m_is_ascii(false), m_num_points(0), m_win_size(0) {}
+        ~PsfSummary() {}
+
+        // returns the summary as a JSON object.
+        std::string to_json() const;
+
+        bool m_is_ascii;
+        // header properties.
+        PropDict m_prop_dict;
+        std::vector<TypeSummary> m_types;
+        std::vector<SignalSummary> m_sweeps;
+        // traces, with groups expanded.
+        std::vector<SignalSummary> m_traces;
+        // number of sweep points, 0 if there is no sweep.
+        uint64_t m_num_points;
+        // PSF window size in bytes, 0 if values are not windowed.
+        uint32_t m_win_size;
+    };
+
+    /**
+     * Read the header, type, sweep and trace sections of a binary or ASCII
+     * PSF file, and stop before the values.  The number of points of ASCII
+     * sweeps is found by tokenizing the value section, without converting
+     * numbers.  Values of non-sweep files are not listed.
+     */
+    std::unique_ptr<PsfSummary> scan_psf(const std::string & psf_filename);
+
+}
+
+#endif
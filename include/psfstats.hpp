@@ -0,0 +1,101 @@
+#ifndef LIBPSF_STATS_H_
+#define LIBPSF_STATS_H_
+
+/**
+ *  This header file define the statistics collected while converting a PSF file.
+ */
+
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace psf {
+
+    // wall clock and CPU time spent in one conversion stage.
+    class StageStats {
+    public:
+        StageStats() : m_wall_seconds(0.0), m_cpu_seconds(0.0) {}
+        ~StageStats() {}
+
+        double m_wall_seconds;
+        double m_cpu_seconds;
+    };
+
+    /**
+     * Statistics of one conversion, filled in by convert_psf() when requested.
+     *
+     * CPU times are those of the thread that ran the stage, so they stay
+     * meaningful when many files are converted at once.  With a pipelined
+     * writer, HDF5 writes run on the writer thread and overlap decoding, so
+     * stage times may add up to more than the total time.
+     */
+    class ConvertStats {
+    public:
+        enum stage {METADATA_PARSE, DECODE, HDF5_CREATE, HDF5_WRITE, ATTRIBUTE_WRITE, NUM_STAGES};
+
+        ConvertStats() : m_header_bytes(0), m_type_bytes(0), m_sweep_bytes(0), m_trace_bytes(0),
+            m_value_bytes(0), m_num_points(0), m_num_traces(0), m_num_write_calls(0),
+            m_num_attributes(0), m_peak_buffer_bytes(0) {}
+        ~ConvertStats() {}
+
+        // returns the JSON name of a stage.
+        static const char * get_stage_name(ConvertStats::stage stage_id);
+
+        // returns the statistics as a JSON object.
+        std::string to_json() const;
+
+        // bytes read from each section of the PSF file.
+        uint64_t m_header_bytes;
+        uint64_t m_type_bytes;
+        uint64_t m_sweep_bytes;
+        uint64_t m_trace_bytes;
+        uint64_t m_value_bytes;
+        // number of sweep points, 0 if there is no sweep.
+        uint64_t m_num_points;
+        // number of traces converted, or values of a non-sweep file.
+        uint64_t m_num_traces;
+        StageStats m_stages[NUM_STAGES];
+        // time of the whole conversion.
+        StageStats m_total;
+        // number of HDF5 dataset writes.
+        uint64_t m_num_write_calls;
+        // number of HDF5 attributes written.
+        uint64_t m_num_attributes;
+        // largest amount of memory held by value buffers at once.
+        size_t m_peak_buffer_bytes;
+    };
+
+    // returns val as a quoted JSON string.
+    std::string json_quote(const std::string & val);
+
+    // returns the CPU time used by the calling thread, in seconds.
+    double get_thread_cpu_seconds();
+
+    /**
+     * Adds the time between construction and stop() (or destruction) to a
+     * stage of stats.  Does nothing if stats is null, so it costs nothing when
+     * statistics are not requested.
+     */
+    class StageTimer {
+    public:
+        StageTimer(ConvertStats * stats, ConvertStats::stage stage_id);
+        // times stage_stats directly, e.g. the total time.
+        explicit StageTimer(StageStats * stage_stats);
+        ~StageTimer() { stop(); }
+
+        StageTimer(const StageTimer &) = delete;
+        StageTimer & operator=(const StageTimer &) = delete;
+
+        // add the elapsed time to the stage.  Later calls do nothing.
+        void stop();
+
+    private:
+        StageStats * m_stage;
+        std::chrono::steady_clock::time_point m_start;
+        double m_cpu_start;
+    };
+
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef LIBPSF_SWAP_H_
+#define LIBPSF_SWAP_H_
+
+/**
+ *  This header file define bulk byte order conversion kernels.
+ *
+ *  PSF files store values in big-endian byte order.  These kernels reverse
+ *  the byte order of whole blocks of values, using SSSE3/AVX2 shuffles when
+ *  the CPU supports them and a scalar loop otherwise.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace psf {
+
+    // returns true if the host byte order is little-endian.
+    bool host_is_little_endian();
+
+    // returns the name of the kernel selected for this CPU ("avx2", "ssse3" or "scalar").
+    const char * swap_kernel_name();
+
+    /**
+     * Reverse the byte order of count 32-bit words from src into dst.
+     * src and dst may be the same buffer, but must not otherwise overlap.
+     */
+    void swap_bytes_32(const char * src, char * dst, size_t count);
+
+    /**
+     * Reverse the byte order of count 64-bit words from src into dst.
+     * src and dst may be the same buffer, but must not otherwise overlap.
+     */
+    void swap_bytes_64(const char * src, char * dst, size_t count);
+
+    // convert count complex doubles (pairs of 64-bit words) from src into dst.
+    inline void swap_complex_double(const char * src, char * dst, size_t count) {
+        swap_bytes_64(src, dst, 2 * count);
+    }
+
+    // one member of a record: m_width bytes at m_src_offset, stored reversed at m_dst_offset.
+    class DecodeStep {
+    public:
+        DecodeStep(size_t src_offset, size_t dst_offset, size_t width) :
+            m_src_offset(src_offset), m_dst_offset(dst_offset), m_width(width) {}
+        ~DecodeStep() {}
+
+        size_t m_src_offset;
+        size_t m_dst_offset;
+        size_t m_width;
+    };
+
+    /**
+     * A flat plan to decode records of one PSF type into packed little-endian
+     * records.
+     *
+     * Every member of a record, struct members included, is one step.  When
+     * all members are words of the same size stored back to back, as for
+     * doubles, complex doubles and structs of doubles, the plan runs the bulk
+     * swap kernels over whole blocks.  Other records, such as int8 values
+     * padded to a word or structs mixing doubles and int32, are decoded member
+     * by member with width-specialized copies.
+     */
+    class DecodePlan {
+    public:
+        enum kernel {NONE, SWAP32, SWAP64, GENERIC};
+
+        DecodePlan() : m_kernel(kernel::NONE), m_src_size(0), m_dst_size(0), m_width(0) {}
+        ~DecodePlan() {}
+
+        // returns the plan of a width bytes value stored at the end of a src_size bytes field.
+        static DecodePlan scalar(size_t width, size_t src_size);
+
+        // appends the steps of member, as the next member of a struct.
+        void append(const DecodePlan & member);
+
+        /**
+         * Decode count records from src into dst.  dst may be the same buffer
+         * as src, as records never grow, but must not otherwise overlap.
+         */
+        void decode(const char * src, char * dst, size_t count) const;
+
+        kernel m_kernel;
+        // size of one record in the PSF file, and once decoded.
+        size_t m_src_size;
+        size_t m_dst_size;
+        // width of all members, or 0 if members have different widths.
+        size_t m_width;
+        std::vector<DecodeStep> m_steps;
+
+    private:
+        void select_kernel();
+    };
+
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef LIBPSF_TABLE_H_
+#define LIBPSF_TABLE_H_
+
+/**
+ *  This header file define the table layouts of values: non-sweep values
+ *  gathered per type, and the name and property columns they share with
+ *  trace matrices.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+
+#include "psfproperty.hpp"
+#include "psfstats.hpp"
+
+namespace psf {
+
+    /**
+     * Returns name as a valid HDF5 link name.  PSF type and trace names may
+     * contain '/', e.g. "V/Sec", so '%' and '/' are written as "%25" and
+     * "%2F", and the name "." as "%2E".
+     */
+    std::string escape_link_name(const std::string & name);
+
+    // write names as a 1-D dataset of fixed-length strings.
+    void write_name_column(H5::H5Location * loc, const char * dset_name, const std::vector<std::string> & names,
+        ConvertStats * stats = nullptr);
+
+    /**
+     * Write props as a properties side table: one (row, name, type, int,
+     * double, string) record per property, where row is rows[idx], and type
+     * is 0 for int, 1 for double and 2 for string properties.
+     */
+    void write_property_table(H5::H5Location * loc, const std::vector<uint32_t> & rows,
+        const std::vector<Property> & props, ConvertStats * stats = nullptr);
+
+    /**
+     * The non-sweep values of one type, written as a single table instead of
+     * one dataset per value.
+     *
+     * A table is a group holding three datasets:
+     *  - values: one row per value, of the file type.
+     *  - names: the value names, one fixed-length string per row.
+     *  - properties: the properties of all values, as written by
+     *    write_property_table().  Omitted if no value has properties.
+     */
+    class ValueTable {
+    public:
+        ValueTable(const H5::DataType & mem_type, const H5::DataType & file_type, size_t value_size) :
+            m_mem_type(mem_type), m_file_type(file_type), m_value_size(value_size) {}
+        ~ValueTable() {}
+
+        // append a value in mem_type layout, with its properties.
+        void add(const std::string & name, const char * value, const PropDict & prop_dict);
+
+        // write the table to the group loc/table_name.
+        void write(H5::H5Location * loc, const std::string & table_name, ConvertStats * stats = nullptr) const;
+
+        H5::DataType m_mem_type;
+        H5::DataType m_file_type;
+        size_t m_value_size;
+        std::vector<std::string> m_names;
+        std::vector<char> m_values;
+        // the properties of all values, and the row each belongs to.
+        std::vector<uint32_t> m_prop_rows;
+        std::vector<Property> m_props;
+    };
+
+    // the tables of a non-sweep file, one per value type, in order of first use.
+    class ValueTableSet {
+    public:
+        ValueTableSet() {}
+        ~ValueTableSet() {}
+
+        /**
+         * Returns the table of the given type name, creating it if needed.
+         * Different types with the same name get tables of their own, named
+         * with a numeric suffix.
+         */
+        ValueTable & get_table(const std::string & type_name, const H5::DataType & mem_type,
+            const H5::DataType & file_type, size_t value_size);
+
+        /**
+         * Write all tables to the TABLES_NAME group of loc, each named after
+         * its type with escape_link_name().  Writes nothing without tables.
+         */
+        void write(H5::H5Location * loc, ConvertStats * stats = nullptr) const;
+
+        std::vector<std::string> m_order;
+        std::map<std::string, ValueTable> m_tables;
+    };
+
+}
+
+#endif
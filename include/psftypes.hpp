@@ -11,9 +11,12 @@
 #include <map>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 #include "H5Cpp.h"
 
 #include "psfcommon.hpp"
+#include "psfproperty.hpp"
+#include "psfswap.hpp"
 
 
 namespace psf {
@@ -36,7 +39,20 @@ namespace psf {
         TypeDef() {}
         ~TypeDef() {}
 
-        bool read(std::ifstream & data, std::map<const uint32_t, TypeDef> * type_lookup);
+        bool read(ByteCursor & data, std::map<const uint32_t, TypeDef> * type_lookup);
+
+        /**
+         * Returns true if values of this type are decoded by m_plan into
+         * m_h5_write_type layout.  Otherwise values are copied as read, and
+         * HDF5 converts them from m_h5_read_type.
+         */
+        bool can_swap() const { return m_plan.m_kernel != DecodePlan::kernel::NONE && host_is_little_endian(); }
+
+        /**
+         * Convert count values of this type from PSF byte order in src to
+         * m_h5_write_type layout in dst.  Requires can_swap().
+         */
+        void swap_values(const char * src, char * dst, size_t count) const { m_plan.decode(src, dst, count); }
 
         uint32_t m_id;
         std::string m_name;
@@ -45,7 +61,14 @@ namespace psf {
         uint32_t m_data_type;
         bool m_is_supported;
         H5::DataType m_h5_read_type, m_h5_write_type;
-        hsize_t m_read_offset, m_read_stride;
+        // size of one value in the PSF file, cached so decoding makes no HDF5 calls.
+        size_t m_read_size;
+        // size of one value once decoded by decode_values().
+        size_t m_value_size;
+        // how to decode values into m_h5_write_type layout.
+        DecodePlan m_plan;
+        // ids of the member types of a struct, in order.
+        std::vector<uint32_t> m_member_ids;
         PropDict m_prop_dict;
     };
 
@@ -59,7 +82,7 @@ namespace psf {
         Variable() {}
         ~Variable() {}
 
-        bool read(std::ifstream & data);
+        bool read(ByteCursor & data);
 
         uint32_t m_id;
         std::string m_name;
@@ -77,7 +100,7 @@ namespace psf {
         Group() {}
         ~Group() {}
 
-        bool read(std::ifstream & data);
+        bool read(ByteCursor & data);
 
         uint32_t m_id;
         std::string m_name;
@@ -0,0 +1,202 @@
+#ifndef LIBPSF_WRITER_H_
+#define LIBPSF_WRITER_H_
+
+/**
+ *  This header file define the block writer that transfers decoded values to HDF5.
+ */
+
+#include <list>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "H5Cpp.h"
+
+#include "psftypes.hpp"
+#include "psfstats.hpp"
+
+namespace psf {
+
+    typedef std::list<std::unique_ptr<H5::DataSet>> DataSetList;
+
+    // returns the mutex that serializes HDF5 calls of concurrent conversions.
+    std::mutex & hdf5_mutex();
+
+    /**
+     * Holds the HDF5 mutex while in scope.
+     *
+     * The HDF5 library is usually not built thread-safe, so every conversion
+     * holds this lock while it uses HDF5, and releases it (with H5Unlock)
+     * while parsing and decoding values.
+     */
+    class H5Lock {
+    public:
+        H5Lock() : m_lock(hdf5_mutex()) {}
+        ~H5Lock() {}
+
+        void lock() { m_lock.lock(); }
+        void unlock() { m_lock.unlock(); }
+
+    private:
+        std::unique_lock<std::mutex> m_lock;
+    };
+
+    // releases an H5Lock while in scope.
+    class H5Unlock {
+    public:
+        explicit H5Unlock(H5Lock & h5_lock) : m_h5_lock(h5_lock) { m_h5_lock.unlock(); }
+        ~H5Unlock() { m_h5_lock.lock(); }
+
+    private:
+        H5Lock & m_h5_lock;
+    };
+
+    // takes back an H5Lock released by H5Unlock while in scope.
+    class H5Relock {
+    public:
+        explicit H5Relock(H5Lock & h5_lock) : m_h5_lock(h5_lock) { m_h5_lock.lock(); }
+        ~H5Relock() { m_h5_lock.unlock(); }
+
+    private:
+        H5Lock & m_h5_lock;
+    };
+
+    /**
+     * Decode count values of the given type from src into dst.
+     *
+     * If the type can be byte swapped, its decode plan converts values to the
+     * packed native write layout of m_value_size bytes each, so memory and file
+     * types match and HDF5 only copies them.  Otherwise
+     * values are copied as is, and HDF5 converts them from the read type when
+     * written.  dst may be the same buffer as src.
+     */
+    inline void decode_values(const TypeDef & type, const char * src, char * dst, size_t count) {
+        if (type.can_swap()) {
+            type.swap_values(src, dst, count);
+        }
+        else if (src != dst) {
+            memcpy(dst, src, count * type.m_read_size);
+        }
+    }
+
+    /**
+     * Write values decoded by decode_values() to dset.
+     */
+    inline void write_values(H5::DataSet * dset, const TypeDef & type, const char * buf,
+        const H5::DataSpace & mem_space, const H5::DataSpace & file_space) {
+        if (type.can_swap()) {
+            dset->write(buf, type.m_h5_write_type, mem_space, file_space);
+        }
+        else {
+            dset->write(buf, type.m_h5_read_type, mem_space, file_space);
+        }
+    }
+
+    /**
+     * Describes where a BlockWriter writes values.
+     *
+     * Flat sweeps are written to 1-D datasets, or to row m_row of 2-D datasets,
+     * or to row m_rows[idx] of the 2-D dataset of column idx if m_rows is set.
+     * Nested sweeps start with m_num_outer outer sweep datasets.  The writer
+     * starts a new row whenever an outer sweep value changes or the inner
+     * sweep restarts, writes the outer values of each row to the 1-D outer
+     * datasets, and writes all other values to 2-D [row, point] datasets,
+     * extending all of them as needed.
+     */
+    class WriteTarget {
+    public:
+        WriteTarget() : m_row(0), m_num_outer(0) {}
+        ~WriteTarget() {}
+
+        // row of 2-D datasets to write flat sweep values to.
+        hsize_t m_row;
+        // row of each column in its 2-D dataset, if columns share datasets.
+        std::vector<hsize_t> m_rows;
+        // number of outer sweep datasets of a nested sweep, 0 for flat sweeps.
+        uint32_t m_num_outer;
+        // number of points written to each row of a nested sweep.
+        std::vector<hsize_t> m_row_points;
+    };
+
+    // a block of consecutive sweep points, decoded into one column buffer per dataset.
+    class ValueBlock {
+    public:
+        ValueBlock() : m_offset(0), m_count(0) {}
+        ~ValueBlock() {}
+
+        std::vector<std::unique_ptr<char[]>> m_columns;
+        // index of the first sweep point in this block.
+        hsize_t m_offset;
+        // number of sweep points in this block.
+        hsize_t m_count;
+    };
+
+    /**
+     * Writes blocks of decoded values to HDF5 datasets, as described by a WriteTarget.
+     *
+     * In pipelined mode a dedicated writer thread owns all HDF5 calls, while the
+     * caller decodes the next block into a free buffer, so input decoding and
+     * HDF5 writes overlap.  The number of blocks bounds the memory used.  Since
+     * HDF5 is not thread-safe, the caller must not use HDF5 between the first
+     * acquire() and finish().  Each block is written while holding the HDF5
+     * mutex, so the caller must release its H5Lock (if any) while decoding.
+     * If stats is not null, write times, write calls and buffer memory are
+     * added to it.
+     */
+    class BlockWriter {
+    public:
+        BlockWriter(DataSetList * dsets, std::list<TypeDef> * type_list, WriteTarget * target,
+            hsize_t block_points, bool pipelined, uint32_t num_blocks, ConvertStats * stats = nullptr);
+        ~BlockWriter();
+
+        BlockWriter(const BlockWriter &) = delete;
+        BlockWriter & operator=(const BlockWriter &) = delete;
+
+        // returns a free block to decode into, waiting for the writer if necessary.
+        ValueBlock * acquire();
+
+        // queue a filled block to be written.
+        void submit(ValueBlock * block);
+
+        // wait until all submitted blocks are written.  Rethrows writer errors.
+        void finish();
+
+    private:
+        void run();
+        void write_block(ValueBlock * block);
+        void write_nested_block(ValueBlock * block);
+        void write_row_values(ValueBlock * block, hsize_t start, hsize_t count);
+        void stop();
+        void check_error();
+
+        DataSetList * m_dsets;
+        std::list<TypeDef> * m_type_list;
+        WriteTarget * m_target;
+        bool m_pipelined;
+        ConvertStats * m_stats;
+        // outer sweep values of the current row of a nested sweep.
+        std::vector<char> m_outer_values;
+        // last inner sweep value of a nested sweep, and its direction in the current row.
+        double m_last_inner;
+        int m_inner_dir;
+        // current number of columns of nested sweep datasets.
+        hsize_t m_num_cols;
+
+        std::vector<std::unique_ptr<ValueBlock>> m_blocks;
+        std::deque<ValueBlock *> m_free;
+        std::deque<ValueBlock *> m_full;
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        bool m_stop;
+        std::exception_ptr m_error;
+    };
+
+}
+
+#endif
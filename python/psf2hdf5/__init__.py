@@ -1,3 +1,9 @@
 # -*- coding: utf-8 -*-
 
 from .core import parse_adexl_results
+
+try:
+    from .binary import PsfFile, read_psf_binary
+except ImportError:
+    # the compiled reader is optional.
+    pass
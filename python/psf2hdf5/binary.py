@@ -0,0 +1,43 @@
+# -*- coding: utf-8 -*-
+
+"""Read binary PSF files with the compiled reader, without writing HDF5."""
+
+from __future__ import (absolute_import, division,
+                        print_function, unicode_literals)
+
+import numpy as np
+
+from ._psf import PsfFile
+
+
+def get_values(psf_file, name):
+    """Return the values of the given signal as a read-only numpy array.
+
+    The array shares memory with the decoded values held by psf_file.
+    Struct signals give a structured array with one field per member.
+    """
+    return np.asarray(psf_file.values(name))
+
+
+def get_values_range(psf_file, name, t_start, t_stop):
+    """Return the values of the given signal at the sweep points in [t_start, t_stop].
+
+    The sweep must be increasing, as in transient analyses, and nested
+    sweeps are not supported.  Only the windows of the range are decoded.
+    """
+    return np.asarray(psf_file.values_range(name, t_start, t_stop))
+
+
+def read_psf_binary(fname, names=None, use_index=False):
+    """Read the given binary PSF file.
+
+    Returns a dictionary from signal name to numpy array, and a dictionary
+    of header properties.  If names is given, only those signals are decoded.
+    If use_index is True, the metadata is read from the .psfidx index of the
+    file, which is built first if missing or stale.
+    """
+    psf_file = PsfFile(fname, use_index=use_index)
+    if names is None:
+        names = psf_file.names()
+    val_dict = {name: get_values(psf_file, name) for name in names}
+    return val_dict, psf_file.properties()
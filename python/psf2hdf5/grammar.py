@@ -9,6 +9,11 @@ from builtins import *
 
 import pyparsing as pp
 
+try:
+    from ._psf import read_ascii as _read_ascii
+except ImportError:
+    _read_ascii = None
+
 # header section definitions
 # a quoted string.
 quoted_string = pp.QuotedString('"', escChar='\\', unquoteResults=True)
@@ -186,7 +191,12 @@ def make_value_section_parser(type_results):
 
 
 def parse_psf_ascii(file_name):
-    """Parse the given ASCII PSF file and return the content."""
+    """Parse the given ASCII PSF file and return the content.
+
+    Uses the compiled parser if the extension module is built.
+    """
+    if _read_ascii is not None:
+        return _read_ascii(file_name)
 
     with open(file_name, 'r') as f:
         content = f.read()
@@ -0,0 +1,658 @@
+/**
+ *  Python extension module psf2hdf5._psf, which reads binary and ASCII PSF files in process.
+ *
+ *  Signal values are exported with the buffer protocol, straight from the
+ *  decoded buffers of psf::PsfFile or psf::AsciiPsf, so numpy.asarray()
+ *  wraps them without copying.  A buffer keeps its file open until the last
+ *  view is released.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "psfascii.hpp"
+#include "psffile.hpp"
+
+namespace {
+
+    // a PsfFile object.
+    struct FileObject {
+        PyObject_HEAD
+        psf::PsfFile * m_file;
+    };
+
+    // a read-only buffer over the decoded values of one signal.
+    struct ColumnObject {
+        PyObject_HEAD
+        // the FileObject, or the capsule of the AsciiPsf, that owns the values.
+        PyObject * m_owner;
+        const char * m_data;
+        Py_ssize_t m_size;
+        Py_ssize_t m_itemsize;
+        const char * m_format;
+    };
+
+    PyObject * to_str(const std::string & val) {
+        return PyUnicode_DecodeUTF8(val.data(), static_cast<Py_ssize_t>(val.size()), "surrogateescape");
+    }
+
+    /**
+     * Run func, and convert C++ exceptions to Python exceptions.
+     */
+    template <typename F>
+    PyObject * guard(F func) {
+        try {
+            return func();
+        }
+        catch (std::exception & e) {
+            PyErr_SetString(PyExc_RuntimeError, e.what());
+        }
+        catch (H5::Exception & e) {
+            PyErr_SetString(PyExc_RuntimeError, e.getDetailMsg().c_str());
+        }
+        catch (...) {
+            PyErr_SetString(PyExc_RuntimeError, "Unknown error.");
+        }
+        return nullptr;
+    }
+
+    PyObject * to_dict(const psf::PropDict & prop_dict) {
+        PyObject * ans = PyDict_New();
+        if (ans == nullptr) {
+            return nullptr;
+        }
+        for (auto itp = prop_dict.begin(); itp != prop_dict.end(); ++itp) {
+            const psf::Property & prop = itp->second;
+            PyObject * val;
+            switch (prop.m_type) {
+            case psf::Property::type::INT:
+                val = PyLong_FromLong(prop.m_ival);
+                break;
+            case psf::Property::type::DOUBLE:
+                val = PyFloat_FromDouble(prop.m_dval);
+                break;
+            default:
+                val = to_str(prop.m_sval);
+            }
+            PyObject * key = to_str(itp->first);
+            int err = (key == nullptr || val == nullptr) ? -1 : PyDict_SetItem(ans, key, val);
+            Py_XDECREF(key);
+            Py_XDECREF(val);
+            if (err != 0) {
+                Py_DECREF(ans);
+                return nullptr;
+            }
+        }
+        return ans;
+    }
+
+    PyObject * to_list(const std::vector<std::string> & names) {
+        PyObject * ans = PyList_New(static_cast<Py_ssize_t>(names.size()));
+        if (ans == nullptr) {
+            return nullptr;
+        }
+        for (size_t idx = 0; idx < names.size(); ++idx) {
+            PyObject * name = to_str(names[idx]);
+            if (name == nullptr) {
+                Py_DECREF(ans);
+                return nullptr;
+            }
+            PyList_SET_ITEM(ans, static_cast<Py_ssize_t>(idx), name);
+        }
+        return ans;
+    }
+
+    std::vector<std::string> get_var_names(const psf::VarList & vars) {
+        std::vector<std::string> ans;
+        for (auto itv = vars.begin(); itv != vars.end(); ++itv) {
+            ans.push_back((*itv).m_name);
+        }
+        return ans;
+    }
+
+    // returns the properties of the sweep, trace or value with the given name.
+    const psf::PropDict * find_var_props(const psf::PsfFile & file, const std::string & name) {
+        const psf::VarList * lists[3] = { &file.get_sweeps(), &file.get_traces(), &file.get_values() };
+        for (int idx = 0; idx < 3; ++idx) {
+            for (auto itv = lists[idx]->begin(); itv != lists[idx]->end(); ++itv) {
+                if ((*itv).m_name == name) {
+                    return &(*itv).m_prop_dict;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // Column type
+    /////////////////////////////////////////////////////////////////////////
+
+    void column_dealloc(ColumnObject * self) {
+        Py_XDECREF(self->m_owner);
+        Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+    }
+
+    int column_getbuffer(ColumnObject * self, Py_buffer * view, int flags) {
+        if (flags & PyBUF_WRITABLE) {
+            PyErr_SetString(PyExc_BufferError, "PSF values are read-only.");
+            view->obj = nullptr;
+            return -1;
+        }
+        view->obj = reinterpret_cast<PyObject *>(self);
+        Py_INCREF(self);
+        view->buf = const_cast<char *>(self->m_data);
+        view->len = self->m_size * self->m_itemsize;
+        view->readonly = 1;
+        view->itemsize = self->m_itemsize;
+        view->format = (flags & PyBUF_FORMAT) ? const_cast<char *>(self->m_format) : nullptr;
+        view->ndim = 1;
+        view->shape = (flags & PyBUF_ND) ? &self->m_size : nullptr;
+        view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? &self->m_itemsize : nullptr;
+        view->suboffsets = nullptr;
+        view->internal = nullptr;
+        return 0;
+    }
+
+    PyBufferProcs column_as_buffer = {
+        reinterpret_cast<getbufferproc>(column_getbuffer),
+        nullptr,
+    };
+
+    PyTypeObject ColumnType = {
+        PyVarObject_HEAD_INIT(nullptr, 0)
+        "psf2hdf5._psf.Column",
+    };
+
+    // returns a memoryview over size values owned by owner.
+    PyObject * make_column(PyObject * owner, const char * data, Py_ssize_t size, Py_ssize_t itemsize,
+        const char * format) {
+        ColumnObject * col = PyObject_New(ColumnObject, &ColumnType);
+        if (col == nullptr) {
+            return nullptr;
+        }
+        Py_INCREF(owner);
+        col->m_owner = owner;
+        col->m_data = data;
+        col->m_size = size;
+        col->m_itemsize = itemsize;
+        col->m_format = format;
+        PyObject * ans = PyMemoryView_FromObject(reinterpret_cast<PyObject *>(col));
+        Py_DECREF(col);
+        return ans;
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // PsfFile type
+    /////////////////////////////////////////////////////////////////////////
+
+    int file_init(FileObject * self, PyObject * args, PyObject * kwds) {
+        static const char * kwlist[] = { "filename", "use_index", nullptr };
+        const char * filename;
+        int use_index = 0;
+        if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|p", const_cast<char **>(kwlist), &filename, &use_index)) {
+            return -1;
+        }
+        if (self->m_file != nullptr) {
+            // memoryviews may still point into the open file.
+            PyErr_SetString(PyExc_RuntimeError, "PsfFile is already open.");
+            return -1;
+        }
+        PyObject * ans = guard([&]() {
+            self->m_file = new psf::PsfFile(filename, use_index != 0);
+            Py_RETURN_NONE;
+        });
+        if (ans == nullptr) {
+            return -1;
+        }
+        Py_DECREF(ans);
+        return 0;
+    }
+
+    void file_dealloc(FileObject * self) {
+        delete self->m_file;
+        Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+    }
+
+    bool check_open(FileObject * self) {
+        if (self->m_file == nullptr) {
+            PyErr_SetString(PyExc_ValueError, "PSF file is not open.");
+            return false;
+        }
+        return true;
+    }
+
+    PyObject * file_names(FileObject * self, PyObject *) {
+        if (!check_open(self)) {
+            return nullptr;
+        }
+        return to_list(self->m_file->get_names());
+    }
+
+    PyObject * file_sweeps(FileObject * self, PyObject *) {
+        if (!check_open(self)) {
+            return nullptr;
+        }
+        return to_list(get_var_names(self->m_file->get_sweeps()));
+    }
+
+    PyObject * file_traces(FileObject * self, PyObject *) {
+        if (!check_open(self)) {
+            return nullptr;
+        }
+        return to_list(get_var_names(self->m_file->get_traces()));
+    }
+
+    PyObject * file_properties(FileObject * self, PyObject *) {
+        if (!check_open(self)) {
+            return nullptr;
+        }
+        return to_dict(self->m_file->get_properties());
+    }
+
+    PyObject * file_var_properties(FileObject * self, PyObject * args) {
+        const char * name;
+        if (!check_open(self) || !PyArg_ParseTuple(args, "s", &name)) {
+            return nullptr;
+        }
+        const psf::PropDict * prop_dict = find_var_props(*(self->m_file), name);
+        if (prop_dict == nullptr) {
+            PyErr_Format(PyExc_KeyError, "Signal %s not found.", name);
+            return nullptr;
+        }
+        return to_dict(*prop_dict);
+    }
+
+    PyObject * file_type_name(FileObject * self, PyObject * args) {
+        const char * name;
+        if (!check_open(self) || !PyArg_ParseTuple(args, "s", &name)) {
+            return nullptr;
+        }
+        return guard([&]() {
+            return to_str(self->m_file->get_type(name).m_type_name);
+        });
+    }
+
+    PyObject * file_num_points(FileObject * self, void *) {
+        if (!check_open(self)) {
+            return nullptr;
+        }
+        return PyLong_FromUnsignedLongLong(self->m_file->get_num_points());
+    }
+
+    // appends the buffer format of values of the given type to builder.
+    void append_format(const psf::TypeMap & type_map, const psf::TypeDef & type, std::ostringstream & builder) {
+        switch (type.m_data_type) {
+        case psf::TypeDef::TYPEID_INT8:
+            builder << "b";
+            break;
+        case psf::TypeDef::TYPEID_INT32:
+            builder << "i";
+            break;
+        case psf::TypeDef::TYPEID_DOUBLE:
+            builder << "d";
+            break;
+        case psf::TypeDef::TYPEID_COMPLEXDOUBLE:
+            builder << "Zd";
+            break;
+        case psf::TypeDef::TYPEID_STRUCT:
+            // members are packed in native byte order.
+            builder << "T{";
+            for (auto itm = type.m_member_ids.begin(); itm != type.m_member_ids.end(); ++itm) {
+                const psf::TypeDef & member = type_map.at(*itm);
+                builder << "=";
+                append_format(type_map, member, builder);
+                builder << ":" << member.m_name << ":";
+            }
+            builder << "}";
+            break;
+        default:
+            throw std::runtime_error("Type " + type.m_type_name + " is not supported.");
+        }
+    }
+
+    /**
+     * Returns the buffer format of the values of a signal.  Formats are kept
+     * for the life of the module, since buffers only point to them.
+     */
+    const char * get_format(const psf::PsfFile & file, const std::string & name) {
+        static std::set<std::string> formats;
+        const psf::TypeDef & type = file.get_type(name);
+        if (!type.m_is_supported) {
+            throw std::runtime_error("Signal " + name + " has unsupported type " + type.m_type_name + ".");
+        }
+        std::ostringstream builder;
+        append_format(file.get_type_map(), type, builder);
+        return formats.insert(builder.str()).first->c_str();
+    }
+
+    /**
+     * Returns a memoryview over the values of a signal.  Values are decoded
+     * the first time, and shared by all later views.  Struct values have
+     * one field per member.
+     */
+    PyObject * file_values(FileObject * self, PyObject * args) {
+        const char * name;
+        if (!check_open(self) || !PyArg_ParseTuple(args, "s", &name)) {
+            return nullptr;
+        }
+        const char * data = nullptr;
+        Py_ssize_t itemsize = 0;
+        const char * format = nullptr;
+        PyObject * ok = guard([&]() {
+            psf::PsfFile & file = *(self->m_file);
+            format = get_format(file, name);
+            const psf::TypeDef & type = file.get_type(name);
+            itemsize = static_cast<Py_ssize_t>(type.m_value_size);
+            switch (type.m_data_type) {
+            case psf::TypeDef::TYPEID_INT8:
+                data = reinterpret_cast<const char *>(file.get_int8(name).data());
+                break;
+            case psf::TypeDef::TYPEID_INT32:
+                data = reinterpret_cast<const char *>(file.get_int32(name).data());
+                break;
+            case psf::TypeDef::TYPEID_DOUBLE:
+                data = reinterpret_cast<const char *>(file.get_double(name).data());
+                break;
+            case psf::TypeDef::TYPEID_COMPLEXDOUBLE:
+                data = reinterpret_cast<const char *>(file.get_complex(name).data());
+                break;
+            default:
+                data = file.get_struct(name).data();
+            }
+            Py_RETURN_NONE;
+        });
+        if (ok == nullptr) {
+            return nullptr;
+        }
+        Py_DECREF(ok);
+
+        return make_column(reinterpret_cast<PyObject *>(self), data,
+            static_cast<Py_ssize_t>(self->m_file->get_num_points()), itemsize, format);
+    }
+
+    // returns the values of v as bytes.
+    template <typename T>
+    PyObject * to_bytes(const std::vector<T> & v) {
+        return PyBytes_FromStringAndSize(reinterpret_cast<const char *>(v.data()),
+            static_cast<Py_ssize_t>(v.size() * sizeof(T)));
+    }
+
+    /**
+     * Returns a memoryview over a copy of the values of a signal at the sweep
+     * points in [t_start, t_stop], in the format of file_values().  Only the
+     * windows of the range are decoded.
+     */
+    PyObject * file_values_range(FileObject * self, PyObject * args) {
+        const char * name;
+        double t_start, t_stop;
+        if (!check_open(self) || !PyArg_ParseTuple(args, "sdd", &name, &t_start, &t_stop)) {
+            return nullptr;
+        }
+        Py_ssize_t itemsize = 0;
+        const char * format = nullptr;
+        PyObject * values = guard([&]() {
+            psf::PsfFile & file = *(self->m_file);
+            format = get_format(file, name);
+            const psf::TypeDef & type = file.get_type(name);
+            itemsize = static_cast<Py_ssize_t>(type.m_value_size);
+            psf::PointRange range = file.find_range(t_start, t_stop);
+            switch (type.m_data_type) {
+            case psf::TypeDef::TYPEID_INT8:
+                return to_bytes(file.get_int8(name, range));
+            case psf::TypeDef::TYPEID_INT32:
+                return to_bytes(file.get_int32(name, range));
+            case psf::TypeDef::TYPEID_DOUBLE:
+                return to_bytes(file.get_double(name, range));
+            case psf::TypeDef::TYPEID_COMPLEXDOUBLE:
+                return to_bytes(file.get_complex(name, range));
+            default:
+                return to_bytes(file.get_struct(name, range));
+            }
+        });
+        if (values == nullptr) {
+            return nullptr;
+        }
+        // the memoryview owns the bytes object.
+        PyObject * ans = make_column(values, PyBytes_AS_STRING(values), PyBytes_GET_SIZE(values) / itemsize,
+            itemsize, format);
+        Py_DECREF(values);
+        return ans;
+    }
+
+    PyMethodDef file_methods[] = {
+        { "names", reinterpret_cast<PyCFunction>(file_names), METH_NOARGS,
+          "Returns the names of all signals, sweep variables first." },
+        { "sweeps", reinterpret_cast<PyCFunction>(file_sweeps), METH_NOARGS,
+          "Returns the names of the sweep variables." },
+        { "traces", reinterpret_cast<PyCFunction>(file_traces), METH_NOARGS,
+          "Returns the names of the traces." },
+        { "properties", reinterpret_cast<PyCFunction>(file_properties), METH_NOARGS,
+          "Returns the header properties as a dictionary." },
+        { "var_properties", reinterpret_cast<PyCFunction>(file_var_properties), METH_VARARGS,
+          "Returns the properties of the given signal as a dictionary." },
+        { "type_name", reinterpret_cast<PyCFunction>(file_type_name), METH_VARARGS,
+          "Returns the type name of the given signal." },
+        { "values", reinterpret_cast<PyCFunction>(file_values), METH_VARARGS,
+          "Returns a read-only memoryview over the values of the given signal." },
+        { "values_range", reinterpret_cast<PyCFunction>(file_values_range), METH_VARARGS,
+          "values_range(name, t_start, t_stop)\n\nReturns a read-only memoryview over the values of the given signal at\n"
+          "the sweep points in [t_start, t_stop], decoding only the windows of the range.\n"
+          "The sweep must be increasing, as in transient analyses; nested sweeps are\n"
+          "not supported." },
+        { nullptr, nullptr, 0, nullptr },
+    };
+
+    PyGetSetDef file_getset[] = {
+        { const_cast<char *>("num_points"), reinterpret_cast<getter>(file_num_points), nullptr,
+          const_cast<char *>("Number of points of every signal."), nullptr },
+        { nullptr, nullptr, nullptr, nullptr, nullptr },
+    };
+
+    PyTypeObject FileType = {
+        PyVarObject_HEAD_INIT(nullptr, 0)
+        "psf2hdf5._psf.PsfFile",
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // ASCII PSF files
+    /////////////////////////////////////////////////////////////////////////
+
+    PyObject * to_value(const psf::AsciiType & type, const psf::AsciiValue & value);
+
+    // structs become dictionaries from member name to value.
+    PyObject * to_scalar(const psf::AsciiType & type, const psf::AsciiValue & value) {
+        switch (value.m_kind) {
+        case psf::AsciiValue::kind::DOUBLE:
+            return PyFloat_FromDouble(value.m_dval);
+        case psf::AsciiValue::kind::INT:
+            return PyLong_FromLong(value.m_ival);
+        case psf::AsciiValue::kind::COMPLEX:
+            return PyComplex_FromDoubles(value.m_cval.real(), value.m_cval.imag());
+        case psf::AsciiValue::kind::STRING:
+            return to_str(value.m_sval);
+        default:
+            break;
+        }
+        PyObject * ans = PyDict_New();
+        if (ans == nullptr) {
+            return nullptr;
+        }
+        for (size_t idx = 0; idx < type.m_members.size(); ++idx) {
+            PyObject * key = to_str(type.m_members[idx].m_name);
+            PyObject * val = to_value(type.m_members[idx], value.m_items[idx]);
+            int err = (key == nullptr || val == nullptr) ? -1 : PyDict_SetItem(ans, key, val);
+            Py_XDECREF(key);
+            Py_XDECREF(val);
+            if (err != 0) {
+                Py_DECREF(ans);
+                return nullptr;
+            }
+        }
+        return ans;
+    }
+
+    // arrays become lists.
+    PyObject * to_value(const psf::AsciiType & type, const psf::AsciiValue & value) {
+        if (!type.m_is_array) {
+            return to_scalar(type, value);
+        }
+        PyObject * ans = PyList_New(static_cast<Py_ssize_t>(value.m_items.size()));
+        if (ans == nullptr) {
+            return nullptr;
+        }
+        for (size_t idx = 0; idx < value.m_items.size(); ++idx) {
+            PyObject * item = to_scalar(type, value.m_items[idx]);
+            if (item == nullptr) {
+                Py_DECREF(ans);
+                return nullptr;
+            }
+            PyList_SET_ITEM(ans, static_cast<Py_ssize_t>(idx), item);
+        }
+        return ans;
+    }
+
+    // add {'value': value, 'properties': {...}} to val_dict.  Steals the reference to value.
+    int add_entry(PyObject * val_dict, const std::string & name, PyObject * value,
+        const psf::PropDict & prop_dict) {
+        if (value == nullptr) {
+            return -1;
+        }
+        PyObject * props = to_dict(prop_dict);
+        PyObject * entry = (props == nullptr) ? nullptr :
+            Py_BuildValue("{s:O,s:O}", "value", value, "properties", props);
+        PyObject * key = to_str(name);
+        int err = (entry == nullptr || key == nullptr) ? -1 : PyDict_SetItem(val_dict, key, entry);
+        Py_XDECREF(key);
+        Py_XDECREF(entry);
+        Py_XDECREF(props);
+        Py_DECREF(value);
+        return err;
+    }
+
+    void delete_ascii_psf(PyObject * capsule) {
+        delete static_cast<psf::AsciiPsf *>(PyCapsule_GetPointer(capsule, "psf.AsciiPsf"));
+    }
+
+    /**
+     * Returns the values and header properties of an ASCII PSF file, in the
+     * same format as grammar.parse_psf_ascii().  Sweep values are memoryviews
+     * over the parsed columns.
+     */
+    PyObject * read_ascii(PyObject *, PyObject * args) {
+        const char * filename;
+        if (!PyArg_ParseTuple(args, "s", &filename)) {
+            return nullptr;
+        }
+        psf::AsciiPsf * psf = nullptr;
+        PyObject * ok = guard([&]() {
+            psf = psf::read_psf_ascii(filename).release();
+            Py_RETURN_NONE;
+        });
+        if (ok == nullptr) {
+            return nullptr;
+        }
+        Py_DECREF(ok);
+        // the capsule owns the parsed file from now on.
+        PyObject * owner = PyCapsule_New(psf, "psf.AsciiPsf", delete_ascii_psf);
+        if (owner == nullptr) {
+            delete psf;
+            return nullptr;
+        }
+
+        PyObject * val_dict = PyDict_New();
+        int err = (val_dict == nullptr) ? -1 : 0;
+        for (auto itv = psf->m_values.begin(); err == 0 && itv != psf->m_values.end(); ++itv) {
+            PyObject * value = guard([&]() {
+                return to_value(psf->get_type((*itv).m_type_name), (*itv).m_value);
+            });
+            err = add_entry(val_dict, (*itv).m_name, value, (*itv).m_prop_dict);
+        }
+        for (size_t col = 0; err == 0 && col < psf->m_columns.size(); ++col) {
+            const psf::AsciiVar & var = (col < psf->m_sweeps.size()) ? psf->m_sweeps[col] :
+                psf->m_traces[col - psf->m_sweeps.size()];
+            const char * format = "d";
+            Py_ssize_t itemsize = sizeof(double);
+            switch (psf->get_type(var.m_type_name).m_kind) {
+            case psf::AsciiType::kind::INT:
+                format = "i";
+                itemsize = sizeof(int32_t);
+                break;
+            case psf::AsciiType::kind::COMPLEX:
+                format = "Zd";
+                itemsize = sizeof(std::complex<double>);
+                break;
+            default:
+                break;
+            }
+            PyObject * value = make_column(owner, psf->m_columns[col].data(),
+                static_cast<Py_ssize_t>(psf->m_num_points), itemsize, format);
+            err = add_entry(val_dict, var.m_name, value, var.m_prop_dict);
+        }
+
+        PyObject * ans = nullptr;
+        if (err == 0) {
+            PyObject * props = to_dict(psf->m_prop_dict);
+            if (props != nullptr) {
+                ans = PyTuple_Pack(2, val_dict, props);
+                Py_DECREF(props);
+            }
+        }
+        Py_XDECREF(val_dict);
+        Py_DECREF(owner);
+        return ans;
+    }
+
+    PyMethodDef module_methods[] = {
+        { "read_ascii", reinterpret_cast<PyCFunction>(read_ascii), METH_VARARGS,
+          "read_ascii(filename)\n\nReturns the values and header properties of an ASCII PSF file." },
+        { nullptr, nullptr, 0, nullptr },
+    };
+
+    PyModuleDef psf_module = {
+        PyModuleDef_HEAD_INIT,
+        "_psf",
+        "Read binary and ASCII PSF files without HDF5.",
+        -1,
+        module_methods,
+    };
+
+}
+
+PyMODINIT_FUNC PyInit__psf() {
+    ColumnType.tp_basicsize = sizeof(ColumnObject);
+    ColumnType.tp_dealloc = reinterpret_cast<destructor>(column_dealloc);
+    ColumnType.tp_as_buffer = &column_as_buffer;
+    ColumnType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ColumnType.tp_doc = "Values of one PSF signal.";
+    if (PyType_Ready(&ColumnType) < 0) {
+        return nullptr;
+    }
+
+    FileType.tp_basicsize = sizeof(FileObject);
+    FileType.tp_dealloc = reinterpret_cast<destructor>(file_dealloc);
+    FileType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FileType.tp_doc = "PsfFile(filename, use_index=False)\n\nA binary PSF file opened for reading.  With use_index, the metadata is\nread from the .psfidx index next to the file, which is built first if needed.";
+    FileType.tp_methods = file_methods;
+    FileType.tp_getset = file_getset;
+    FileType.tp_init = reinterpret_cast<initproc>(file_init);
+    FileType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&FileType) < 0) {
+        return nullptr;
+    }
+
+    PyObject * module = PyModule_Create(&psf_module);
+    if (module == nullptr) {
+        return nullptr;
+    }
+    Py_INCREF(&FileType);
+    if (PyModule_AddObject(module, "PsfFile", reinterpret_cast<PyObject *>(&FileType)) < 0) {
+        Py_DECREF(&FileType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -1,110 +1,292 @@
+#include <algorithm>
+#include <limits>
+
 #include "psf.hpp"
+#include "psfreader.hpp"
+#include "psfascii.hpp"
+#include "psftable.hpp"
 
 INITIALIZE_EASYLOGGINGPP
 
 namespace psf {
 
-    std::unique_ptr<PropDict> read_header(std::ifstream& data);
-    std::unique_ptr<TypeMap> read_type(std::ifstream& data);
-    std::unique_ptr<VarList> read_sweep(std::ifstream& data);
-    std::unique_ptr<VarList> read_trace(std::ifstream& data);
-    void read_values_no_swp(std::ifstream & data, H5::H5File * file, TypeMap * type_map);
-    void read_values_swp_window(std::ifstream & data, H5::H5File * file, std::list<std::unique_ptr<H5::DataSet>> * dsets,
-        uint32_t num_points, uint32_t windowsize, std::list<TypeDef> * type_list, TypeMap * type_map);
-    void read_values_swp_simple(std::ifstream & data, H5::H5File * file, std::list<std::unique_ptr<H5::DataSet>> * dsets,
-        uint32_t num_points, uint32_t max_data_size, std::list<TypeDef> * type_list, TypeMap * type_map);
-    inline uint32_t read_section_preamble(std::ifstream & data, uint32_t section_code);
-    inline void check_section_end(std::ifstream & data, uint32_t end_pos);
-    inline void read_index(std::ifstream & data, bool is_trace);
-    void write_properties(const PropDict & prop_dict, H5::H5Location * dset);
+    std::unique_ptr<PropDict> read_header(ByteCursor & data);
+    std::unique_ptr<TypeMap> read_type(ByteCursor & data, SectionIndex * index);
+    std::unique_ptr<VarList> read_sweep(ByteCursor & data);
+    std::unique_ptr<VarList> read_trace(ByteCursor & data, SectionIndex * index);
+    void read_sections(ByteCursor & data, ConvertStats * stats, H5Lock * h5_lock, PsfSections * sections);
+    void read_values_no_swp(ByteCursor & data, H5::H5File * file, TypeMap * type_map, const ConvertOptions & opts,
+        H5Lock & h5_lock, ConvertStats * stats);
+    void read_values_swp_window(ByteCursor & data, DataSetList * dsets, uint64_t num_points, uint32_t windowsize,
+        const std::vector<const TypeDef *> & var_types, const std::vector<bool> & keep,
+        std::list<TypeDef> * type_list, const ConvertOptions & opts, H5Lock & h5_lock, WriteTarget & target,
+        ConvertStats * stats);
+    void read_values_swp_simple(ByteCursor & data, DataSetList * dsets, uint64_t num_points,
+        const std::vector<const TypeDef *> & var_types, const std::vector<uint32_t> & var_ids,
+        const std::vector<bool> & keep,
+        std::list<TypeDef> * type_list, const ConvertOptions & opts, H5Lock & h5_lock, WriteTarget & target,
+        ConvertStats * stats);
+    void read_values_nested(ByteCursor & data, H5::H5File * file, const PsfSections & sections,
+        const ConvertOptions & opts, H5Lock & h5_lock, ConvertStats * stats);
+    std::vector<uint64_t> get_skip_plan(const std::vector<uint64_t> & var_bytes, const std::vector<bool> & keep,
+        uint64_t & skip_after);
+    void check_section_end(ByteCursor & data, uint64_t end_pos);
+    inline void read_index(ByteCursor & data, bool is_trace, SectionIndex * index);
+
+    uint32_t ConvertOptions::get_block_points(size_t point_size, uint64_t num_points) const {
+        uint64_t ans = std::min(static_cast<uint64_t>(m_block_points), num_points);
+        if (point_size > 0) {
+            ans = std::min(ans, static_cast<uint64_t>(m_buffer_bytes / point_size));
+        }
+        // always make progress, even if a single point exceeds the budget.
+        return static_cast<uint32_t>(std::max(ans, static_cast<uint64_t>(1)));
+    }
+
+    uint32_t ConvertOptions::get_pipeline_blocks() const {
+        return m_pipeline ? std::max(m_pipeline_depth, static_cast<uint32_t>(2)) : 1;
+    }
+
+    uint32_t ConvertOptions::get_window_batch(size_t point_size, uint64_t num_points, uint32_t np_window) const {
+        if (np_window == 0) {
+            return 1;
+        }
+        uint64_t num_windows = num_points / np_window + ((num_points % np_window == 0) ? 0 : 1);
+        uint64_t ans = m_window_batch;
+        if (ans == 0) {
+            // auto-size from the block size and memory budget.
+            ans = get_block_points(point_size, num_points) / np_window;
+        }
+        // the points of a batch are counted in 32 bits.
+        uint64_t max_batch = std::numeric_limits<uint32_t>::max() / np_window;
+        ans = std::min(std::min(ans, num_windows), max_batch);
+        return static_cast<uint32_t>(std::max(ans, static_cast<uint64_t>(1)));
+    }
 
-    void read_psf(const std::string& psf_filename, const std::string& hdf5_filename, bool print_msg) {
-        read_psf(psf_filename, hdf5_filename, "", print_msg);
+    void read_psf(const std::string& psf_filename, const std::string& hdf5_filename, bool print_msg,
+        const ConvertOptions & opts, ConvertStats * stats) {
+        read_psf(psf_filename, hdf5_filename, "", print_msg, opts, stats);
     }
 
     void read_psf(const std::string& psf_filename, const std::string& hdf5_filename,
-        const std::string& log_filename, bool print_msg) {
+        const std::string& log_filename, bool print_msg, const ConvertOptions & opts, ConvertStats * stats) {
+        // log this conversion to its own sink, leaving other loggers alone.
+        LogScope log_scope(log_filename, print_msg);
+        convert_psf(psf_filename, hdf5_filename, opts, stats);
+    }
 
-        // set logging message format
-        el::Loggers::reconfigureAllLoggers(el::ConfigurationType::Format, "%level: %msg");
-        // set to print to stdout
-        std::string print_to_stdout = (print_msg) ? "true" : "false";
-        el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToStandardOutput, print_to_stdout);
-        // set log file.
-        if (log_filename == "") {
-            if (!print_msg) {
-                // just disable all logging
-                el::Loggers::reconfigureAllLoggers(el::ConfigurationType::Enabled, "false");
-            }
-            el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToFile, "false");
-        }
-        else {
-            el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToFile, "true");
-            el::Loggers::reconfigureAllLoggers(el::ConfigurationType::Filename, log_filename);
+    void convert_psf(const std::string& psf_filename, const std::string& hdf5_filename,
+        const ConvertOptions & opts, ConvertStats * stats) {
+
+        if (is_ascii_psf(psf_filename)) {
+            convert_psf_ascii(psf_filename, hdf5_filename, opts, stats);
+            return;
         }
+        StageTimer total_timer((stats == nullptr) ? nullptr : &stats->m_total);
 
         // open PSF file
-        std::ifstream data(psf_filename, std::ios::binary);
+        ByteCursor data(psf_filename);
         if (!data.good()) {
             throw std::runtime_error("Error opening file.");
         }
 
+        // hold the HDF5 lock whenever HDF5 is used.  Declared before all HDF5
+        // objects, so it is released after they are destroyed.
+        H5Lock h5_lock;
+
+        // read all sections before the values.  Only types use HDF5, so other
+        // conversions can run while the rest is parsed.
+        std::unique_ptr<PsfSections> sections;
+        {
+            H5Unlock h5_unlock(h5_lock);
+            sections = read_sections(data, stats, &h5_lock);
+        }
+        uint64_t value_start = data.tell();
+
         // open HDF5 file
-        auto h5_file = std::unique_ptr<H5::H5File>(new H5::H5File(hdf5_filename.c_str(), H5F_ACC_TRUNC));
+        StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+        auto h5_file = create_hdf5_file(hdf5_filename, opts);
+        create_timer.stop();
+
+        // write header properties to file
+        PSF_LOG_TRACE << "Writing header to file";
+        write_properties(*(sections->m_prop_dict.get()), h5_file.get(), stats);
+
+        // check we have at least one sweep variable.
+        if (sections->m_sweep_list->size() == 0) {
+            PSF_LOG_TRACE << "Reading values (No sweep)";
+            read_values_no_swp(data, h5_file.get(), sections->m_type_map.get(), opts, h5_lock, stats);
+        }
+        else if (sections->m_sweep_list->size() == 1) {
+            check_sweep_types(*sections);
+
+            // append the only sweep variable to front of trace list, and drop
+            // the traces the filter does not select.
+            VarList all_vars(*(sections->m_trace_list.get()));
+            all_vars.push_front(sections->m_sweep_list->front());
+            std::vector<bool> keep = select_traces(*sections, all_vars, opts);
+            VarList out_vars = get_selected(all_vars, keep);
+
+            // chunk output datasets by the number of points the reader writes per block,
+            // so every write fills whole chunks.
+            size_t max_value_size = 0;
+            hsize_t block_points = get_sweep_block_points(*sections, out_vars, opts, max_value_size);
+            H5::DSetCreatPropList dset_props = make_value_props(opts, sections->m_num_points, block_points,
+                max_value_size);
+
+            // create output datasets
+            hsize_t file_dim[1] = { sections->m_num_points };
+            H5::DataSpace file_space(1, file_dim, file_dim);
+            auto out_types = std::unique_ptr<std::list<TypeDef>>(new std::list<TypeDef>());
+            auto out_dsets = std::unique_ptr<DataSetList>(new DataSetList());
+            WriteTarget target;
+            if (opts.m_trace_matrix) {
+                create_matrix_datasets(h5_file.get(), out_vars, *(sections->m_type_map.get()), opts,
+                    sections->m_num_points, block_points, max_value_size, out_dsets.get(), out_types.get(),
+                    target, stats);
+            }
+            else {
+                auto shared_props = make_shared_props(h5_file.get(), opts);
+                create_value_datasets(h5_file.get(), out_vars, *(sections->m_type_map.get()), file_space,
+                    dset_props, out_dsets.get(), out_types.get(), stats, shared_props.get());
+            }
+            if (stats != nullptr) {
+                stats->m_num_points = sections->m_num_points;
+                stats->m_num_traces = out_vars.size() - 1;
+            }
+
+            read_values_swp(data, *sections, keep, out_dsets.get(), out_types.get(), opts, h5_lock, target,
+                stats);
+
+            // close all datasets
+            for (auto itd = out_dsets->begin(); itd != out_dsets->end(); ++itd) {
+                (*itd)->close();
+            }
+        }
+        else {
+            PSF_LOG_TRACE << "Reading values (nested sweep)";
+            read_values_nested(data, h5_file.get(), *sections, opts, h5_lock, stats);
+        }
+        if (stats != nullptr) {
+            stats->m_value_bytes = data.tell() - value_start;
+        }
+
+        PSF_LOG_TRACE << "Finished reading PSF file.";
+        h5_file->close();
+        data.close();
+    }
+
+    /**
+     * Create (or truncate) the output HDF5 file.
+     */
+    std::unique_ptr<H5::H5File> create_hdf5_file(const std::string& hdf5_filename, const ConvertOptions & opts) {
+        H5::FileAccPropList file_props;
+        if (opts.m_chunk_cache_bytes > 0) {
+            int mdc_nelmts;
+            size_t rdcc_nslots, rdcc_nbytes;
+            double rdcc_w0;
+            file_props.getCache(mdc_nelmts, rdcc_nslots, rdcc_nbytes, rdcc_w0);
+            // use a larger (prime) number of hash slots to go with a larger cache.
+            file_props.setCache(mdc_nelmts, std::max(rdcc_nslots, CHUNK_CACHE_SLOTS),
+                opts.m_chunk_cache_bytes, rdcc_w0);
+        }
+        return std::unique_ptr<H5::H5File>(new H5::H5File(hdf5_filename.c_str(), H5F_ACC_TRUNC,
+            H5::FileCreatPropList::DEFAULT, file_props));
+    }
+
+    std::unique_ptr<PsfSections> read_sections(ByteCursor & data, ConvertStats * stats, H5Lock * h5_lock) {
+        auto ans = std::unique_ptr<PsfSections>(new PsfSections());
+        try {
+            read_sections(data, stats, h5_lock, ans.get());
+        }
+        catch (...) {
+            if (h5_lock != nullptr) {
+                // release HDF5 data types while holding the lock.
+                H5Relock h5_relock(*h5_lock);
+                ans.reset();
+            }
+            throw;
+        }
+        return ans;
+    }
+
+    /**
+     * Read all sections before the value section, including the value
+     * section marker, into ans.  If h5_lock is not null, it is taken only
+     * while reading types.  If stats is not null, the parse time and the
+     * bytes of each section, with the marker that follows it, are recorded.
+     */
+    void read_sections(ByteCursor & data, ConvertStats * stats, H5Lock * h5_lock, PsfSections * ans) {
+        StageTimer timer(stats, ConvertStats::stage::METADATA_PARSE);
+        uint64_t section_start = data.tell();
 
         // read first word and throw away
         uint32_t section_marker = read_uint32(data);
-        LOG(TRACE) << "section marker = " << section_marker;
-        LOG(TRACE) << "Reading header";
-        auto prop_dict = read_header(data);
-
-        // write header properties to file
-        LOG(TRACE) << "Writing header to file";
-        write_properties(*(prop_dict.get()), h5_file.get());
+        PSF_LOG_TRACE << "section marker = " << section_marker;
+        PSF_LOG_TRACE << "Reading header";
+        ans->m_prop_dict = read_header(data);
 
         section_marker = read_uint32(data);
-        LOG(TRACE) << "section marker = " << section_marker;
+        PSF_LOG_TRACE << "section marker = " << section_marker;
+        if (stats != nullptr) {
+            stats->m_header_bytes = data.tell() - section_start;
+        }
+        section_start = data.tell();
 
-        std::unique_ptr<TypeMap> type_map;
         if (section_marker == TYPE_START) {
             // read section.
-            LOG(TRACE) << "Reading types";
-            type_map = read_type(data);
+            PSF_LOG_TRACE << "Reading types";
+            if (h5_lock != nullptr) {
+                // reading types creates HDF5 data types.
+                H5Relock h5_relock(*h5_lock);
+                ans->m_type_map = read_type(data, &ans->m_type_index);
+            }
+            else {
+                ans->m_type_map = read_type(data, &ans->m_type_index);
+            }
 
             // read next section marker.
             section_marker = read_uint32(data);
-            LOG(TRACE) << "section marker = " << section_marker;
+            PSF_LOG_TRACE << "section marker = " << section_marker;
+            if (stats != nullptr) {
+                stats->m_type_bytes = data.tell() - section_start;
+            }
+            section_start = data.tell();
         }
         else {
-            type_map = std::unique_ptr<TypeMap>(new TypeMap());
+            ans->m_type_map = std::unique_ptr<TypeMap>(new TypeMap());
         }
 
-        std::unique_ptr<VarList> sweep_list;
         if (section_marker == SWEEP_START) {
             // read section.
-            LOG(TRACE) << "Reading sweeps";
-            sweep_list = read_sweep(data);
+            PSF_LOG_TRACE << "Reading sweeps";
+            ans->m_sweep_list = read_sweep(data);
 
             // read next section marker.
             section_marker = read_uint32(data);
-            LOG(TRACE) << "section marker = " << section_marker;
+            PSF_LOG_TRACE << "section marker = " << section_marker;
+            if (stats != nullptr) {
+                stats->m_sweep_bytes = data.tell() - section_start;
+            }
+            section_start = data.tell();
         }
         else {
-            sweep_list = std::unique_ptr<VarList>(new VarList());
+            ans->m_sweep_list = std::unique_ptr<VarList>(new VarList());
         }
 
-        std::unique_ptr<VarList> trace_list;
         if (section_marker == TRACE_START) {
             // read section.
-            LOG(TRACE) << "Reading traces";
-            trace_list = read_trace(data);
+            PSF_LOG_TRACE << "Reading traces";
+            ans->m_trace_list = read_trace(data, &ans->m_trace_index);
 
             // read next section marker.
             section_marker = read_uint32(data);
-            LOG(TRACE) << "section marker = " << section_marker;
+            PSF_LOG_TRACE << "section marker = " << section_marker;
+            if (stats != nullptr) {
+                stats->m_trace_bytes = data.tell() - section_start;
+            }
         }
         else {
-            trace_list = std::unique_ptr<VarList>(new VarList());
+            ans->m_trace_list = std::unique_ptr<VarList>(new VarList());
         }
 
         // make sure that we are reading value section next
@@ -114,115 +296,384 @@ namespace psf {
             throw std::runtime_error(builder.str());
         }
 
-        // check we have at least one sweep variable.
-        if (sweep_list->size() == 0) {
-            LOG(TRACE) << "Reading values (No sweep)";
-            read_values_no_swp(data, h5_file.get(), type_map.get());
-        }
-        else {
-
-            // check that we have exactly one sweep variable.
-            if (sweep_list->size() > 1) {
-                throw std::runtime_error("Non-single sweep PSF file is not supported.  If you use ADEXL for parametric sweep this shouldn't happen.");
-            }
-
+        if (ans->m_sweep_list->size() > 0) {
             // get window size
-            uint32_t win_size;
-            auto prop_iter = prop_dict->find("PSF window size");
-            if (prop_iter == prop_dict->end()) {
-                win_size = 0;
-            }
-            else {
-                win_size = prop_iter->second.m_ival;
+            auto prop_iter = ans->m_prop_dict->find("PSF window size");
+            if (prop_iter != ans->m_prop_dict->end()) {
+                ans->m_win_size = prop_iter->second.m_ival;
             }
 
             // check that number of sweep points is recorded.
-            prop_iter = prop_dict->find("PSF sweep points");
-            if (prop_iter == prop_dict->end()) {
+            prop_iter = ans->m_prop_dict->find("PSF sweep points");
+            if (prop_iter == ans->m_prop_dict->end()) {
                 throw std::runtime_error("Cannot find PSF property \"PSF sweep points\".");
             }
-            uint32_t num_points_data = prop_iter->second.m_ival;
+            ans->m_num_points = static_cast<uint32_t>(prop_iter->second.m_ival);
+        }
+    }
 
-            // check that sweep variable type is supported
-            const Variable & swp_var = sweep_list->front();
-            const TypeDef & swp_type = type_map->at(swp_var.m_type_id);
-            if (!swp_type.m_is_supported) {
+    /**
+     * Check that the sweep and output variables of a sweep PSF file can be converted.
+     */
+    void check_sweep_types(const PsfSections & sections) {
+        // check that sweep variable types are supported
+        const TypeMap & type_map = *(sections.m_type_map.get());
+        const Variable & swp_var = sections.m_sweep_list->front();
+        const TypeDef & swp_type = type_map.at(swp_var.m_type_id);
+        for (auto sweep : *(sections.m_sweep_list.get())) {
+            const TypeDef & sweep_type = type_map.at(sweep.m_type_id);
+            if (!sweep_type.m_is_supported) {
                 std::ostringstream builder;
-                builder << "Sweep variable " << swp_var.m_name <<
+                builder << "Sweep variable " << sweep.m_name <<
+                    " with type \"" << sweep_type.m_name << "\" (data type = " <<
+                    sweep_type.m_type_name << " ) is not supported.";
+                throw std::runtime_error(builder.str());
+            }
+            if (sections.m_win_size > 0 && sweep_type.m_read_size != swp_type.m_read_size) {
+                // windows hold the same number of values of every variable.
+                std::ostringstream builder;
+                builder << "Sweep variable " << sweep.m_name <<
+                    " has a data size different than sweep variable " << swp_var.m_name <<
+                    ".  This is not expected.  Please send your PSF File to developers for debugging.";
+                throw std::runtime_error(builder.str());
+            }
+        }
+
+        // check that all output variable types are supported and legal.
+        for (auto output : *(sections.m_trace_list.get())) {
+            const TypeDef & output_type = type_map.at(output.m_type_id);
+            if (!output_type.m_is_supported) {
+                std::ostringstream builder;
+                builder << "Output variable " << output.m_name <<
+                    " with type \"" << output_type.m_name << "\" (data type = " <<
+                    output_type.m_type_name << " ) is not supported.";
+                throw std::runtime_error(builder.str());
+            }
+            if (sections.m_win_size > 0 &&
+                swp_type.m_read_size != output_type.m_read_size) {
+                // for windowed sweep, make sure sweep and all output variables
+                // have the same data size.
+                std::ostringstream builder;
+                builder << "Output variable " << output.m_name <<
+                    " with type \"" << output_type.m_name << "\" (data type = " <<
+                    output_type.m_type_name << " ) has a data size different than" <<
+                    "sweep variable " << swp_var.m_name <<
                     " with type \"" << swp_type.m_name << "\" (data type = " <<
-                    swp_type.m_type_name << " ) is not supported.";
+                    swp_type.m_type_name << " ).  This is not expected.  " <<
+                    "Please send your PSF File to developers for debugging.";
                 throw std::runtime_error(builder.str());
             }
+        }
+    }
+
+    /**
+     * Returns the number of sweep points the value readers write per block.
+     * Also returns the largest value size of out_vars in max_value_size.
+     */
+    hsize_t get_sweep_block_points(const PsfSections & sections, const VarList & out_vars,
+        const ConvertOptions & opts, size_t & max_value_size) {
+        const TypeMap & type_map = *(sections.m_type_map.get());
+        size_t point_size = 0;
+        max_value_size = 0;
+        for (auto var : out_vars) {
+            size_t cur_size = type_map.at(var.m_type_id).m_read_size;
+            point_size += cur_size;
+            max_value_size = std::max(max_value_size, cur_size);
+        }
+        if (sections.m_win_size == 0) {
+            return opts.get_block_points(point_size * opts.get_pipeline_blocks(), sections.m_num_points);
+        }
+        // full windows hold window size bytes of each variable.
+        const TypeDef & swp_type = type_map.at(sections.m_sweep_list->front().m_type_id);
+        uint32_t np_window = std::max(sections.m_win_size / static_cast<uint32_t>(swp_type.m_read_size),
+            static_cast<uint32_t>(1));
+        return static_cast<hsize_t>(np_window) * opts.get_window_batch(point_size * opts.get_pipeline_blocks(),
+            sections.m_num_points, np_window);
+    }
+
+    /**
+     * Create one value dataset with the given dataspace per output variable, and
+     * write the variable properties to it.
+     */
+    void create_value_datasets(H5::H5File * file, const VarList & out_vars, const TypeMap & type_map,
+        const H5::DataSpace & file_space, const H5::DSetCreatPropList & dset_props, DataSetList * dsets,
+        std::list<TypeDef> * out_types, ConvertStats * stats, SharedProps * shared_props) {
+        for (auto var : out_vars) {
+            PSF_LOG_TRACE << "Create " << var.m_name << " dataset";
+            const TypeDef & out_type = type_map.at(var.m_type_id);
+            StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+            auto out_dset = std::unique_ptr<H5::DataSet>(new H5::DataSet(file->createDataSet(var.m_name.c_str(),
+                out_type.m_h5_write_type, file_space, dset_props)));
+            create_timer.stop();
+            // write output properties to file.
+            PSF_LOG_TRACE << "Write " << var.m_name << " properties";
+            write_properties(var.m_prop_dict, out_dset.get(), stats, shared_props);
+            dsets->push_back(std::move(out_dset));
+            out_types->push_back(out_type);
+        }
+    }
 
-            // check that all output variable types are supported and legal.
-            for (auto output : *trace_list.get()) {
-                const TypeDef & output_type = type_map->at(output.m_type_id);
-                if (!output_type.m_is_supported) {
-                    std::ostringstream builder;
-                    builder << "Output variable " << output.m_name <<
-                        " with type \"" << output_type.m_name << "\" (data type = " <<
-                        output_type.m_type_name << " ) is not supported.";
-                    throw std::runtime_error(builder.str());
+    void create_matrix_datasets(H5::H5File * file, const VarList & out_vars, const TypeMap & type_map,
+        const ConvertOptions & opts, hsize_t num_points, hsize_t block_points, size_t max_value_size,
+        DataSetList * dsets, std::list<TypeDef> * out_types, WriteTarget & target, ConvertStats * stats) {
+        // the sweep variable keeps a 1-D dataset of its own.
+        hsize_t file_dim[1] = { num_points };
+        H5::DataSpace file_space(1, file_dim, file_dim);
+        VarList sweep_vars(out_vars.begin(), std::next(out_vars.begin()));
+        create_value_datasets(file, sweep_vars, type_map, file_space,
+            make_value_props(opts, num_points, block_points, max_value_size), dsets, out_types, stats);
+        target.m_rows.assign(1, 0);
+
+        // group traces by type, in order of first use.  Types with the same
+        // name but a different layout get a matrix of their own.
+        std::vector<const TypeDef *> matrix_types;
+        std::vector<std::string> matrix_names;
+        std::vector<std::vector<const Variable *>> matrix_vars;
+        std::vector<std::pair<size_t, size_t>> var_pos;
+        for (auto itv = std::next(out_vars.begin()); itv != out_vars.end(); ++itv) {
+            const TypeDef & type = type_map.at((*itv).m_type_id);
+            size_t idx = 0;
+            while (idx < matrix_types.size() && !(matrix_types[idx]->m_name == type.m_name &&
+                matrix_types[idx]->m_h5_write_type == type.m_h5_write_type)) {
+                ++idx;
+            }
+            if (idx == matrix_types.size()) {
+                std::string name = type.m_name;
+                for (uint32_t suffix = 1;
+                    std::find(matrix_names.begin(), matrix_names.end(), name) != matrix_names.end(); ++suffix) {
+                    name = type.m_name + "_" + std::to_string(suffix);
                 }
-                if (win_size > 0 &&
-                    (swp_type.m_h5_read_type.getSize() != output_type.m_h5_read_type.getSize())) {
-                    // for windowed sweep, make sure sweep and all output variables
-                    // have the same data size.
-                    std::ostringstream builder;
-                    builder << "Output variable " << output.m_name <<
-                        " with type \"" << output_type.m_name << "\" (data type = " <<
-                        output_type.m_type_name << " ) has a data size different than" <<
-                        "sweep variable " << swp_var.m_name <<
-                        " with type \"" << swp_type.m_name << "\" (data type = " <<
-                        swp_type.m_type_name << " ).  This is not expected.  " <<
-                        "Please send your PSF File to developers for debugging.";
-                    throw std::runtime_error(builder.str());
+                matrix_types.push_back(&type);
+                matrix_names.push_back(name);
+                matrix_vars.push_back(std::vector<const Variable *>());
+            }
+            var_pos.push_back(std::make_pair(idx, matrix_vars[idx].size()));
+            matrix_vars[idx].push_back(&(*itv));
+        }
+
+        // create one matrix per type, with rows sorted by trace name.
+        StageTimer group_timer(stats, ConvertStats::stage::HDF5_CREATE);
+        H5::Group matrix_group = file->createGroup(MATRICES_NAME);
+        group_timer.stop();
+        std::vector<H5::DataSet> matrices;
+        std::vector<std::vector<hsize_t>> var_rows;
+        for (size_t idx = 0; idx < matrix_types.size(); ++idx) {
+            const std::vector<const Variable *> & vars = matrix_vars[idx];
+            std::vector<size_t> order(vars.size());
+            for (size_t pos = 0; pos < order.size(); ++pos) {
+                order[pos] = pos;
+            }
+            std::stable_sort(order.begin(), order.end(), [&vars](size_t lhs, size_t rhs) {
+                return vars[lhs]->m_name < vars[rhs]->m_name;
+            });
+            std::vector<hsize_t> rows(vars.size());
+            std::vector<std::string> names;
+            std::vector<uint32_t> prop_rows;
+            std::vector<Property> props;
+            for (size_t row = 0; row < order.size(); ++row) {
+                const Variable & var = *vars[order[row]];
+                rows[order[row]] = row;
+                names.push_back(var.m_name);
+                for (auto itp = var.m_prop_dict.begin(); itp != var.m_prop_dict.end(); ++itp) {
+                    prop_rows.push_back(static_cast<uint32_t>(row));
+                    props.push_back(itp->second);
                 }
             }
+            var_rows.push_back(rows);
+
+            PSF_LOG_TRACE << "Create " << matrix_names[idx] << " matrix of " << vars.size() << " traces";
+            hsize_t matrix_dim[2] = { vars.size(), num_points };
+            H5::DataSpace matrix_space(2, matrix_dim, matrix_dim);
+            StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+            H5::Group group = matrix_group.createGroup(escape_link_name(matrix_names[idx]).c_str());
+            matrices.push_back(group.createDataSet("values", matrix_types[idx]->m_h5_write_type, matrix_space,
+                make_value_props(opts, num_points, block_points, max_value_size, vars.size())));
+            create_timer.stop();
+            write_name_column(&group, "names", names, stats);
+            if (!props.empty()) {
+                write_property_table(&group, prop_rows, props, stats);
+            }
+        }
 
-            // append the only sweep variable to front of trace list
-            trace_list->push_front(sweep_list->front());
+        // every trace writes its row of the matrix of its type.
+        auto itv = std::next(out_vars.begin());
+        for (size_t idx = 0; itv != out_vars.end(); ++itv, ++idx) {
+            size_t matrix = var_pos[idx].first;
+            dsets->push_back(std::unique_ptr<H5::DataSet>(new H5::DataSet(matrices[matrix])));
+            out_types->push_back(type_map.at((*itv).m_type_id));
+            target.m_rows.push_back(var_rows[matrix][var_pos[idx].second]);
+        }
+    }
 
-            // create output datasets
-            hsize_t file_dim[1] = { num_points_data };
-            size_t max_data_size = 0;
-            H5::DataSpace file_space(1, file_dim, file_dim);
-            auto out_types = std::unique_ptr<std::list<TypeDef>>(new std::list<TypeDef>());
-            auto out_dsets = std::unique_ptr<std::list<std::unique_ptr<H5::DataSet>>>(
-                new std::list<std::unique_ptr<H5::DataSet>>());
-            for (auto var : *trace_list) {
-                LOG(TRACE) << "Create " << var.m_name << " dataset";
-                const TypeDef & out_type = type_map->at(var.m_type_id);
-                max_data_size = std::max(max_data_size, out_type.m_h5_read_type.getSize());
-                auto out_dset = std::unique_ptr<H5::DataSet>(new H5::DataSet(h5_file->createDataSet(var.m_name.c_str(),
-                    out_type.m_h5_write_type, file_space)));
-                // write output properties to file.
-                LOG(TRACE) << "Write " << var.m_name << " properties";
-                write_properties(var.m_prop_dict, out_dset.get());
-                out_dsets->push_back(std::move(out_dset));
-                out_types->push_back(out_type);
-            }
-
-            if (win_size == 0) {
-                LOG(TRACE) << "Reading values (sweep simple)";
-                read_values_swp_simple(data, h5_file.get(), out_dsets.get(), num_points_data,
-                    static_cast<uint32_t>(max_data_size), out_types.get(), type_map.get());
+    /**
+     * Read the values of a nested sweep PSF file and write them to HDF5.
+     *
+     * Every point stores the values of all sweep variables, the outermost
+     * first, and the last sweep variable changes fastest.  Each sweep of
+     * the inner variable becomes one row (see WriteTarget): outer sweep variables
+     * are written as 1-D [row] datasets, the inner sweep and output variables
+     * as 2-D [row, point] datasets, and the number of points of each row as
+     * the ROW_POINTS_NAME dataset.  Rows shorter than the longest row are
+     * padded with zeros.  Rows are written as they are read, so memory use
+     * does not depend on the number of rows.
+     */
+    void read_values_nested(ByteCursor & data, H5::H5File * file, const PsfSections & sections,
+        const ConvertOptions & opts, H5Lock & h5_lock, ConvertStats * stats) {
+        check_sweep_types(sections);
+
+        // sweep variables in front of trace list, outermost first.
+        VarList all_vars(*(sections.m_sweep_list.get()));
+        all_vars.insert(all_vars.end(), sections.m_trace_list->begin(), sections.m_trace_list->end());
+        std::vector<bool> keep = select_traces(sections, all_vars, opts);
+        VarList out_vars = get_selected(all_vars, keep);
+        uint32_t num_outer = static_cast<uint32_t>(sections.m_sweep_list->size() - 1);
+
+        // the number of rows and points per row are not known up front, so
+        // datasets are chunked and extended as values are written.
+        size_t max_value_size = 0;
+        hsize_t block_points = get_sweep_block_points(sections, out_vars, opts, max_value_size);
+        hsize_t chunk = std::max(std::min(block_points, static_cast<hsize_t>(MAX_CHUNK_BYTES / std::max(max_value_size,
+            static_cast<size_t>(1)))), static_cast<hsize_t>(1));
+        H5::DSetCreatPropList outer_props = make_value_props(opts, sections.m_num_points, block_points,
+            max_value_size);
+        H5::DSetCreatPropList inner_props = make_value_props(opts, sections.m_num_points, block_points,
+            max_value_size, 1);
+        if (outer_props.getLayout() != H5D_CHUNKED) {
+            hsize_t chunk_dim[1] = { chunk };
+            outer_props.setChunk(1, chunk_dim);
+        }
+        if (inner_props.getLayout() != H5D_CHUNKED) {
+            hsize_t chunk_dim[2] = { 1, chunk };
+            inner_props.setChunk(2, chunk_dim);
+        }
+
+        hsize_t outer_dim[1] = { 0 };
+        hsize_t outer_max_dim[1] = { H5S_UNLIMITED };
+        H5::DataSpace outer_space(1, outer_dim, outer_max_dim);
+        hsize_t inner_dim[2] = { 0, 0 };
+        hsize_t inner_max_dim[2] = { H5S_UNLIMITED, H5S_UNLIMITED };
+        H5::DataSpace inner_space(2, inner_dim, inner_max_dim);
+
+        auto out_types = std::unique_ptr<std::list<TypeDef>>(new std::list<TypeDef>());
+        auto out_dsets = std::unique_ptr<DataSetList>(new DataSetList());
+        VarList outer_vars, inner_vars;
+        auto itv = out_vars.begin();
+        for (uint32_t idx = 0; itv != out_vars.end(); ++itv, ++idx) {
+            ((idx < num_outer) ? outer_vars : inner_vars).push_back(*itv);
+        }
+        auto shared_props = make_shared_props(file, opts);
+        create_value_datasets(file, outer_vars, *(sections.m_type_map.get()), outer_space, outer_props,
+            out_dsets.get(), out_types.get(), stats, shared_props.get());
+        create_value_datasets(file, inner_vars, *(sections.m_type_map.get()), inner_space, inner_props,
+            out_dsets.get(), out_types.get(), stats, shared_props.get());
+        if (stats != nullptr) {
+            stats->m_num_points = sections.m_num_points;
+            stats->m_num_traces = out_vars.size() - sections.m_sweep_list->size();
+        }
+
+        WriteTarget target;
+        target.m_num_outer = num_outer;
+        read_values_swp(data, sections, keep, out_dsets.get(), out_types.get(), opts, h5_lock, target, stats);
+        for (auto itd = out_dsets->begin(); itd != out_dsets->end(); ++itd) {
+            (*itd)->close();
+        }
+
+        // write number of points of each row
+        hsize_t row_dim[1] = { target.m_row_points.size() };
+        H5::DataSpace row_space(1, row_dim, row_dim);
+        StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+        H5::DataSet len_dset = file->createDataSet(ROW_POINTS_NAME, H5::PredType::STD_U64LE, row_space);
+        create_timer.stop();
+        StageTimer write_timer(stats, ConvertStats::stage::HDF5_WRITE);
+        std::vector<uint64_t> row_points(target.m_row_points.begin(), target.m_row_points.end());
+        len_dset.write(row_points.data(), H5::PredType::NATIVE_UINT64);
+        len_dset.close();
+        if (stats != nullptr) {
+            ++stats->m_num_write_calls;
+        }
+    }
+
+    /**
+     * Returns the sweep variables followed by the traces of a sweep PSF file,
+     * with true for the variables selected by the trace filter of opts.
+     * Sweep variables are always selected.
+     */
+    std::vector<bool> select_traces(const PsfSections & sections, const VarList & out_vars,
+        const ConvertOptions & opts) {
+        NameFilter filter(opts.m_include, opts.m_exclude, opts.m_regex);
+        size_t num_sweeps = sections.m_sweep_list->size();
+        std::vector<bool> ans;
+        auto itv = out_vars.begin();
+        for (size_t idx = 0; itv != out_vars.end(); ++itv, ++idx) {
+            ans.push_back(idx < num_sweeps || filter.match((*itv).m_name));
+        }
+        return ans;
+    }
+
+    // returns the variables of out_vars selected by keep.
+    VarList get_selected(const VarList & out_vars, const std::vector<bool> & keep) {
+        VarList ans;
+        auto itv = out_vars.begin();
+        for (size_t idx = 0; itv != out_vars.end(); ++itv, ++idx) {
+            if (keep[idx]) {
+                ans.push_back(*itv);
+            }
+        }
+        return ans;
+    }
+
+    /**
+     * Given the bytes every variable occupies in a record, returns the bytes of
+     * unwanted variables to skip before each wanted variable, so runs of
+     * unwanted variables are skipped with one seek.  The bytes to skip after
+     * the last wanted variable are returned in skip_after.
+     */
+    std::vector<uint64_t> get_skip_plan(const std::vector<uint64_t> & var_bytes, const std::vector<bool> & keep,
+        uint64_t & skip_after) {
+        std::vector<uint64_t> ans;
+        skip_after = 0;
+        for (size_t idx = 0; idx < var_bytes.size(); ++idx) {
+            if (keep[idx]) {
+                ans.push_back(skip_after);
+                skip_after = 0;
             }
             else {
-                LOG(TRACE) << "Reading values (sweep windowed)";
-                read_values_swp_window(data, h5_file.get(), out_dsets.get(), num_points_data,
-                    win_size, out_types.get(), type_map.get());
+                skip_after += var_bytes[idx];
             }
+        }
+        return ans;
+    }
 
-            // close all datasets
-            for (auto itd = out_dsets->begin(); itd != out_dsets->end(); ++itd) {
-                (*itd)->close();
-            }
+    /**
+     * Read the value section of a sweep PSF file into dsets, as described by target.
+     * keep selects the sweep and trace variables to convert; type_list and dsets
+     * hold the selected ones only.
+     */
+    void read_values_swp(ByteCursor & data, const PsfSections & sections, const std::vector<bool> & keep,
+        DataSetList * dsets, std::list<TypeDef> * type_list, const ConvertOptions & opts, H5Lock & h5_lock,
+        WriteTarget & target, ConvertStats * stats) {
+        // types and ids of all variables stored in the value section, in file order.
+        std::vector<const TypeDef *> var_types;
+        std::vector<uint32_t> var_ids;
+        for (auto var : *(sections.m_sweep_list.get())) {
+            var_types.push_back(&sections.m_type_map->at(var.m_type_id));
+            var_ids.push_back(var.m_id);
+        }
+        for (auto var : *(sections.m_trace_list.get())) {
+            var_types.push_back(&sections.m_type_map->at(var.m_type_id));
+            var_ids.push_back(var.m_id);
         }
 
-        LOG(TRACE) << "Finished reading PSF file.";
-        h5_file->close();
-        data.close();
+        if (sections.m_win_size == 0) {
+            PSF_LOG_TRACE << "Reading values (sweep simple)";
+            read_values_swp_simple(data, dsets, sections.m_num_points, var_types, var_ids, keep, type_list,
+                opts, h5_lock, target, stats);
+        }
+        else {
+            PSF_LOG_TRACE << "Reading values (sweep windowed)";
+            read_values_swp_window(data, dsets, sections.m_num_points, sections.m_win_size, var_types, keep,
+                type_list, opts, h5_lock, target, stats);
+        }
     }
 
     /**
@@ -234,9 +685,9 @@ namespace psf {
     * PropEntry entry2
     * ...
     */
-    std::unique_ptr<PropDict> read_header(std::ifstream & data) {
+    std::unique_ptr<PropDict> read_header(ByteCursor & data) {
 
-        uint32_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
+        uint64_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
 
         auto ans = std::unique_ptr<PropDict>(new PropDict());
         ans->read(data);
@@ -264,19 +715,19 @@ namespace psf {
     * int index_offset2
     * ...
     */
-    std::unique_ptr<TypeMap> read_type(std::ifstream & data) {
+    std::unique_ptr<TypeMap> read_type(ByteCursor & data, SectionIndex * index) {
 
-        uint32_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
-        uint32_t sub_end_pos = read_section_preamble(data, MINOR_SECTION_CODE);
+        uint64_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
+        uint64_t sub_end_pos = read_section_preamble(data, MINOR_SECTION_CODE);
 
         auto ans = std::unique_ptr<TypeMap>(new TypeMap());
         bool valid_type = true;
-        while (valid_type && static_cast<uint32_t>(data.tellg()) < sub_end_pos) {
+        while (valid_type && data.tell() < sub_end_pos) {
             TypeDef temp;
             valid_type = temp.read(data, ans.get());
         }
 
-        read_index(data, false);
+        read_index(data, false, index);
         check_section_end(data, end_pos);
 
         return ans;
@@ -291,11 +742,11 @@ namespace psf {
     * Variable type2
     * ...
     */
-    std::unique_ptr<VarList> read_sweep(std::ifstream & data) {
+    std::unique_ptr<VarList> read_sweep(ByteCursor & data) {
 
-        uint32_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
+        uint64_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
 
-        LOG(TRACE) << "Reading sweep types";
+        PSF_LOG_TRACE << "Reading sweep types";
         auto ans = std::unique_ptr<VarList>(new VarList());
         bool valid_type = true;
         while (valid_type) {
@@ -333,10 +784,10 @@ namespace psf {
     * int extra2
     * ...
     */
-    std::unique_ptr<VarList> read_trace(std::ifstream & data) {
+    std::unique_ptr<VarList> read_trace(ByteCursor & data, SectionIndex * index) {
 
-        uint32_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
-        uint32_t sub_end_pos = read_section_preamble(data, MINOR_SECTION_CODE);
+        uint64_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
+        uint64_t sub_end_pos = read_section_preamble(data, MINOR_SECTION_CODE);
 
         // each trace entry is either a Variable or Group.
         // however, since we're just translating PSF to HDF5,
@@ -344,7 +795,7 @@ namespace psf {
         // going to flatten everything to Variables.
         auto ans = std::unique_ptr<VarList>(new VarList());
         bool valid_type = true;
-        while (valid_type && static_cast<uint32_t>(data.tellg()) < sub_end_pos) {
+        while (valid_type && data.tell() < sub_end_pos) {
             // try reading as Group
             Group grp;
             valid_type = grp.read(data);
@@ -362,15 +813,29 @@ namespace psf {
             }
         }
 
-        read_index(data, true);
+        read_index(data, true, index);
         check_section_end(data, end_pos);
 
         return ans;
     }
 
+    // a value of a non-sweep file, decoded before it is written to HDF5.
+    class NoSwpValue {
+    public:
+        NoSwpValue() : m_type(nullptr) {}
+        ~NoSwpValue() {}
+
+        std::string m_name;
+        const TypeDef * m_type;
+        std::vector<char> m_value;
+        PropDict m_prop_dict;
+    };
+
     /**
     * This functions reads the value section when no sweep is defined, and save
-    * results to HDF5 file.
+    * results to HDF5 file.  If opts.m_value_tables is set, values are gathered
+    * into one table per type instead of one dataset each.  All values are
+    * decoded with h5_lock released, then written.
     *
     * subsection{
     * NonsweepValue val1
@@ -385,78 +850,124 @@ namespace psf {
     * int index_offset2
     * ...
     */
-    void read_values_no_swp(std::ifstream & data, H5::H5File * file, TypeMap * type_map) {
-        uint32_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
-        uint32_t sub_end_pos = read_section_preamble(data, MINOR_SECTION_CODE);
+    void read_values_no_swp(ByteCursor & data, H5::H5File * file, TypeMap * type_map, const ConvertOptions & opts,
+        H5Lock & h5_lock, ConvertStats * stats) {
+        // decode all values first without the HDF5 lock, so other conversions
+        // can use HDF5 meanwhile.
+        std::vector<NoSwpValue> values;
+        {
+            H5Unlock h5_unlock(h5_lock);
+            StageTimer decode_timer(stats, ConvertStats::stage::DECODE);
+            uint64_t end_pos = read_section_preamble(data, MAJOR_SECTION_CODE);
+            uint64_t sub_end_pos = read_section_preamble(data, MINOR_SECTION_CODE);
+
+            NameFilter filter(opts.m_include, opts.m_exclude, opts.m_regex);
+            bool valid = true;
+            while (valid && data.tell() < sub_end_pos) {
+                uint32_t code = read_uint32(data);
+                PSF_LOG_TRACE << "value code = " << code;
+                valid = (NONSWP_VAL_SECTION_CODE == code);
+                if (valid) {
+                    uint32_t var_id = read_uint32(data);
+                    PSF_LOG_TRACE << "Var id = " << var_id;
+                    std::string var_name = read_str(data);
+                    PSF_LOG_TRACE << "Var name = " << var_name;
+                    uint32_t type_id = read_uint32(data);
+                    PSF_LOG_TRACE << "Var type id = " << type_id;
+                    const TypeDef & var_type = type_map->at(type_id);
+                    PSF_LOG_TRACE << "Var type = " << var_type.m_name << ", " << var_type.m_type_name;
+
+                    // check var_type is supported.
+                    if (!var_type.m_is_supported) {
+                        std::ostringstream builder;
+                        builder << "Output variable " << var_name <<
+                            " with type \"" << var_type.m_name << "\" (data type = " <<
+                            var_type.m_type_name << " ) is not supported.";
+                        throw std::runtime_error(builder.str());
+                    }
+
+                    // skip unwanted values.
+                    if (!filter.match(var_name)) {
+                        PSF_LOG_TRACE << "Skipping " << var_name;
+                        data.skip(var_type.m_read_size);
+                        PropDict prop_dict;
+                        prop_dict.read(data);
+                        continue;
+                    }
+
+                    values.push_back(NoSwpValue());
+                    NoSwpValue & value = values.back();
+                    value.m_name = var_name;
+                    value.m_type = &var_type;
+                    value.m_value.resize(var_type.m_read_size);
+                    decode_values(var_type, data.read(var_type.m_read_size), value.m_value.data(), 1);
+                    value.m_prop_dict.read(data);
+                }
+            }
+
+            // read rest of the variable section.
+            read_index(data, false, nullptr);
+            check_section_end(data, end_pos);
+        }
 
         hsize_t file_dim[1] = { 1 };
         H5::DataSpace file_space(1, file_dim, file_dim);
         H5::DataSpace buf_space(1, file_dim, file_dim);
 
-        bool valid = true;
-        while (valid && static_cast<uint32_t>(data.tellg()) < sub_end_pos) {
-            uint32_t code = read_uint32(data);
-            LOG(TRACE) << "value code = " << code;
-            valid = (NONSWP_VAL_SECTION_CODE == code);
-            if (valid) {
-                uint32_t var_id = read_uint32(data);
-                LOG(TRACE) << "Var id = " << var_id;
-                std::string var_name = read_str(data);
-                LOG(TRACE) << "Var name = " << var_name;
-                uint32_t type_id = read_uint32(data);
-                LOG(TRACE) << "Var type id = " << type_id;
-                const TypeDef & var_type = type_map->at(type_id);
-                LOG(TRACE) << "Var type = " << var_type.m_name << ", " << var_type.m_type_name;
-
-                // check var_type is supported.
-                if (!var_type.m_is_supported) {
-                    std::ostringstream builder;
-                    builder << "Output variable " << var_name <<
-                        " with type \"" << var_type.m_name << "\" (data type = " <<
-                        var_type.m_type_name << " ) is not supported.";
-                    throw std::runtime_error(builder.str());
-                }
-
-                // create output dataset
-                auto dset = std::unique_ptr<H5::DataSet>(new H5::DataSet(
-                    file->createDataSet(var_name.c_str(), var_type.m_h5_write_type, file_space)));
-
-                // read data into buffer
-                size_t data_size = var_type.m_h5_read_type.getSize();
-                auto buf = std::unique_ptr<char[]>(new char[data_size]);
-                data.read(buf.get(), data_size);
-
-                // write to dataset
-                dset->write(buf.get(), var_type.m_h5_read_type, buf_space, file_space);
+        ValueTableSet tables;
+        auto shared_props = make_shared_props(file, opts);
+        for (auto itv = values.begin(); itv != values.end(); ++itv) {
+            const NoSwpValue & value = *itv;
+            const TypeDef & var_type = *(value.m_type);
+            if (stats != nullptr) {
+                ++stats->m_num_traces;
+            }
+            if (opts.m_value_tables) {
+                // add the value to the table of its type, written once all are added.
+                const H5::DataType & mem_type = var_type.can_swap() ? var_type.m_h5_write_type :
+                    var_type.m_h5_read_type;
+                tables.get_table(var_type.m_name, mem_type, var_type.m_h5_write_type,
+                    var_type.m_value_size).add(value.m_name, value.m_value.data(), value.m_prop_dict);
+                continue;
+            }
 
-                // read properties
-                PropDict prop_dict;
-                prop_dict.read(data);
+            // create output dataset
+            StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+            auto dset = std::unique_ptr<H5::DataSet>(new H5::DataSet(
+                file->createDataSet(value.m_name.c_str(), var_type.m_h5_write_type, file_space)));
+            create_timer.stop();
+
+            // write value to dataset
+            StageTimer write_timer(stats, ConvertStats::stage::HDF5_WRITE);
+            write_values(dset.get(), var_type, value.m_value.data(), buf_space, file_space);
+            write_timer.stop();
+            if (stats != nullptr) {
+                ++stats->m_num_write_calls;
+            }
 
-                // write properties to file.
-                write_properties(prop_dict, dset.get());
+            // write properties to file.
+            write_properties(value.m_prop_dict, dset.get(), stats, shared_props.get());
 
-                // close dataset
-                dset->close();
-            }
+            // close dataset
+            dset->close();
         }
 
-        // read rest of the variable section.
-        read_index(data, false);
-        check_section_end(data, end_pos);
+        tables.write(file, stats);
     }
 
-    void read_values_swp_window(std::ifstream & data, H5::H5File * file, std::list<std::unique_ptr<H5::DataSet>> * dsets,
-        uint32_t num_points, uint32_t windowsize, std::list<TypeDef> * type_list, TypeMap * type_map) {
-
+    /**
+     * Read the start of a windowed value section, up to the first window.
+     * Returns the number of sweep points per window.
+     */
+    uint32_t read_window_header(ByteCursor & data, uint64_t num_points) {
         read_section_preamble(data, MAJOR_SECTION_CODE);
 
         // skip zero paddings
         uint32_t zp_code = read_uint32(data);
-        LOG(TRACE) << "zero padding code = " << zp_code;
+        PSF_LOG_TRACE << "zero padding code = " << zp_code;
         uint32_t zp_size = read_uint32(data);
-        LOG(TRACE) << "zero padding size = " << zp_size << ", skipping";
-        data.seekg(zp_size, std::ios::cur);
+        PSF_LOG_TRACE << "zero padding size = " << zp_size << ", skipping";
+        data.skip(zp_size);
 
         // read window info
         uint32_t code = read_uint32(data);
@@ -469,93 +980,179 @@ namespace psf {
         uint32_t size_word = read_uint32(data);
         uint32_t size_left = size_word >> 16;
         uint32_t np_window = size_word & 0xffff;
-        LOG(TRACE) << "Size word left value = " << size_left;
-        LOG(TRACE) << "Number of valid data in window = " << np_window;
-
-        // setup HDF5 needed info
-        hsize_t file_dim[1] = { num_points };
-        H5::DataSpace file_space(1, file_dim, file_dim);
+        PSF_LOG_TRACE << "Size word left value = " << size_left;
+        PSF_LOG_TRACE << "Number of valid data in window = " << np_window;
+        if (np_window == 0 && num_points > 0) {
+            throw std::runtime_error("Number of valid data in window is 0.");
+        }
+        return np_window;
+    }
 
-        hsize_t mem_dim[1] = { np_window };
-        hsize_t file_count[1] = { np_window };
-        hsize_t mem_count[1] = { np_window };
-        hsize_t file_offset[1] = { 0 };
-        hsize_t zero_offset[1] = { 0 };
-        hsize_t unit_step[1] = { 1 };
-        H5::DataSpace mem_space(1, mem_dim, mem_dim);
-
-        // start data transfer
-        LOG(TRACE) << "Transferring data";
-        uint32_t points_read = 0;
-        auto buffer = std::unique_ptr<char[]>(new char[windowsize]);
+    /**
+     * This functions reads the value section of a windowed sweep, and save
+     * results to HDF5 file.
+     *
+     * Each window stores windowsize bytes per variable, of which the first np_window
+     * values are valid.  Consecutive windows are gathered into per-variable column
+     * buffers, and each column is written to HDF5 with a single hyperslab write
+     * per batch of windows.
+     */
+    void read_values_swp_window(ByteCursor & data, DataSetList * dsets, uint64_t num_points, uint32_t windowsize,
+        const std::vector<const TypeDef *> & var_types, const std::vector<bool> & keep,
+        std::list<TypeDef> * type_list, const ConvertOptions & opts, H5Lock & h5_lock, WriteTarget & target,
+        ConvertStats * stats) {
+
+        uint32_t np_window = read_window_header(data, num_points);
+
+        // compute number of windows per batch from the size of one sweep point.
+        // each block in flight holds one batch.
+        size_t point_size = 0;
+        for (auto itv = type_list->begin(); itv != type_list->end(); ++itv) {
+            point_size += (*itv).m_read_size;
+        }
+        uint32_t num_blocks = opts.get_pipeline_blocks();
+        uint32_t window_batch = opts.get_window_batch(point_size * num_blocks, num_points, np_window);
+        uint64_t batch_points = static_cast<uint64_t>(window_batch) * np_window;
+        PSF_LOG_TRACE << "Window batch size = " << window_batch << " windows";
+
+        // every variable takes windowsize bytes per window.
+        uint64_t skip_after;
+        std::vector<uint64_t> skip_before = get_skip_plan(std::vector<uint64_t>(var_types.size(), windowsize),
+            keep, skip_after);
+
+        // start data transfer.  HDF5 is only used by the writer while decoding.
+        PSF_LOG_TRACE << "Transferring data";
+        H5Unlock h5_unlock(h5_lock);
+        BlockWriter writer(dsets, type_list, &target, batch_points, opts.m_pipeline, num_blocks, stats);
+        uint64_t points_read = 0;
         while (points_read < num_points) {
-            // update HDF5 file offset
-            file_offset[0] = points_read;
-            file_count[0] = std::min(np_window, num_points - points_read);
-            file_space.selectHyperslab(H5S_SELECT_SET, file_count, file_offset, unit_step, unit_step);
-            // update data count
-            mem_count[0] = file_count[0];
-            mem_space.selectHyperslab(H5S_SELECT_SET, mem_count, zero_offset, unit_step, unit_step);
-
-            // write output values
-            auto itv = type_list->begin();
-            auto itd = dsets->begin();
-            for (; itv != type_list->end(); ++itv, ++itd) {
-                data.read(buffer.get(), windowsize);
-                (*itd)->write(buffer.get(), (*itv).m_h5_read_type, mem_space, file_space);
+            // gather a batch of windows into column buffers
+            ValueBlock * block = writer.acquire();
+            StageTimer decode_timer(stats, ConvertStats::stage::DECODE);
+            uint32_t num_batch = 0;
+            for (uint32_t win_idx = 0; win_idx < window_batch && points_read + num_batch < num_points; ++win_idx) {
+                uint32_t num_window = static_cast<uint32_t>(std::min(static_cast<uint64_t>(np_window),
+                    num_points - points_read - num_batch));
+                auto itv = type_list->begin();
+                for (size_t col = 0; itv != type_list->end(); ++itv, ++col) {
+                    // window values are decoded straight from the input.
+                    data.skip(skip_before[col]);
+                    decode_values(*itv, data.read(windowsize),
+                        block->m_columns[col].get() + num_batch * (*itv).m_value_size, num_window);
+                }
+                data.skip(skip_after);
+                num_batch += num_window;
             }
+            decode_timer.stop();
+
+            // write one hyperslab per column
+            block->m_offset = points_read;
+            block->m_count = num_batch;
+            writer.submit(block);
             // update number of points read
-            points_read += static_cast<uint32_t>(mem_count[0]);
+            points_read += num_batch;
         }
+        writer.finish();
     }
 
-    void read_values_swp_simple(std::ifstream & data, H5::H5File * file, std::list<std::unique_ptr<H5::DataSet>> * dsets,
-        uint32_t num_points, uint32_t max_data_size, std::list<TypeDef> * type_list, TypeMap * type_map) {
+    /**
+     * This functions reads the value section of a non-windowed sweep, and save
+     * results to HDF5 file.
+     *
+     * Each sweep point stores one (code, id, value) record per variable, so values
+     * are decoded into per-variable column buffers of up to block size points, and
+     * each column is then written to HDF5 with a single hyperslab write per block.
+     * Throws if a record does not hold the variable of var_ids expected there.
+     */
+    void read_values_swp_simple(ByteCursor & data, DataSetList * dsets, uint64_t num_points,
+        const std::vector<const TypeDef *> & var_types, const std::vector<uint32_t> & var_ids,
+        const std::vector<bool> & keep,
+        std::list<TypeDef> * type_list, const ConvertOptions & opts, H5Lock & h5_lock, WriteTarget & target,
+        ConvertStats * stats) {
 
         read_section_preamble(data, MAJOR_SECTION_CODE);
 
-        // setup HDF5 needed info
-        hsize_t file_dim[1] = { num_points };
-        H5::DataSpace file_space(1, file_dim, file_dim);
-
-        hsize_t mem_dim[1] = { 1 };
-        hsize_t count[1] = { 1 };
-        hsize_t file_offset[1] = { 0 };
-        hsize_t unit_step[1] = { 1 };
-        H5::DataSpace mem_space(1, mem_dim, mem_dim);
+        // compute block size from the size of one sweep point.
+        size_t point_size = 0;
+        for (auto itv = type_list->begin(); itv != type_list->end(); ++itv) {
+            point_size += (*itv).m_read_size;
+        }
+        uint32_t num_blocks = opts.get_pipeline_blocks();
+        uint32_t block_points = opts.get_block_points(point_size * num_blocks, num_points);
+        PSF_LOG_TRACE << "Block size = " << block_points << " points";
+
+        // every variable takes a (code, id, value) record per point.
+        std::vector<uint64_t> var_bytes;
+        for (auto itv = var_types.begin(); itv != var_types.end(); ++itv) {
+            var_bytes.push_back(2 * WORD_SIZE + (*itv)->m_read_size);
+        }
+        uint64_t skip_after;
+        std::vector<uint64_t> skip_before = get_skip_plan(var_bytes, keep, skip_after);
+        std::vector<uint32_t> keep_ids;
+        for (size_t idx = 0; idx < var_ids.size(); ++idx) {
+            if (keep[idx]) {
+                keep_ids.push_back(var_ids[idx]);
+            }
+        }
 
-        // start data transfer
-        LOG(TRACE) << "Transferring data";
-        uint32_t points_read = 0;
-        auto buffer = std::unique_ptr<char[]>(new char[max_data_size]);
+        // start data transfer.  HDF5 is only used by the writer while decoding.
+        PSF_LOG_TRACE << "Transferring data";
+        H5Unlock h5_unlock(h5_lock);
+        BlockWriter writer(dsets, type_list, &target, block_points, opts.m_pipeline, num_blocks, stats);
+        uint64_t points_read = 0;
         while (points_read < num_points) {
-            // update HDF5 file offset
-            file_offset[0] = points_read;
-            file_space.selectHyperslab(H5S_SELECT_SET, count, file_offset, unit_step, unit_step);
+            ValueBlock * block = writer.acquire();
+            StageTimer decode_timer(stats, ConvertStats::stage::DECODE);
+            uint32_t num_block = static_cast<uint32_t>(std::min(static_cast<uint64_t>(block_points),
+                num_points - points_read));
+
+            // decode one block of sweep points into column buffers
+            for (uint32_t idx = 0; idx < num_block; ++idx) {
+                auto itv = type_list->begin();
+                for (size_t col = 0; itv != type_list->end(); ++itv, ++col) {
+                    data.skip(skip_before[col]);
+                    uint32_t code = read_uint32(data);
+                    uint32_t var_id = read_uint32(data);
+                    if (code != Variable::code || var_id != keep_ids[col]) {
+                        std::ostringstream builder;
+                        builder << "Invalid value record (" << code << ", " << var_id << ") at sweep point " <<
+                            points_read + idx << ", expected (" << Variable::code << ", " << keep_ids[col] << ")";
+                        throw std::runtime_error(builder.str());
+                    }
+                    data.read(block->m_columns[col].get() + idx * (*itv).m_read_size, (*itv).m_read_size);
+                }
+                data.skip(skip_after);
+            }
 
-            // write output values
+            // decode each column in place, then write one hyperslab per column
             auto itv = type_list->begin();
-            auto itd = dsets->begin();
-            for (; itv != type_list->end(); ++itv, ++itd) {
-                uint32_t code = read_uint32(data);
-                uint32_t var_id = read_uint32(data);
-                size_t cur_size = (*itv).m_h5_read_type.getSize();
-                data.read(buffer.get(), cur_size);
-                (*itd)->write(buffer.get(), (*itv).m_h5_read_type, mem_space, file_space);
+            for (size_t col = 0; itv != type_list->end(); ++itv, ++col) {
+                decode_values(*itv, block->m_columns[col].get(), block->m_columns[col].get(), num_block);
             }
+            decode_timer.stop();
+            block->m_offset = points_read;
+            block->m_count = num_block;
+            writer.submit(block);
             // update number of points read
-            points_read += 1;
+            points_read += num_block;
         }
+        writer.finish();
+    }
+
+    uint64_t unwrap_offset(uint32_t offset, uint64_t pos) {
+        uint64_t ans = (pos & ~static_cast<uint64_t>(UINT32_MAX)) | offset;
+        return (ans < pos) ? ans + (static_cast<uint64_t>(1) << 32) : ans;
     }
 
     /**
-     * Read the section preamble.  Returns end position index.
+     * Read the section preamble.  Returns end position index, as a 64-bit
+     * file position.
      *
      * section preamble format:
      * int code = MAJOR_SECTION_CODE
      * int end_pos (end position of section).
      */
-    inline uint32_t read_section_preamble(std::ifstream & data, uint32_t section_code) {
+    uint64_t read_section_preamble(ByteCursor & data, uint32_t section_code) {
         uint32_t code = read_uint32(data);
         if (code != section_code) {
             std::ostringstream builder;
@@ -563,9 +1160,9 @@ namespace psf {
             throw std::runtime_error(builder.str());
         }
 
-        uint32_t end_pos = read_uint32(data);
-        LOG(TRACE) << "section end position = " << end_pos <<
-            ", current position = " << data.tellg();
+        uint64_t end_pos = unwrap_offset(read_uint32(data), data.tell());
+        PSF_LOG_TRACE << "section end position = " << end_pos <<
+            ", current position = " << data.tell();
 
         return end_pos;
     }
@@ -576,8 +1173,8 @@ namespace psf {
      * section end format:
      * int marker = end_marker.
      */
-    inline void check_section_end(std::ifstream & data, uint32_t end_pos) {
-        uint32_t cur_pos = static_cast<uint32_t>(data.tellg()) + sizeof(uint32_t);
+    void check_section_end(ByteCursor & data, uint64_t end_pos) {
+        uint64_t cur_pos = data.tell() + sizeof(uint32_t);
         if (cur_pos != end_pos) {
             std::ostringstream builder;
             builder << "Section end position = " << cur_pos <<
@@ -587,39 +1184,102 @@ namespace psf {
     }
 
     /**
-     * Read the index section.
+     * Read the index section.  Entries are appended to index, unless it is null.
      *
      */
-    inline void read_index(std::ifstream & data, bool is_trace) {
+    inline void read_index(ByteCursor & data, bool is_trace, SectionIndex * index) {
         uint32_t index_type = read_uint32(data);
-        LOG(TRACE) << "Type index type = " << index_type;
+        PSF_LOG_TRACE << "Type index type = " << index_type;
         uint32_t index_size = read_uint32(data);
-        LOG(TRACE) << "Type index size = " << index_size;
-        if (is_trace) {
-            // read trace information
-            int32_t id, offset, extra1, extra2;
-            for (uint32_t i = 0; i < index_size; i += 4 * WORD_SIZE) {
-                id = read_int32(data);
-                offset = read_int32(data);
-                extra1 = read_int32(data);
-                extra2 = read_int32(data);
-                LOG(TRACE) << "trace index: (0x" << std::hex << std::setfill('0') << id << std::dec <<
-                    ", " << offset << ", " << extra1 << ", " << extra2 << ")";
+        PSF_LOG_TRACE << "Type index size = " << index_size;
+        uint32_t entry_size = (is_trace ? 4 : 2) * WORD_SIZE;
+        for (uint32_t i = 0; i < index_size; i += entry_size) {
+            IndexEntry entry;
+            entry.m_id = read_uint32(data);
+            entry.m_offset = read_int32(data);
+            if (is_trace) {
+                // read trace information
+                entry.m_extra1 = read_int32(data);
+                entry.m_extra2 = read_int32(data);
+                PSF_LOG_TRACE << "trace index: (0x" << std::hex << std::setfill('0') << entry.m_id << std::dec <<
+                    ", " << entry.m_offset << ", " << entry.m_extra1 << ", " << entry.m_extra2 << ")";
+            }
+            else {
+                PSF_LOG_TRACE << "index: (" << entry.m_id << ", " << entry.m_offset << ")";
+            }
+            if (index != nullptr) {
+                index->push_back(entry);
             }
         }
+    }
+
+    /**
+     * Returns the creation property list of sweep value datasets.
+     *
+     * Datasets stay contiguous unless a chunk size or a filter is requested.  The
+     * chunk size defaults to block_points, the number of points written per block.
+     * Chunks of 2-D datasets hold part of one row.
+     */
+    H5::DSetCreatPropList make_value_props(const ConvertOptions & opts, hsize_t num_points,
+        hsize_t block_points, size_t max_value_size, hsize_t num_rows) {
+        H5::DSetCreatPropList ans;
+        bool use_filter = opts.m_deflate_level >= 0 || opts.m_shuffle || opts.m_fletcher32 ||
+            opts.m_filter_id != 0;
+        if (num_points == 0 || (opts.m_chunk_points == 0 && !use_filter)) {
+            return ans;
+        }
+
+        // chunks cannot be larger than the dataset or 4 GB.
+        hsize_t chunk = (opts.m_chunk_points > 0) ? opts.m_chunk_points : block_points;
+        chunk = std::min(chunk, num_points);
+        if (max_value_size > 0) {
+            chunk = std::min(chunk, static_cast<hsize_t>(MAX_CHUNK_BYTES / max_value_size));
+        }
+        chunk = std::max(chunk, static_cast<hsize_t>(1));
+        if (num_rows == 0) {
+            hsize_t chunk_dim[1] = { chunk };
+            ans.setChunk(1, chunk_dim);
+        }
         else {
-            // read index information
-            int32_t id, offset;
-            for (uint32_t i = 0; i < index_size; i += 2 * WORD_SIZE) {
-                id = read_int32(data);
-                offset = read_int32(data);
-                LOG(TRACE) << "index: (" << id << ", " << offset << ")";
-            }
+            hsize_t chunk_dim[2] = { 1, chunk };
+            ans.setChunk(2, chunk_dim);
         }
+        PSF_LOG_TRACE << "Value dataset chunk size = " << chunk << " points";
 
+        if (opts.m_shuffle) {
+            ans.setShuffle();
+        }
+        if (opts.m_deflate_level >= 0) {
+            if (H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0) {
+                throw std::runtime_error("HDF5 deflate filter is not available.");
+            }
+            ans.setDeflate(opts.m_deflate_level);
+        }
+        if (opts.m_filter_id != 0) {
+            if (H5Zfilter_avail(static_cast<H5Z_filter_t>(opts.m_filter_id)) <= 0) {
+                std::ostringstream builder;
+                builder << "HDF5 filter " << opts.m_filter_id << " is not available.";
+                throw std::runtime_error(builder.str());
+            }
+            ans.setFilter(static_cast<H5Z_filter_t>(opts.m_filter_id), H5Z_FLAG_MANDATORY,
+                opts.m_filter_params.size(), opts.m_filter_params.data());
+        }
+        if (opts.m_fletcher32) {
+            ans.setFletcher32();
+        }
+        return ans;
     }
 
-    void write_properties(const PropDict & prop_dict, H5::H5Location * dset) {
+    void write_properties(const PropDict & prop_dict, H5::H5Location * dset, ConvertStats * stats,
+        SharedProps * shared_props) {
+        if (shared_props != nullptr && !prop_dict.empty()) {
+            shared_props->write(prop_dict, dset, stats);
+            return;
+        }
+        StageTimer timer(stats, ConvertStats::stage::ATTRIBUTE_WRITE);
+        if (stats != nullptr) {
+            stats->m_num_attributes += prop_dict.size();
+        }
         // write properties as attributes to dataset.
         for (auto entry : prop_dict) {
             H5::DataSpace attr_space = H5::DataSpace(H5S_SCALAR);
@@ -639,7 +1299,8 @@ namespace psf {
                 attr.write(H5::PredType::IEEE_F64LE, &entry.second.m_dval);
                 break;
             case Property::type::STRING:
-                len = entry.second.m_sval.length();
+                // HDF5 strings cannot be empty.
+                len = std::max(entry.second.m_sval.length(), static_cast<size_t>(1));
                 stype = H5::StrType(H5::PredType::C_S1, len);
                 attr = dset->createAttribute(entry.second.m_name, stype, attr_space);
                 attr.write(stype, entry.second.m_sval.c_str());
@@ -654,6 +1315,71 @@ namespace psf {
         }
     }
 
+    /**
+     * Returns a string that is equal for equal property dicts, whatever the
+     * order of their entries.
+     */
+    std::string get_props_key(const PropDict & prop_dict) {
+        std::vector<const Property *> props;
+        for (auto itp = prop_dict.begin(); itp != prop_dict.end(); ++itp) {
+            props.push_back(&itp->second);
+        }
+        std::sort(props.begin(), props.end(), [](const Property * lhs, const Property * rhs) {
+            return lhs->m_name < rhs->m_name;
+        });
+        std::ostringstream builder;
+        for (auto itp = props.begin(); itp != props.end(); ++itp) {
+            const Property & prop = **itp;
+            builder << prop.m_name.size() << ':' << prop.m_name << static_cast<int>(prop.m_type) << ':';
+            switch (prop.m_type) {
+            case Property::type::INT:
+                builder << prop.m_ival << ';';
+                break;
+            case Property::type::DOUBLE:
+                // compare doubles bit for bit.
+                builder.write(reinterpret_cast<const char *>(&prop.m_dval), sizeof(double));
+                break;
+            default:
+                builder << prop.m_sval.size() << ':' << prop.m_sval;
+            }
+        }
+        return builder.str();
+    }
+
+    void SharedProps::write(const PropDict & prop_dict, H5::H5Location * loc, ConvertStats * stats) {
+        std::string key = get_props_key(prop_dict);
+        auto it = m_refs.find(key);
+        if (it == m_refs.end()) {
+            // first use of these properties, write them to a group of their own.
+            if (m_refs.empty()) {
+                m_group = m_file->createGroup(SHARED_PROPS_NAME);
+            }
+            std::string name = std::to_string(m_refs.size());
+            H5::Group group = m_group.createGroup(name.c_str());
+            write_properties(prop_dict, &group, stats);
+            group.close();
+            hobj_ref_t ref;
+            m_group.reference(&ref, name.c_str());
+            it = m_refs.emplace(key, ref).first;
+        }
+
+        StageTimer timer(stats, ConvertStats::stage::ATTRIBUTE_WRITE);
+        H5::DataSpace attr_space = H5::DataSpace(H5S_SCALAR);
+        H5::Attribute attr = loc->createAttribute(SHARED_PROPS_NAME, H5::PredType::STD_REF_OBJ, attr_space);
+        attr.write(H5::PredType::STD_REF_OBJ, &(it->second));
+        attr.close();
+        if (stats != nullptr) {
+            ++stats->m_num_attributes;
+        }
+    }
+
+    std::unique_ptr<SharedProps> make_shared_props(H5::H5File * file, const ConvertOptions & opts) {
+        if (!opts.m_intern_properties) {
+            return std::unique_ptr<SharedProps>();
+        }
+        return std::unique_ptr<SharedProps>(new SharedProps(file));
+    }
+
     /**
      * NonesweepValue format:
      * int code = nonsweep_value_code
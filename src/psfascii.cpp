@@ -0,0 +1,1135 @@
+#include <cerrno>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "psfascii.hpp"
+#include "psffilter.hpp"
+#include "psfreader.hpp"
+#include "psftable.hpp"
+
+using namespace psf;
+
+namespace {
+
+    // exact powers of ten that a double can hold.
+    static const double EXACT_POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    static constexpr int MAX_EXACT_POW10 = 22;
+    // largest integer that a double holds exactly.
+    static constexpr uint64_t MAX_EXACT_MANTISSA = uint64_t(1) << 53;
+    static constexpr int MAX_MANTISSA_DIGITS = 19;
+
+    // a token of an ASCII PSF file.
+    class Token {
+    public:
+        enum kind {STRING, WORD, LPAREN, RPAREN, END};
+
+        Token() : m_kind(kind::END), m_begin(nullptr), m_end(nullptr), m_escaped(false) {}
+        ~Token() {}
+
+        bool is_word(const char * text) const {
+            size_t len = strlen(text);
+            return m_kind == kind::WORD && static_cast<size_t>(m_end - m_begin) == len &&
+                memcmp(m_begin, text, len) == 0;
+        }
+
+        // returns the text of the token, with escapes of strings removed.
+        std::string str() const {
+            if (!m_escaped) {
+                return std::string(m_begin, m_end);
+            }
+            std::string ans;
+            for (const char * ptr = m_begin; ptr < m_end; ++ptr) {
+                if (*ptr == '\\' && ptr + 1 < m_end) {
+                    ++ptr;
+                }
+                ans += *ptr;
+            }
+            return ans;
+        }
+
+        // returns true if this is the string text.
+        bool equals(const std::string & text) const {
+            if (m_escaped) {
+                return str() == text;
+            }
+            return static_cast<size_t>(m_end - m_begin) == text.size() &&
+                memcmp(m_begin, text.data(), text.size()) == 0;
+        }
+
+        Token::kind m_kind;
+        const char * m_begin;
+        const char * m_end;
+        bool m_escaped;
+    };
+
+    // a trace, or a group of traces, as the value section lists them.
+    class TraceEntry {
+    public:
+        TraceEntry() : m_num_traces(1), m_is_group(false) {}
+        ~TraceEntry() {}
+
+        std::string m_name;
+        uint32_t m_num_traces;
+        bool m_is_group;
+    };
+
+    /**
+     * A hand-written recursive descent parser of ASCII PSF files.
+     *
+     * The file is memory-mapped and tokenized in place; only names and
+     * strings are copied.
+     */
+    class AsciiParser {
+    public:
+        explicit AsciiParser(const std::string & filename);
+        ~AsciiParser() {}
+
+        // read the header, type, sweep and trace sections.  Returns true if a value section follows.
+        bool read_preamble(AsciiPsf & psf);
+
+        // returns the number of sweep points in the value section, without parsing numbers.
+        uint64_t count_points(const AsciiPsf & psf);
+
+        // returns the types of the sweep variables followed by the traces.  Throws if not supported.
+        std::vector<const AsciiType *> get_column_types(const AsciiPsf & psf) const;
+
+        /**
+         * Read num sweep points into the column buffers, starting at point
+         * idx.  If columns is null, values are only tokenized, and may be of
+         * any type.
+         */
+        void read_points(const AsciiPsf & psf, const std::vector<const AsciiType *> & types,
+            char * const * columns, uint64_t idx, uint64_t num);
+
+        // read the values of a non-sweep file.
+        void read_values(AsciiPsf & psf);
+
+        // read the end of the file.
+        void read_end();
+
+    private:
+        const Token & peek();
+        Token next();
+        Token expect(Token::kind kind, const char * what);
+        void expect_word(const char * word);
+        [[noreturn]] void throw_error(const std::string & msg, const char * pos) const;
+
+        void read_props(PropDict & prop_dict);
+        void read_opt_props(PropDict & prop_dict);
+        void read_type_desc(AsciiType & type);
+        void read_var(AsciiVar & var);
+        void read_value(const AsciiType & type, AsciiValue & value);
+        void read_scalar(const AsciiType & type, AsciiValue & value);
+        double read_number();
+        int32_t read_int();
+        void read_column_value(const AsciiType & type, char * dst);
+        void skip_value(const AsciiType & type);
+        void skip_scalar(const AsciiType & type);
+
+        std::string m_filename;
+        std::unique_ptr<ByteCursor> m_data;
+        // file contents, if the file cannot be memory-mapped.
+        std::string m_text;
+        const char * m_begin;
+        const char * m_pos;
+        const char * m_end;
+        Token m_peek;
+        bool m_has_peek;
+        std::vector<TraceEntry> m_trace_entries;
+    };
+
+    AsciiParser::AsciiParser(const std::string & filename) : m_filename(filename), m_begin(nullptr),
+        m_pos(nullptr), m_end(nullptr), m_has_peek(false) {
+        m_data = std::unique_ptr<ByteCursor>(new ByteCursor(filename));
+        if (!m_data->good()) {
+            std::ostringstream builder;
+            builder << "Error opening file " << filename;
+            throw std::runtime_error(builder.str());
+        }
+        if (m_data->is_mapped()) {
+            m_begin = m_data->read(static_cast<size_t>(m_data->size()));
+        }
+        else {
+            m_data->close();
+            std::ifstream file(filename, std::ios::in | std::ios::binary);
+            std::ostringstream contents;
+            contents << file.rdbuf();
+            m_text = contents.str();
+            m_begin = m_text.data();
+        }
+        m_pos = m_begin;
+        m_end = m_begin + (m_data->is_mapped() ? m_data->size() : m_text.size());
+    }
+
+    void AsciiParser::throw_error(const std::string & msg, const char * pos) const {
+        // line numbers are only counted on errors.
+        size_t line = 1 + std::count(m_begin, std::min(pos, m_end), '\n');
+        std::ostringstream builder;
+        builder << m_filename << ", line " << line << ": " << msg;
+        throw std::runtime_error(builder.str());
+    }
+
+    const Token & AsciiParser::peek() {
+        if (m_has_peek) {
+            return m_peek;
+        }
+        // all control characters count as white space.
+        while (m_pos < m_end && static_cast<unsigned char>(*m_pos) <= ' ') {
+            ++m_pos;
+        }
+        m_peek = Token();
+        m_has_peek = true;
+        if (m_pos == m_end) {
+            m_peek.m_begin = m_peek.m_end = m_pos;
+            return m_peek;
+        }
+
+        const char * start = m_pos;
+        switch (*m_pos) {
+        case '"':
+            m_peek.m_kind = Token::kind::STRING;
+            m_peek.m_begin = ++m_pos;
+            for (; m_pos < m_end && *m_pos != '"'; ++m_pos) {
+                if (*m_pos == '\\') {
+                    m_peek.m_escaped = true;
+                    ++m_pos;
+                }
+            }
+            if (m_pos >= m_end) {
+                throw_error("Unterminated string.", start);
+            }
+            m_peek.m_end = m_pos++;
+            break;
+        case '(':
+        case ')':
+            m_peek.m_kind = (*m_pos == '(') ? Token::kind::LPAREN : Token::kind::RPAREN;
+            m_peek.m_begin = m_pos++;
+            m_peek.m_end = m_pos;
+            break;
+        default:
+            m_peek.m_kind = Token::kind::WORD;
+            m_peek.m_begin = m_pos;
+            while (m_pos < m_end && static_cast<unsigned char>(*m_pos) > ' ' && *m_pos != '"' &&
+                *m_pos != '(' && *m_pos != ')') {
+                ++m_pos;
+            }
+            m_peek.m_end = m_pos;
+        }
+        return m_peek;
+    }
+
+    Token AsciiParser::next() {
+        peek();
+        m_has_peek = false;
+        return m_peek;
+    }
+
+    Token AsciiParser::expect(Token::kind kind, const char * what) {
+        Token ans = next();
+        if (ans.m_kind != kind) {
+            throw_error(std::string("Expected ") + what + ", but got \"" + ans.str() + "\".", ans.m_begin);
+        }
+        return ans;
+    }
+
+    void AsciiParser::expect_word(const char * word) {
+        Token tok = next();
+        if (!tok.is_word(word)) {
+            throw_error(std::string("Expected ") + word + ", but got \"" + tok.str() + "\".", tok.m_begin);
+        }
+    }
+
+    double AsciiParser::read_number() {
+        Token tok = expect(Token::kind::WORD, "a number");
+        double ans;
+        if (!parse_double(tok.m_begin, tok.m_end, ans)) {
+            throw_error("Invalid number \"" + tok.str() + "\".", tok.m_begin);
+        }
+        return ans;
+    }
+
+    int32_t AsciiParser::read_int() {
+        Token tok = expect(Token::kind::WORD, "an integer");
+        std::string text = tok.str();
+        char * end_ptr = nullptr;
+        errno = 0;
+        long ans = std::strtol(text.c_str(), &end_ptr, 10);
+        if (text.empty() || *end_ptr != '\0' || errno != 0 || ans < INT32_MIN || ans > INT32_MAX) {
+            throw_error("Invalid integer \"" + text + "\".", tok.m_begin);
+        }
+        return static_cast<int32_t>(ans);
+    }
+
+    /**
+     * Read name/value pairs.  Numbers without a fraction or exponent are integers.
+     */
+    void AsciiParser::read_props(PropDict & prop_dict) {
+        while (peek().m_kind == Token::kind::STRING) {
+            Property prop;
+            prop.m_name = next().str();
+            Token tok = next();
+            if (tok.m_kind == Token::kind::STRING) {
+                prop.m_type = Property::type::STRING;
+                prop.m_sval = tok.str();
+            }
+            else if (tok.m_kind == Token::kind::WORD) {
+                std::string text = tok.str();
+                char * end_ptr = nullptr;
+                errno = 0;
+                long ival = std::strtol(text.c_str(), &end_ptr, 10);
+                if (*end_ptr == '\0' && errno == 0 && ival >= INT32_MIN && ival <= INT32_MAX) {
+                    prop.m_type = Property::type::INT;
+                    prop.m_ival = static_cast<int>(ival);
+                }
+                else if (parse_double(tok.m_begin, tok.m_end, prop.m_dval)) {
+                    prop.m_type = Property::type::DOUBLE;
+                }
+                else {
+                    throw_error("Invalid property value \"" + text + "\".", tok.m_begin);
+                }
+            }
+            else {
+                throw_error("Expected property value of " + prop.m_name + ".", tok.m_begin);
+            }
+            prop_dict[prop.m_name] = prop;
+        }
+    }
+
+    void AsciiParser::read_opt_props(PropDict & prop_dict) {
+        if (peek().is_word("PROP")) {
+            next();
+            expect(Token::kind::LPAREN, "(");
+            read_props(prop_dict);
+            expect(Token::kind::RPAREN, ")");
+        }
+    }
+
+    /**
+     * Read a type description, such as FLOAT DOUBLE, ARRAY ( * ) STRING *, or
+     * STRUCT( "name" type ... ).
+     */
+    void AsciiParser::read_type_desc(AsciiType & type) {
+        Token tok = next();
+        if (tok.is_word("ARRAY")) {
+            expect(Token::kind::LPAREN, "(");
+            expect_word("*");
+            expect(Token::kind::RPAREN, ")");
+            type.m_is_array = true;
+            tok = next();
+        }
+
+        if (tok.is_word("FLOAT")) {
+            type.m_kind = AsciiType::kind::FLOAT;
+            expect(Token::kind::WORD, "a float size");
+        }
+        else if (tok.is_word("INT")) {
+            type.m_kind = AsciiType::kind::INT;
+            expect(Token::kind::WORD, "an integer size");
+        }
+        else if (tok.is_word("COMPLEX")) {
+            type.m_kind = AsciiType::kind::COMPLEX;
+            expect(Token::kind::WORD, "a complex size");
+        }
+        else if (tok.is_word("STRING")) {
+            type.m_kind = AsciiType::kind::STRING;
+            expect_word("*");
+        }
+        else if (tok.is_word("STRUCT")) {
+            type.m_kind = AsciiType::kind::STRUCT;
+            expect(Token::kind::LPAREN, "(");
+            while (peek().m_kind == Token::kind::STRING) {
+                AsciiType member;
+                member.m_name = next().str();
+                read_type_desc(member);
+                read_opt_props(member.m_prop_dict);
+                type.m_members.push_back(member);
+            }
+            expect(Token::kind::RPAREN, ")");
+        }
+        else {
+            throw_error("Unknown type \"" + tok.str() + "\".", tok.m_begin);
+        }
+    }
+
+    // read the name, type name and properties of a sweep variable or trace.
+    void AsciiParser::read_var(AsciiVar & var) {
+        var.m_name = expect(Token::kind::STRING, "a name").str();
+        var.m_type_name = expect(Token::kind::STRING, "a type name").str();
+        read_opt_props(var.m_prop_dict);
+    }
+
+    bool AsciiParser::read_preamble(AsciiPsf & psf) {
+        expect_word("HEADER");
+        read_props(psf.m_prop_dict);
+
+        if (peek().is_word("TYPE")) {
+            next();
+            while (peek().m_kind == Token::kind::STRING) {
+                AsciiType type;
+                type.m_name = next().str();
+                read_type_desc(type);
+                read_opt_props(type.m_prop_dict);
+                psf.m_types.push_back(type);
+            }
+        }
+
+        if (peek().is_word("SWEEP")) {
+            next();
+            while (peek().m_kind == Token::kind::STRING) {
+                AsciiVar var;
+                read_var(var);
+                psf.m_sweeps.push_back(var);
+            }
+        }
+
+        if (peek().is_word("TRACE")) {
+            next();
+            while (peek().m_kind == Token::kind::STRING) {
+                TraceEntry entry;
+                entry.m_name = peek().str();
+                Token name_tok = next();
+                if (peek().is_word("GROUP")) {
+                    // a group lists its traces, and values of all of them follow its name.
+                    next();
+                    entry.m_is_group = true;
+                    int32_t num_traces = read_int();
+                    if (num_traces < 0) {
+                        throw_error("Invalid group size.", name_tok.m_begin);
+                    }
+                    entry.m_num_traces = static_cast<uint32_t>(num_traces);
+                    for (uint32_t idx = 0; idx < entry.m_num_traces; ++idx) {
+                        AsciiVar var;
+                        read_var(var);
+                        psf.m_traces.push_back(var);
+                    }
+                }
+                else {
+                    AsciiVar var;
+                    var.m_name = entry.m_name;
+                    var.m_type_name = expect(Token::kind::STRING, "a type name").str();
+                    read_opt_props(var.m_prop_dict);
+                    psf.m_traces.push_back(var);
+                }
+                m_trace_entries.push_back(entry);
+            }
+        }
+
+        if (peek().is_word("VALUE")) {
+            next();
+            return true;
+        }
+        return false;
+    }
+
+    // returns where to read the value of column col at point, or null if columns is null.
+    inline char * get_dst(const std::vector<const AsciiType *> & types, char * const * columns, size_t col,
+        uint64_t point) {
+        return (columns == nullptr) ? nullptr : columns[col] + point * types[col]->get_value_size();
+    }
+
+    // returns the types of the sweep variables followed by the traces.
+    std::vector<const AsciiType *> get_var_types(const AsciiPsf & psf) {
+        std::vector<const AsciiType *> ans;
+        const std::vector<AsciiVar> * lists[2] = { &psf.m_sweeps, &psf.m_traces };
+        for (int idx = 0; idx < 2; ++idx) {
+            for (auto itv = lists[idx]->begin(); itv != lists[idx]->end(); ++itv) {
+                ans.push_back(&psf.get_type((*itv).m_type_name));
+            }
+        }
+        return ans;
+    }
+
+    /**
+     * Points are counted by tokenizing the value section, skipping one value
+     * per column, so names, strings and layout are matched as read_points()
+     * matches them.  The parser then rewinds to the first point.
+     */
+    uint64_t AsciiParser::count_points(const AsciiPsf & psf) {
+        std::vector<const AsciiType *> types = get_var_types(psf);
+        const char * start = m_pos;
+        Token start_peek = m_peek;
+        bool start_has_peek = m_has_peek;
+        uint64_t ans = 0;
+        while (peek().m_kind == Token::kind::STRING) {
+            read_points(psf, types, nullptr, ans, 1);
+            ++ans;
+        }
+        m_pos = start;
+        m_peek = start_peek;
+        m_has_peek = start_has_peek;
+        return ans;
+    }
+
+    std::vector<const AsciiType *> AsciiParser::get_column_types(const AsciiPsf & psf) const {
+        std::vector<const AsciiType *> ans = get_var_types(psf);
+        for (size_t col = 0; col < ans.size(); ++col) {
+            const AsciiType & type = *ans[col];
+            if (type.m_is_array || type.get_value_size() == 0 || type.m_kind == AsciiType::kind::STRUCT) {
+                const AsciiVar & var = (col < psf.m_sweeps.size()) ? psf.m_sweeps[col] :
+                    psf.m_traces[col - psf.m_sweeps.size()];
+                std::ostringstream builder;
+                builder << "Sweep variable or trace " << var.m_name << " with type \"" <<
+                    type.m_name << "\" is not supported.";
+                throw std::runtime_error(builder.str());
+            }
+        }
+        return ans;
+    }
+
+    void AsciiParser::read_column_value(const AsciiType & type, char * dst) {
+        if (dst == nullptr) {
+            skip_value(type);
+            return;
+        }
+        switch (type.m_kind) {
+        case AsciiType::kind::FLOAT: {
+            double val = read_number();
+            memcpy(dst, &val, sizeof(val));
+            break;
+        }
+        case AsciiType::kind::INT: {
+            int32_t val = read_int();
+            memcpy(dst, &val, sizeof(val));
+            break;
+        }
+        default: {
+            expect(Token::kind::LPAREN, "(");
+            double val[2];
+            val[0] = read_number();
+            val[1] = read_number();
+            expect(Token::kind::RPAREN, ")");
+            memcpy(dst, val, sizeof(val));
+        }
+        }
+    }
+
+    // skip a value of the given type, checking only its tokens.
+    void AsciiParser::skip_value(const AsciiType & type) {
+        if (!type.m_is_array) {
+            skip_scalar(type);
+            return;
+        }
+        expect(Token::kind::LPAREN, "(");
+        while (peek().m_kind != Token::kind::RPAREN) {
+            if (peek().m_kind == Token::kind::END) {
+                throw_error("Unterminated array.", m_pos);
+            }
+            skip_scalar(type);
+        }
+        next();
+    }
+
+    void AsciiParser::skip_scalar(const AsciiType & type) {
+        switch (type.m_kind) {
+        case AsciiType::kind::FLOAT:
+            expect(Token::kind::WORD, "a number");
+            break;
+        case AsciiType::kind::INT:
+            expect(Token::kind::WORD, "an integer");
+            break;
+        case AsciiType::kind::COMPLEX:
+            expect(Token::kind::LPAREN, "(");
+            expect(Token::kind::WORD, "a number");
+            expect(Token::kind::WORD, "a number");
+            expect(Token::kind::RPAREN, ")");
+            break;
+        case AsciiType::kind::STRING:
+            expect(Token::kind::STRING, "a string");
+            break;
+        default:
+            expect(Token::kind::LPAREN, "(");
+            for (auto itm = type.m_members.begin(); itm != type.m_members.end(); ++itm) {
+                skip_value(*itm);
+            }
+            expect(Token::kind::RPAREN, ")");
+        }
+    }
+
+    void AsciiParser::read_points(const AsciiPsf & psf, const std::vector<const AsciiType *> & types,
+        char * const * columns, uint64_t idx, uint64_t num) {
+        size_t num_sweeps = psf.m_sweeps.size();
+        for (uint64_t point = idx; point < idx + num; ++point) {
+            size_t col = 0;
+            for (; col < num_sweeps; ++col) {
+                Token tok = expect(Token::kind::STRING, "a sweep variable name");
+                if (!tok.equals(psf.m_sweeps[col].m_name)) {
+                    throw_error("Expected sweep variable " + psf.m_sweeps[col].m_name + ".", tok.m_begin);
+                }
+                read_column_value(*types[col], get_dst(types, columns, col, point));
+            }
+            for (auto ite = m_trace_entries.begin(); ite != m_trace_entries.end(); ++ite) {
+                Token tok = expect(Token::kind::STRING, "a trace name");
+                if (!tok.equals((*ite).m_name)) {
+                    throw_error("Expected trace " + (*ite).m_name + ".", tok.m_begin);
+                }
+                for (uint32_t num_read = 0; num_read < (*ite).m_num_traces; ++num_read, ++col) {
+                    read_column_value(*types[col], get_dst(types, columns, col, point));
+                }
+            }
+        }
+    }
+
+    void AsciiParser::read_scalar(const AsciiType & type, AsciiValue & value) {
+        switch (type.m_kind) {
+        case AsciiType::kind::FLOAT:
+            value.m_kind = AsciiValue::kind::DOUBLE;
+            value.m_dval = read_number();
+            break;
+        case AsciiType::kind::INT:
+            value.m_kind = AsciiValue::kind::INT;
+            value.m_ival = read_int();
+            break;
+        case AsciiType::kind::COMPLEX: {
+            value.m_kind = AsciiValue::kind::COMPLEX;
+            expect(Token::kind::LPAREN, "(");
+            double real = read_number();
+            double imag = read_number();
+            expect(Token::kind::RPAREN, ")");
+            value.m_cval = std::complex<double>(real, imag);
+            break;
+        }
+        case AsciiType::kind::STRING:
+            value.m_kind = AsciiValue::kind::STRING;
+            value.m_sval = expect(Token::kind::STRING, "a string").str();
+            break;
+        default:
+            value.m_kind = AsciiValue::kind::LIST;
+            expect(Token::kind::LPAREN, "(");
+            value.m_items.resize(type.m_members.size());
+            for (size_t idx = 0; idx < type.m_members.size(); ++idx) {
+                read_value(type.m_members[idx], value.m_items[idx]);
+            }
+            expect(Token::kind::RPAREN, ")");
+        }
+    }
+
+    void AsciiParser::read_value(const AsciiType & type, AsciiValue & value) {
+        if (!type.m_is_array) {
+            read_scalar(type, value);
+            return;
+        }
+        value.m_kind = AsciiValue::kind::LIST;
+        expect(Token::kind::LPAREN, "(");
+        while (peek().m_kind != Token::kind::RPAREN) {
+            if (peek().m_kind == Token::kind::END) {
+                throw_error("Unterminated array.", m_pos);
+            }
+            value.m_items.push_back(AsciiValue());
+            read_scalar(type, value.m_items.back());
+        }
+        next();
+    }
+
+    // each value is: "name" "type name" value PROP( ... )
+    void AsciiParser::read_values(AsciiPsf & psf) {
+        while (peek().m_kind == Token::kind::STRING) {
+            AsciiVar var;
+            var.m_name = next().str();
+            var.m_type_name = expect(Token::kind::STRING, "a type name").str();
+            read_value(psf.get_type(var.m_type_name), var.m_value);
+            read_opt_props(var.m_prop_dict);
+            psf.m_values.push_back(var);
+        }
+    }
+
+    // some files, such as simRunData, end without an END marker.
+    void AsciiParser::read_end() {
+        if (peek().m_kind != Token::kind::END) {
+            expect_word("END");
+        }
+    }
+
+    /**
+     * Returns the HDF5 data types of values of the given type, in memory and
+     * in the file.  Returns false if values hold strings or arrays.
+     */
+    bool get_h5_types(const AsciiType & type, H5::DataType & mem_type, H5::DataType & file_type) {
+        if (type.m_is_array) {
+            return false;
+        }
+        switch (type.m_kind) {
+        case AsciiType::kind::FLOAT:
+            mem_type = H5::PredType::NATIVE_DOUBLE;
+            file_type = H5::PredType::IEEE_F64LE;
+            return true;
+        case AsciiType::kind::INT:
+            mem_type = H5::PredType::NATIVE_INT32;
+            file_type = H5::PredType::STD_I32LE;
+            return true;
+        case AsciiType::kind::COMPLEX: {
+            H5::CompType mem_comp(2 * sizeof(double));
+            mem_comp.insertMember("r", 0, H5::PredType::NATIVE_DOUBLE);
+            mem_comp.insertMember("i", sizeof(double), H5::PredType::NATIVE_DOUBLE);
+            H5::CompType file_comp(2 * sizeof(double));
+            file_comp.insertMember("r", 0, H5::PredType::IEEE_F64LE);
+            file_comp.insertMember("i", sizeof(double), H5::PredType::IEEE_F64LE);
+            mem_type = mem_comp;
+            file_type = file_comp;
+            return true;
+        }
+        case AsciiType::kind::STRUCT: {
+            size_t size = type.get_value_size();
+            if (size == 0) {
+                return false;
+            }
+            H5::CompType mem_comp(size);
+            H5::CompType file_comp(size);
+            size_t offset = 0;
+            for (auto itm = type.m_members.begin(); itm != type.m_members.end(); ++itm) {
+                H5::DataType mem_member, file_member;
+                if (!get_h5_types(*itm, mem_member, file_member)) {
+                    return false;
+                }
+                mem_comp.insertMember((*itm).m_name, offset, mem_member);
+                file_comp.insertMember((*itm).m_name, offset, file_member);
+                offset += (*itm).get_value_size();
+            }
+            mem_type = mem_comp;
+            file_type = file_comp;
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    // write a value in native layout to dst.  Returns the number of bytes written.
+    size_t pack_value(const AsciiValue & value, char * dst) {
+        switch (value.m_kind) {
+        case AsciiValue::kind::DOUBLE:
+            memcpy(dst, &value.m_dval, sizeof(double));
+            return sizeof(double);
+        case AsciiValue::kind::INT:
+            memcpy(dst, &value.m_ival, sizeof(int32_t));
+            return sizeof(int32_t);
+        case AsciiValue::kind::COMPLEX:
+            memcpy(dst, &value.m_cval, sizeof(std::complex<double>));
+            return sizeof(std::complex<double>);
+        case AsciiValue::kind::LIST: {
+            size_t ans = 0;
+            for (auto iti = value.m_items.begin(); iti != value.m_items.end(); ++iti) {
+                ans += pack_value(*iti, dst + ans);
+            }
+            return ans;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * Returns the TypeDef of a sweep variable or trace, so the values can be
+     * written by the binary PSF writer.  Values are parsed in native layout,
+     * so the read type is the native type and nothing is byte swapped.
+     */
+    TypeDef make_type_def(uint32_t id, const AsciiType & type) {
+        TypeDef ans;
+        ans.m_id = id;
+        ans.m_name = type.m_name;
+        ans.m_array_type = 0;
+        ans.m_is_supported = true;
+        ans.m_read_size = type.get_value_size();
+        ans.m_value_size = ans.m_read_size;
+        get_h5_types(type, ans.m_h5_read_type, ans.m_h5_write_type);
+        switch (type.m_kind) {
+        case AsciiType::kind::FLOAT:
+            ans.m_data_type = TypeDef::TYPEID_DOUBLE;
+            ans.m_type_name = "double";
+            break;
+        case AsciiType::kind::INT:
+            ans.m_data_type = TypeDef::TYPEID_INT32;
+            ans.m_type_name = "int32";
+            break;
+        default:
+            ans.m_data_type = TypeDef::TYPEID_COMPLEXDOUBLE;
+            ans.m_type_name = "complex";
+        }
+        return ans;
+    }
+
+    // largest encoded data type that fits in an HDF5 object header message.
+    static constexpr size_t MAX_TYPE_MESSAGE_SIZE = 65535;
+
+    /**
+     * Write a numeric value to a 1-element dataset of loc.  Structs whose
+     * compound type is too large for an HDF5 object header, such as the
+     * thousands of parameters of designParamVals, are written as a group
+     * with one dataset per member instead.  Returns false if the value holds
+     * strings or arrays.
+     */
+    template <typename Location>
+    bool write_ascii_value(Location * loc, const std::string & name, const AsciiType & type,
+        const AsciiValue & value, const PropDict & prop_dict, ConvertStats * stats, SharedProps * shared_props) {
+        H5::DataType mem_type, file_type;
+        if (!get_h5_types(type, mem_type, file_type)) {
+            return false;
+        }
+
+        size_t type_size = 0;
+        H5Tencode(file_type.getId(), nullptr, &type_size);
+        if (type.m_kind == AsciiType::kind::STRUCT && type_size > MAX_TYPE_MESSAGE_SIZE) {
+            H5::Group group = loc->createGroup(name.c_str());
+            for (size_t idx = 0; idx < type.m_members.size(); ++idx) {
+                write_ascii_value(&group, type.m_members[idx].m_name, type.m_members[idx], value.m_items[idx],
+                    type.m_members[idx].m_prop_dict, stats, shared_props);
+            }
+            write_properties(prop_dict, &group, stats, shared_props);
+            group.close();
+            return true;
+        }
+
+        hsize_t file_dim[1] = { 1 };
+        H5::DataSpace file_space(1, file_dim, file_dim);
+        std::vector<char> buffer(type.get_value_size());
+        pack_value(value, buffer.data());
+        StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+        H5::DataSet dset = loc->createDataSet(name.c_str(), file_type, file_space);
+        create_timer.stop();
+        StageTimer write_timer(stats, ConvertStats::stage::HDF5_WRITE);
+        dset.write(buffer.data(), mem_type, file_space, file_space);
+        write_timer.stop();
+        if (stats != nullptr) {
+            ++stats->m_num_write_calls;
+        }
+        write_properties(prop_dict, &dset, stats, shared_props);
+        dset.close();
+        return true;
+    }
+
+    /**
+     * Add a numeric value to the table of its type.  Returns false if the value
+     * holds strings or arrays, or is a struct too large for a table row.
+     */
+    bool add_table_value(ValueTableSet & tables, const std::string & name, const AsciiType & type,
+        const AsciiValue & value, const PropDict & prop_dict) {
+        H5::DataType mem_type, file_type;
+        if (!get_h5_types(type, mem_type, file_type)) {
+            return false;
+        }
+        size_t type_size = 0;
+        H5Tencode(file_type.getId(), nullptr, &type_size);
+        if (type_size > MAX_TYPE_MESSAGE_SIZE) {
+            return false;
+        }
+        std::vector<char> buffer(type.get_value_size());
+        pack_value(value, buffer.data());
+        tables.get_table(type.m_name, mem_type, file_type, buffer.size()).add(name, buffer.data(), prop_dict);
+        return true;
+    }
+
+    /**
+     * Write the numeric values of a non-sweep file to HDF5.  With
+     * opts.m_value_tables, values are written as one table per type, except
+     * those that do not fit a table row.
+     */
+    void write_ascii_values(const AsciiPsf & psf, H5::H5File * file, const ConvertOptions & opts,
+        ConvertStats * stats) {
+        ValueTableSet tables;
+        auto shared_props = make_shared_props(file, opts);
+        for (auto itv = psf.m_values.begin(); itv != psf.m_values.end(); ++itv) {
+            const AsciiType & type = psf.get_type((*itv).m_type_name);
+            if (opts.m_value_tables && add_table_value(tables, (*itv).m_name, type, (*itv).m_value,
+                (*itv).m_prop_dict)) {
+                if (stats != nullptr) {
+                    ++stats->m_num_traces;
+                }
+            }
+            else if (!write_ascii_value(file, (*itv).m_name, type, (*itv).m_value, (*itv).m_prop_dict, stats,
+                shared_props.get())) {
+                PSF_LOG_TRACE << "Skipping " << (*itv).m_name << ", values of type " << type.m_name <<
+                    " hold strings or arrays";
+            }
+            else if (stats != nullptr) {
+                ++stats->m_num_traces;
+            }
+        }
+        tables.write(file, stats);
+    }
+
+    void check_single_sweep(const AsciiPsf & psf) {
+        if (psf.m_sweeps.size() > 1) {
+            throw std::runtime_error("Nested sweeps in ASCII PSF files are not supported.");
+        }
+    }
+
+}
+
+size_t AsciiType::get_value_size() const {
+    if (m_is_array) {
+        return 0;
+    }
+    switch (m_kind) {
+    case kind::FLOAT:
+        return sizeof(double);
+    case kind::INT:
+        return sizeof(int32_t);
+    case kind::COMPLEX:
+        return sizeof(std::complex<double>);
+    case kind::STRUCT: {
+        size_t ans = 0;
+        for (auto itm = m_members.begin(); itm != m_members.end(); ++itm) {
+            size_t size = (*itm).get_value_size();
+            if (size == 0) {
+                return 0;
+            }
+            ans += size;
+        }
+        return ans;
+    }
+    default:
+        return 0;
+    }
+}
+
+const AsciiType & AsciiPsf::get_type(const std::string & type_name) const {
+    for (auto itt = m_types.begin(); itt != m_types.end(); ++itt) {
+        if ((*itt).m_name == type_name) {
+            return *itt;
+        }
+    }
+    std::ostringstream builder;
+    builder << "Type " << type_name << " is not defined.";
+    throw std::runtime_error(builder.str());
+}
+
+bool psf::parse_double(const char * begin, const char * end, double & ans) {
+    const char * ptr = begin;
+    bool negative = false;
+    if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+        negative = (*ptr == '-');
+        ++ptr;
+    }
+
+    // collect up to MAX_MANTISSA_DIGITS significant digits.
+    uint64_t mantissa = 0;
+    int num_digits = 0;
+    int exp10 = 0;
+    bool exact = true;
+    bool any_digit = false;
+    for (; ptr < end && *ptr >= '0' && *ptr <= '9'; ++ptr) {
+        any_digit = true;
+        if (num_digits < MAX_MANTISSA_DIGITS) {
+            mantissa = mantissa * 10 + (*ptr - '0');
+            num_digits += (mantissa > 0) ? 1 : 0;
+        }
+        else {
+            exact = false;
+        }
+    }
+    if (ptr < end && *ptr == '.') {
+        for (++ptr; ptr < end && *ptr >= '0' && *ptr <= '9'; ++ptr) {
+            any_digit = true;
+            if (num_digits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + (*ptr - '0');
+                num_digits += (mantissa > 0) ? 1 : 0;
+                --exp10;
+            }
+            else {
+                exact = false;
+            }
+        }
+    }
+    if (any_digit && ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+        const char * exp_start = ptr++;
+        bool exp_negative = false;
+        if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+            exp_negative = (*ptr == '-');
+            ++ptr;
+        }
+        int exp_val = 0;
+        bool exp_digit = false;
+        for (; ptr < end && *ptr >= '0' && *ptr <= '9'; ++ptr) {
+            exp_digit = true;
+            exp_val = std::min(exp_val * 10 + (*ptr - '0'), 100000);
+        }
+        if (!exp_digit) {
+            ptr = exp_start;
+        }
+        exp10 += exp_negative ? -exp_val : exp_val;
+    }
+
+    if (any_digit && ptr == end && exact && mantissa <= MAX_EXACT_MANTISSA &&
+        exp10 >= -MAX_EXACT_POW10 && exp10 <= MAX_EXACT_POW10) {
+        // both the mantissa and the power of ten are exact, so one rounding gives the correct result.
+        double val = static_cast<double>(mantissa);
+        val = (exp10 < 0) ? val / EXACT_POW10[-exp10] : val * EXACT_POW10[exp10];
+        ans = negative ? -val : val;
+        return true;
+    }
+
+    // slow path: also handles nan, inf and long mantissas.
+    std::string text(begin, end);
+    char * end_ptr = nullptr;
+    ans = std::strtod(text.c_str(), &end_ptr);
+    return !text.empty() && *end_ptr == '\0';
+}
+
+bool psf::is_ascii_psf(const std::string & filename) {
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    char buf[6];
+    return file.read(buf, sizeof(buf)) && memcmp(buf, "HEADER", sizeof(buf)) == 0;
+}
+
+std::unique_ptr<AsciiPsf> psf::read_psf_ascii(const std::string & psf_filename) {
+    auto ans = std::unique_ptr<AsciiPsf>(new AsciiPsf());
+    AsciiParser parser(psf_filename);
+    if (parser.read_preamble(*ans)) {
+        check_single_sweep(*ans);
+        if (ans->m_sweeps.empty()) {
+            parser.read_values(*ans);
+        }
+        else {
+            std::vector<const AsciiType *> types = parser.get_column_types(*ans);
+            ans->m_num_points = parser.count_points(*ans);
+            std::vector<char *> columns;
+            for (size_t col = 0; col < types.size(); ++col) {
+                ans->m_columns.push_back(std::vector<char>(ans->m_num_points * types[col]->get_value_size()));
+                columns.push_back(ans->m_columns.back().data());
+            }
+            parser.read_points(*ans, types, columns.data(), 0, ans->m_num_points);
+        }
+    }
+    parser.read_end();
+    return ans;
+}
+
+std::unique_ptr<AsciiPsf> psf::scan_psf_ascii(const std::string & psf_filename) {
+    auto ans = std::unique_ptr<AsciiPsf>(new AsciiPsf());
+    AsciiParser parser(psf_filename);
+    if (parser.read_preamble(*ans) && !ans->m_sweeps.empty()) {
+        check_single_sweep(*ans);
+        ans->m_num_points = parser.count_points(*ans);
+    }
+    return ans;
+}
+
+void psf::convert_psf_ascii(const std::string & psf_filename, const std::string & hdf5_filename,
+    const ConvertOptions & opts, ConvertStats * stats) {
+    StageTimer total_timer((stats == nullptr) ? nullptr : &stats->m_total);
+
+    AsciiPsf psf;
+    AsciiParser parser(psf_filename);
+    PSF_LOG_TRACE << "Reading ASCII PSF file " << psf_filename;
+    StageTimer parse_timer(stats, ConvertStats::stage::METADATA_PARSE);
+    bool has_values = parser.read_preamble(psf);
+    check_single_sweep(psf);
+    parse_timer.stop();
+
+    // parse values of non-sweep files, and count sweep points, before HDF5 is used.
+    uint64_t num_points = 0;
+    if (has_values && psf.m_sweeps.empty()) {
+        StageTimer decode_timer(stats, ConvertStats::stage::DECODE);
+        parser.read_values(psf);
+    }
+    else if (has_values) {
+        num_points = parser.count_points(psf);
+        PSF_LOG_TRACE << "Number of sweep points = " << num_points;
+    }
+
+    // hold the HDF5 lock whenever HDF5 is used.  Declared before all HDF5
+    // objects, so it is released after they are destroyed.
+    H5Lock h5_lock;
+
+    StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+    auto h5_file = create_hdf5_file(hdf5_filename, opts);
+    create_timer.stop();
+    PSF_LOG_TRACE << "Writing header to file";
+    write_properties(psf.m_prop_dict, h5_file.get(), stats);
+
+    if (has_values && psf.m_sweeps.empty()) {
+        write_ascii_values(psf, h5_file.get(), opts, stats);
+    }
+    else if (has_values) {
+        // sweep variable first, then the traces the filter selects.
+        std::vector<const AsciiType *> types = parser.get_column_types(psf);
+        NameFilter filter(opts.m_include, opts.m_exclude, opts.m_regex);
+        std::vector<bool> keep;
+        TypeMap type_map;
+        VarList out_vars;
+        size_t point_size = 0;
+        size_t max_value_size = 0;
+        for (size_t col = 0; col < types.size(); ++col) {
+            const AsciiVar & ascii_var = (col < psf.m_sweeps.size()) ? psf.m_sweeps[col] :
+                psf.m_traces[col - psf.m_sweeps.size()];
+            keep.push_back(col < psf.m_sweeps.size() || filter.match(ascii_var.m_name));
+            max_value_size = std::max(max_value_size, types[col]->get_value_size());
+            if (!keep.back()) {
+                continue;
+            }
+            uint32_t type_id = static_cast<uint32_t>(col);
+            type_map.emplace(type_id, make_type_def(type_id, *types[col]));
+            Variable var;
+            var.m_id = type_id;
+            var.m_name = ascii_var.m_name;
+            var.m_type_id = type_id;
+            var.m_prop_dict = ascii_var.m_prop_dict;
+            out_vars.push_back(var);
+            point_size += types[col]->get_value_size();
+        }
+
+        uint32_t num_blocks = opts.get_pipeline_blocks();
+        uint32_t block_points = opts.get_block_points(point_size * num_blocks, num_points);
+        H5::DSetCreatPropList dset_props = make_value_props(opts, num_points, block_points, max_value_size);
+        hsize_t file_dim[1] = { num_points };
+        H5::DataSpace file_space(1, file_dim, file_dim);
+        auto out_types = std::unique_ptr<std::list<TypeDef>>(new std::list<TypeDef>());
+        auto out_dsets = std::unique_ptr<DataSetList>(new DataSetList());
+        WriteTarget target;
+        if (opts.m_trace_matrix) {
+            create_matrix_datasets(h5_file.get(), out_vars, type_map, opts, num_points, block_points,
+                max_value_size, out_dsets.get(), out_types.get(), target, stats);
+        }
+        else {
+            auto shared_props = make_shared_props(h5_file.get(), opts);
+            create_value_datasets(h5_file.get(), out_vars, type_map, file_space, dset_props,
+                out_dsets.get(), out_types.get(), stats, shared_props.get());
+        }
+        if (stats != nullptr) {
+            stats->m_num_points = num_points;
+            stats->m_num_traces = out_vars.size() - psf.m_sweeps.size();
+        }
+
+        {
+            // parse values while the writer writes the previous block.
+            PSF_LOG_TRACE << "Transferring data";
+            H5Unlock h5_unlock(h5_lock);
+            BlockWriter writer(out_dsets.get(), out_types.get(), &target, block_points, opts.m_pipeline,
+                num_blocks, stats);
+            // values of unselected traces are parsed into a scratch buffer.
+            std::vector<char> scratch(static_cast<size_t>(block_points) * max_value_size);
+            std::vector<char *> columns(types.size());
+            uint64_t points_read = 0;
+            while (points_read < num_points) {
+                ValueBlock * block = writer.acquire();
+                StageTimer decode_timer(stats, ConvertStats::stage::DECODE);
+                uint32_t num_block = static_cast<uint32_t>(std::min(static_cast<uint64_t>(block_points),
+                    num_points - points_read));
+                for (size_t col = 0, out_col = 0; col < types.size(); ++col) {
+                    columns[col] = keep[col] ? block->m_columns[out_col++].get() : scratch.data();
+                }
+                parser.read_points(psf, types, columns.data(), 0, num_block);
+                decode_timer.stop();
+                block->m_offset = points_read;
+                block->m_count = num_block;
+                writer.submit(block);
+                points_read += num_block;
+            }
+            writer.finish();
+        }
+
+        for (auto itd = out_dsets->begin(); itd != out_dsets->end(); ++itd) {
+            (*itd)->close();
+        }
+    }
+    parser.read_end();
+
+    PSF_LOG_TRACE << "Finished reading ASCII PSF file.";
+    h5_file->close();
+}
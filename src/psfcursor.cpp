@@ -0,0 +1,195 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "psfcursor.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace psf;
+
+
+/**
+ * Open the given file.  Regular files are memory-mapped; if that fails
+ * (or the file is not a regular file) fall back to a buffered stream.
+ */
+ByteCursor::ByteCursor(const std::string & filename) : m_good(false), m_pos(0), m_size(0),
+    m_map(nullptr), m_buf_start(0), m_buf_len(0) {
+#ifdef _WIN32
+    m_file_handle = nullptr;
+    m_map_handle = nullptr;
+    HANDLE fh = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (fh != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER fsize;
+        if (GetFileType(fh) == FILE_TYPE_DISK && GetFileSizeEx(fh, &fsize) && fsize.QuadPart > 0) {
+            HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mh != NULL) {
+                void * addr = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+                if (addr != NULL) {
+                    m_map = static_cast<const char *>(addr);
+                    m_size = static_cast<uint64_t>(fsize.QuadPart);
+                    m_map_handle = mh;
+                    m_file_handle = fh;
+                    m_good = true;
+                    return;
+                }
+                CloseHandle(mh);
+            }
+        }
+        CloseHandle(fh);
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void * addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                // PSF files are parsed front to back.
+                madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                m_map = static_cast<const char *>(addr);
+                m_size = static_cast<uint64_t>(st.st_size);
+                m_good = true;
+            }
+        }
+        ::close(fd);
+        if (m_good) {
+            return;
+        }
+    }
+#endif
+
+    // fall back to buffered stream.
+    m_stream.open(filename, std::ios::binary);
+    m_good = m_stream.good();
+    if (m_good) {
+        m_buf.resize(STREAM_BUFFER_SIZE);
+    }
+}
+
+ByteCursor::~ByteCursor() {
+    close();
+}
+
+void ByteCursor::close() {
+    if (m_map != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_map);
+        CloseHandle(static_cast<HANDLE>(m_map_handle));
+        CloseHandle(static_cast<HANDLE>(m_file_handle));
+#else
+        munmap(const_cast<char *>(m_map), static_cast<size_t>(m_size));
+#endif
+        m_map = nullptr;
+    }
+    if (m_stream.is_open()) {
+        m_stream.close();
+    }
+    m_good = false;
+}
+
+/**
+ * Stream mode read.  Make sure [m_pos, m_pos + num) is in the buffer,
+ * refilling it from the stream if necessary.
+ */
+const char * ByteCursor::read_stream(size_t num) {
+    uint64_t buf_end = m_buf_start + m_buf_len;
+    if (m_pos + num > buf_end) {
+        // keep a few bytes behind the cursor so unread() still works.
+        size_t keep_from = static_cast<size_t>(m_pos - m_buf_start);
+        keep_from = (keep_from > STREAM_KEEP_SIZE) ? keep_from - STREAM_KEEP_SIZE : 0;
+        size_t keep_len = m_buf_len - keep_from;
+        memmove(m_buf.data(), m_buf.data() + keep_from, keep_len);
+        m_buf_start += keep_from;
+        m_buf_len = keep_len;
+
+        size_t need = static_cast<size_t>(m_pos - m_buf_start) + num;
+        if (need > m_buf.size()) {
+            m_buf.resize(need);
+        }
+        while (m_buf_len < need) {
+            m_stream.read(m_buf.data() + m_buf_len, m_buf.size() - m_buf_len);
+            size_t num_read = static_cast<size_t>(m_stream.gcount());
+            if (num_read == 0) {
+                throw_eof(num);
+            }
+            m_buf_len += num_read;
+        }
+    }
+    const char * ans = m_buf.data() + (m_pos - m_buf_start);
+    m_pos += num;
+    return ans;
+}
+
+void ByteCursor::skip(uint64_t num) {
+    if (m_map != nullptr) {
+        if (num > m_size - m_pos) {
+            throw_eof(static_cast<size_t>(num));
+        }
+        m_pos += num;
+        return;
+    }
+
+    uint64_t buf_end = m_buf_start + m_buf_len;
+    if (m_pos + num <= buf_end) {
+        m_pos += num;
+        return;
+    }
+    // discard the buffer and skip the rest in the stream.
+    uint64_t left = m_pos + num - buf_end;
+    m_stream.ignore(static_cast<std::streamsize>(left));
+    if (static_cast<uint64_t>(m_stream.gcount()) != left) {
+        throw_eof(static_cast<size_t>(num));
+    }
+    m_pos += num;
+    m_buf_start = m_pos;
+    m_buf_len = 0;
+}
+
+void ByteCursor::unread(size_t num) {
+    uint64_t min_pos = (m_map != nullptr) ? 0 : m_buf_start;
+    if (m_pos < min_pos + num) {
+        throw std::runtime_error("Cannot move PSF read cursor before buffered data.");
+    }
+    m_pos -= num;
+}
+
+void ByteCursor::seek(uint64_t pos) {
+    if (m_map != nullptr) {
+        if (pos > m_size) {
+            throw_eof(0);
+        }
+        m_pos = pos;
+        return;
+    }
+
+    if (pos >= m_buf_start && pos <= m_buf_start + m_buf_len) {
+        m_pos = pos;
+        return;
+    }
+    // discard the buffer and reposition the stream.
+    m_stream.clear();
+    m_stream.seekg(static_cast<std::streamoff>(pos));
+    if (!m_stream.good()) {
+        std::ostringstream builder;
+        builder << "Cannot seek PSF file to position " << pos;
+        throw std::runtime_error(builder.str());
+    }
+    m_pos = pos;
+    m_buf_start = pos;
+    m_buf_len = 0;
+}
+
+void ByteCursor::throw_eof(size_t num) const {
+    std::ostringstream builder;
+    builder << "Unexpected end of PSF file: cannot read " << num <<
+        " bytes at position " << m_pos;
+    throw std::runtime_error(builder.str());
+}
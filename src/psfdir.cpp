@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <direct.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+#include <errno.h>
+
+#include "psfdir.hpp"
+#include "psfpool.hpp"
+
+using namespace psf;
+
+namespace {
+
+    // a PSF file found under the input directory.
+    struct FoundFile {
+        std::string m_rel_name;
+        uint64_t m_size;
+    };
+
+    std::string join_path(const std::string & dir_name, const std::string & name) {
+        if (dir_name.empty()) {
+            return name;
+        }
+        char last = dir_name[dir_name.size() - 1];
+        if (last == '/' || last == '\\') {
+            return dir_name + name;
+        }
+        return dir_name + "/" + name;
+    }
+
+    /**
+     * Append all binary PSF files under dir_name/rel_dir to files.  Symbolic
+     * links to directories are not followed, to avoid cycles.
+     */
+    void find_files(const std::string & dir_name, const std::string & rel_dir, std::vector<FoundFile> & files) {
+        std::string cur_dir = join_path(dir_name, rel_dir);
+#ifdef _WIN32
+        WIN32_FIND_DATAA entry;
+        HANDLE handle = FindFirstFileA(join_path(cur_dir, "*").c_str(), &entry);
+        if (handle == INVALID_HANDLE_VALUE) {
+            std::ostringstream builder;
+            builder << "Cannot open directory " << cur_dir;
+            throw std::runtime_error(builder.str());
+        }
+        do {
+            std::string name(entry.cFileName);
+            if (name == "." || name == "..") {
+                continue;
+            }
+            std::string rel_name = join_path(rel_dir, name);
+            if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+                    find_files(dir_name, rel_name, files);
+                }
+            }
+            else if (is_binary_psf(join_path(dir_name, rel_name))) {
+                FoundFile found;
+                found.m_rel_name = rel_name;
+                found.m_size = (static_cast<uint64_t>(entry.nFileSizeHigh) << 32) | entry.nFileSizeLow;
+                files.push_back(found);
+            }
+        } while (FindNextFileA(handle, &entry));
+        FindClose(handle);
+#else
+        DIR * dir = opendir(cur_dir.c_str());
+        if (dir == nullptr) {
+            std::ostringstream builder;
+            builder << "Cannot open directory " << cur_dir;
+            throw std::runtime_error(builder.str());
+        }
+        struct dirent * entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            std::string name(entry->d_name);
+            if (name == "." || name == "..") {
+                continue;
+            }
+            std::string rel_name = join_path(rel_dir, name);
+            std::string full_name = join_path(dir_name, rel_name);
+            struct stat info;
+            if (lstat(full_name.c_str(), &info) != 0) {
+                continue;
+            }
+            if (S_ISDIR(info.st_mode)) {
+                find_files(dir_name, rel_name, files);
+                continue;
+            }
+            if (S_ISLNK(info.st_mode) && (stat(full_name.c_str(), &info) != 0 || !S_ISREG(info.st_mode))) {
+                continue;
+            }
+            if (S_ISREG(info.st_mode) && is_binary_psf(full_name)) {
+                FoundFile found;
+                found.m_rel_name = rel_name;
+                found.m_size = static_cast<uint64_t>(info.st_size);
+                files.push_back(found);
+            }
+        }
+        closedir(dir);
+#endif
+    }
+
+    // returns the names of the subdirectories of dir_name.
+    std::vector<std::string> list_subdirs(const std::string & dir_name) {
+        std::vector<std::string> ans;
+#ifdef _WIN32
+        WIN32_FIND_DATAA entry;
+        HANDLE handle = FindFirstFileA(join_path(dir_name, "*").c_str(), &entry);
+        if (handle == INVALID_HANDLE_VALUE) {
+            std::ostringstream builder;
+            builder << "Cannot open directory " << dir_name;
+            throw std::runtime_error(builder.str());
+        }
+        do {
+            std::string name(entry.cFileName);
+            if (name != "." && name != ".." && (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                ans.push_back(name);
+            }
+        } while (FindNextFileA(handle, &entry));
+        FindClose(handle);
+#else
+        DIR * dir = opendir(dir_name.c_str());
+        if (dir == nullptr) {
+            std::ostringstream builder;
+            builder << "Cannot open directory " << dir_name;
+            throw std::runtime_error(builder.str());
+        }
+        struct dirent * entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            std::string name(entry->d_name);
+            struct stat info;
+            if (name != "." && name != ".." && stat(join_path(dir_name, name).c_str(), &info) == 0 &&
+                S_ISDIR(info.st_mode)) {
+                ans.push_back(name);
+            }
+        }
+        closedir(dir);
+#endif
+        return ans;
+    }
+
+    bool is_number(const std::string & name) {
+        return !name.empty() && name.find_first_not_of("0123456789") == std::string::npos;
+    }
+
+    std::string get_parent_dir(const std::string & filename) {
+        size_t pos = filename.find_last_of("/\\");
+        return (pos == std::string::npos) ? std::string() : filename.substr(0, pos);
+    }
+
+}
+
+ConvertOptions DirOptions::get_job_options() const {
+    ConvertOptions ans = m_convert;
+    if (m_job_memory_bytes > 0) {
+        // m_buffer_bytes is the total the readers share among the blocks in flight.
+        ans.m_buffer_bytes = std::max(std::min(ans.m_buffer_bytes, m_job_memory_bytes), static_cast<size_t>(1));
+    }
+    return ans;
+}
+
+bool psf::is_binary_psf(const std::string & filename) {
+    // the first word is the file kind, followed by the header section code.
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    char buf[8];
+    if (!file.read(buf, sizeof(buf))) {
+        return false;
+    }
+    uint32_t section_code = uint32_t((uint32_t(buf[4] & 255) << 24) |
+        (uint32_t(buf[5] & 255) << 16) |
+        (uint32_t(buf[6] & 255) << 8) |
+        (uint32_t(buf[7] & 255)));
+    return section_code == MAJOR_SECTION_CODE;
+}
+
+void psf::make_dirs(const std::string & dir_name) {
+    for (size_t pos = 1; pos <= dir_name.size(); ++pos) {
+        if (pos != dir_name.size() && dir_name[pos] != '/' && dir_name[pos] != '\\') {
+            continue;
+        }
+        std::string cur_dir = dir_name.substr(0, pos);
+#ifdef _WIN32
+        if (cur_dir[cur_dir.size() - 1] == ':') {
+            // drive letter.
+            continue;
+        }
+        int ret = _mkdir(cur_dir.c_str());
+#else
+        int ret = mkdir(cur_dir.c_str(), 0777);
+#endif
+        if (ret != 0 && errno != EEXIST) {
+            std::ostringstream builder;
+            builder << "Cannot create directory " << cur_dir;
+            throw std::runtime_error(builder.str());
+        }
+    }
+}
+
+std::vector<std::string> psf::find_psf_files(const std::string & dir_name) {
+    std::vector<FoundFile> files;
+    find_files(dir_name, "", files);
+
+    std::vector<std::string> ans;
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        ans.push_back((*it).m_rel_name);
+    }
+    std::sort(ans.begin(), ans.end());
+    return ans;
+}
+
+std::vector<std::string> psf::find_param_runs(const std::string & run_dir, const std::string & rel_name) {
+    std::vector<std::string> runs = list_subdirs(run_dir);
+    // numbered runs first, in numeric order.
+    std::sort(runs.begin(), runs.end(), [](const std::string & a, const std::string & b) {
+        bool a_num = is_number(a), b_num = is_number(b);
+        if (a_num != b_num) {
+            return a_num;
+        }
+        if (a_num && a.size() != b.size()) {
+            return a.size() < b.size();
+        }
+        return a < b;
+    });
+
+    std::vector<std::string> ans;
+    for (auto it = runs.begin(); it != runs.end(); ++it) {
+        std::string filename = join_path(join_path(run_dir, *it), rel_name);
+        if (is_binary_psf(filename)) {
+            ans.push_back(filename);
+        }
+    }
+    return ans;
+}
+
+std::string psf::get_hdf5_filename(const std::string & rel_name, const std::string & out_dir) {
+    return join_path(out_dir, rel_name) + ".hdf5";
+}
+
+std::vector<DirResult> psf::convert_psf_dir(const std::string & in_dir, const std::string & out_dir,
+    const DirOptions & opts) {
+
+    std::vector<FoundFile> files;
+    find_files(in_dir, "", files);
+    std::sort(files.begin(), files.end(), [](const FoundFile & a, const FoundFile & b) {
+        return a.m_rel_name < b.m_rel_name;
+    });
+
+    // fill in names and create output directories up front, so jobs only convert.
+    std::vector<DirResult> ans(files.size());
+    for (size_t idx = 0; idx < files.size(); ++idx) {
+        ans[idx].m_psf_filename = join_path(in_dir, files[idx].m_rel_name);
+        ans[idx].m_hdf5_filename = get_hdf5_filename(files[idx].m_rel_name, out_dir);
+        std::string parent_dir = get_parent_dir(ans[idx].m_hdf5_filename);
+        if (!parent_dir.empty()) {
+            make_dirs(parent_dir);
+        }
+    }
+
+    // start the largest files first, so a big file does not finish last on its own.
+    std::vector<size_t> order(files.size());
+    for (size_t idx = 0; idx < order.size(); ++idx) {
+        order[idx] = idx;
+    }
+    std::stable_sort(order.begin(), order.end(), [&files](size_t a, size_t b) {
+        return files[a].m_size > files[b].m_size;
+    });
+
+    ConvertOptions job_opts = opts.get_job_options();
+    ThreadPool pool(opts.m_num_threads);
+    for (auto it = order.begin(); it != order.end(); ++it) {
+        DirResult * result = &ans[*it];
+        pool.submit([result, &job_opts]() {
+            try {
+                convert_psf(result->m_psf_filename, result->m_hdf5_filename, job_opts, &result->m_stats);
+                result->m_ok = true;
+            }
+            catch (std::exception & e) {
+                result->m_error = e.what();
+            }
+            catch (H5::Exception & e) {
+                result->m_error = e.getDetailMsg();
+            }
+            catch (...) {
+                result->m_error = "Unknown error.";
+            }
+        });
+    }
+    pool.wait();
+
+    return ans;
+}
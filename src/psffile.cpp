@@ -0,0 +1,441 @@
+#include <cstring>
+#include <sstream>
+
+#include "psffile.hpp"
+#include "psfindex.hpp"
+#include "psfreader.hpp"
+
+using namespace psf;
+
+
+/**
+ * Open the PSF file and read everything but the sweep values, or take them
+ * from its index.
+ */
+PsfFile::PsfFile(const std::string & psf_filename, bool use_index) : m_num_points(0), m_np_window(0), m_win_size(0) {
+    m_data = std::unique_ptr<ByteCursor>(new ByteCursor(psf_filename));
+    if (!m_data->good()) {
+        std::ostringstream builder;
+        builder << "Error opening file " << psf_filename;
+        throw std::runtime_error(builder.str());
+    }
+
+    // the index takes the HDF5 lock itself.
+    std::unique_ptr<PsfIndex> index;
+    if (use_index) {
+        index = PsfIndex::open(psf_filename);
+    }
+
+    // reading types creates HDF5 data types.
+    H5Lock h5_lock;
+    m_sections = index ? std::move(index->m_sections) : read_sections(*m_data);
+    try {
+        if (index) {
+            read_index_columns(*index);
+        }
+        else if (m_sections->m_sweep_list->empty()) {
+            read_no_swp_columns();
+        }
+        else {
+            check_sweep_types(*m_sections);
+            read_swp_columns();
+        }
+    }
+    catch (...) {
+        // release HDF5 data types while holding the lock.
+        m_sections.reset();
+        throw;
+    }
+}
+
+PsfFile::~PsfFile() {
+    // the type map holds HDF5 data types.
+    H5Lock h5_lock;
+    m_sections.reset();
+}
+
+const PropDict & PsfFile::get_properties() const {
+    return *(m_sections->m_prop_dict.get());
+}
+
+const TypeMap & PsfFile::get_type_map() const {
+    return *(m_sections->m_type_map.get());
+}
+
+const VarList & PsfFile::get_sweeps() const {
+    return *(m_sections->m_sweep_list.get());
+}
+
+const VarList & PsfFile::get_traces() const {
+    return *(m_sections->m_trace_list.get());
+}
+
+std::vector<std::string> PsfFile::get_names() const {
+    std::vector<std::string> ans;
+    for (auto itc = m_columns.begin(); itc != m_columns.end(); ++itc) {
+        ans.push_back((*itc).m_name);
+    }
+    return ans;
+}
+
+bool PsfFile::has_signal(const std::string & name) const {
+    return m_column_index.find(name) != m_column_index.end();
+}
+
+const TypeDef & PsfFile::get_type(const std::string & name) const {
+    auto it = m_column_index.find(name);
+    if (it == m_column_index.end()) {
+        std::ostringstream builder;
+        builder << "Signal " << name << " not found.";
+        throw std::runtime_error(builder.str());
+    }
+    return *(m_columns[it->second].m_type);
+}
+
+Span<double> PsfFile::get_double(const std::string & name) {
+    const char * values = get_column(name, TypeDef::TYPEID_DOUBLE);
+    return Span<double>(reinterpret_cast<const double *>(values), m_num_points);
+}
+
+Span<std::complex<double>> PsfFile::get_complex(const std::string & name) {
+    const char * values = get_column(name, TypeDef::TYPEID_COMPLEXDOUBLE);
+    return Span<std::complex<double>>(reinterpret_cast<const std::complex<double> *>(values), m_num_points);
+}
+
+Span<int32_t> PsfFile::get_int32(const std::string & name) {
+    const char * values = get_column(name, TypeDef::TYPEID_INT32);
+    return Span<int32_t>(reinterpret_cast<const int32_t *>(values), m_num_points);
+}
+
+Span<int8_t> PsfFile::get_int8(const std::string & name) {
+    const char * values = get_column(name, TypeDef::TYPEID_INT8);
+    return Span<int8_t>(reinterpret_cast<const int8_t *>(values), m_num_points);
+}
+
+Span<char> PsfFile::get_struct(const std::string & name) {
+    const char * values = get_column(name, TypeDef::TYPEID_STRUCT);
+    return Span<char>(values, m_num_points * get_type(name).m_value_size);
+}
+
+PointRange PsfFile::find_range(double t_start, double t_stop) {
+    if (m_sections->m_sweep_list->empty()) {
+        throw std::runtime_error("Cannot find a range of points of a file without sweep.");
+    }
+    if (m_sections->m_sweep_list->size() > 1) {
+        // the flattened inner sweep restarts on every outer point, so it is not increasing.
+        throw std::runtime_error("Cannot find a range of points of a nested sweep.");
+    }
+    uint64_t first = find_point(t_start, false);
+    uint64_t end = find_point(t_stop, true);
+    return PointRange(first, end > first ? end - first : 0);
+}
+
+std::vector<double> PsfFile::get_double(const std::string & name, const PointRange & range) {
+    std::vector<char> values = read_range(name, TypeDef::TYPEID_DOUBLE, range);
+    const double * data = reinterpret_cast<const double *>(values.data());
+    return std::vector<double>(data, data + range.m_size);
+}
+
+std::vector<std::complex<double>> PsfFile::get_complex(const std::string & name, const PointRange & range) {
+    std::vector<char> values = read_range(name, TypeDef::TYPEID_COMPLEXDOUBLE, range);
+    const std::complex<double> * data = reinterpret_cast<const std::complex<double> *>(values.data());
+    return std::vector<std::complex<double>>(data, data + range.m_size);
+}
+
+std::vector<int32_t> PsfFile::get_int32(const std::string & name, const PointRange & range) {
+    std::vector<char> values = read_range(name, TypeDef::TYPEID_INT32, range);
+    const int32_t * data = reinterpret_cast<const int32_t *>(values.data());
+    return std::vector<int32_t>(data, data + range.m_size);
+}
+
+std::vector<int8_t> PsfFile::get_int8(const std::string & name, const PointRange & range) {
+    std::vector<char> values = read_range(name, TypeDef::TYPEID_INT8, range);
+    const int8_t * data = reinterpret_cast<const int8_t *>(values.data());
+    return std::vector<int8_t>(data, data + range.m_size);
+}
+
+std::vector<char> PsfFile::get_struct(const std::string & name, const PointRange & range) {
+    return read_range(name, TypeDef::TYPEID_STRUCT, range);
+}
+
+void PsfFile::release(const std::string & name) {
+    auto it = m_column_index.find(name);
+    if (it != m_column_index.end()) {
+        Column & col = m_columns[it->second];
+        std::vector<char>().swap(col.m_values);
+        col.m_decoded = false;
+    }
+}
+
+void PsfFile::release_all() {
+    for (auto itc = m_columns.begin(); itc != m_columns.end(); ++itc) {
+        std::vector<char>().swap((*itc).m_values);
+        (*itc).m_decoded = false;
+    }
+}
+
+void PsfFile::add_column(const std::string & name, const TypeDef * type, uint64_t pos, uint64_t stride) {
+    m_column_index[name] = m_columns.size();
+    m_columns.push_back(Column());
+    Column & col = m_columns.back();
+    col.m_name = name;
+    col.m_type = type;
+    col.m_pos = pos;
+    col.m_stride = stride;
+}
+
+/**
+ * Find where the values of each sweep variable and trace start.
+ *
+ * Windowed files store win_size bytes of every variable per window, in
+ * order.  Simple files store a (code, id, value) record of every variable
+ * per point.
+ */
+void PsfFile::read_swp_columns() {
+    m_num_points = m_sections->m_num_points;
+    m_win_size = m_sections->m_win_size;
+    if (m_win_size > 0) {
+        m_np_window = read_window_header(*m_data, m_num_points);
+    }
+    else {
+        read_section_preamble(*m_data, MAJOR_SECTION_CODE);
+    }
+    add_swp_columns(m_data->tell());
+}
+
+/**
+ * Add the columns of the sweep variables and traces, given the file
+ * position of the first window or point.
+ */
+void PsfFile::add_swp_columns(uint64_t start) {
+    std::vector<const Variable *> vars;
+    for (auto itv = m_sections->m_sweep_list->begin(); itv != m_sections->m_sweep_list->end(); ++itv) {
+        vars.push_back(&(*itv));
+    }
+    for (auto itv = m_sections->m_trace_list->begin(); itv != m_sections->m_trace_list->end(); ++itv) {
+        vars.push_back(&(*itv));
+    }
+
+    if (m_win_size > 0) {
+        uint64_t stride = static_cast<uint64_t>(m_win_size) * vars.size();
+        for (size_t idx = 0; idx < vars.size(); ++idx) {
+            add_column(vars[idx]->m_name, &m_sections->m_type_map->at(vars[idx]->m_type_id),
+                start + idx * m_win_size, stride);
+        }
+    }
+    else {
+        uint64_t stride = 0;
+        for (size_t idx = 0; idx < vars.size(); ++idx) {
+            stride += 2 * WORD_SIZE + m_sections->m_type_map->at(vars[idx]->m_type_id).m_read_size;
+        }
+        uint64_t offset = 0;
+        for (size_t idx = 0; idx < vars.size(); ++idx) {
+            const TypeDef * type = &m_sections->m_type_map->at(vars[idx]->m_type_id);
+            add_column(vars[idx]->m_name, type, start + offset + 2 * WORD_SIZE, stride);
+            offset += 2 * WORD_SIZE + type->m_read_size;
+        }
+    }
+}
+
+/**
+ * Read the names and properties of the values of a non-sweep file.  The
+ * values themselves are decoded on request.
+ */
+void PsfFile::read_no_swp_columns() {
+    m_num_points = 1;
+    read_section_preamble(*m_data, MAJOR_SECTION_CODE);
+    uint64_t sub_end_pos = read_section_preamble(*m_data, MINOR_SECTION_CODE);
+    while (m_data->tell() < sub_end_pos) {
+        if (read_uint32(*m_data) != NONSWP_VAL_SECTION_CODE) {
+            break;
+        }
+        Variable var;
+        var.m_id = read_uint32(*m_data);
+        var.m_name = read_str(*m_data);
+        var.m_type_id = read_uint32(*m_data);
+        const TypeDef & var_type = m_sections->m_type_map->at(var.m_type_id);
+        if (!var_type.m_is_supported) {
+            std::ostringstream builder;
+            builder << "Output variable " << var.m_name <<
+                " with type \"" << var_type.m_name << "\" (data type = " <<
+                var_type.m_type_name << " ) is not supported.";
+            throw std::runtime_error(builder.str());
+        }
+        add_column(var.m_name, &var_type, m_data->tell(), var_type.m_read_size);
+        m_data->skip(var_type.m_read_size);
+        var.m_prop_dict.read(*m_data);
+        m_value_list.push_back(var);
+    }
+}
+
+/**
+ * Add the columns of a file from its index, without reading the file.
+ */
+void PsfFile::read_index_columns(const PsfIndex & index) {
+    if (m_sections->m_sweep_list->empty()) {
+        m_num_points = 1;
+        auto itp = index.m_value_pos_list.begin();
+        for (auto itv = index.m_value_list.begin(); itv != index.m_value_list.end(); ++itv, ++itp) {
+            const TypeDef & var_type = m_sections->m_type_map->at((*itv).m_type_id);
+            add_column((*itv).m_name, &var_type, *itp, var_type.m_read_size);
+        }
+        m_value_list = index.m_value_list;
+    }
+    else {
+        check_sweep_types(*m_sections);
+        m_num_points = m_sections->m_num_points;
+        m_win_size = m_sections->m_win_size;
+        m_np_window = index.m_np_window;
+        add_swp_columns(index.m_value_pos);
+    }
+}
+
+PsfFile::Column & PsfFile::find_column(const std::string & name, uint32_t data_type) {
+    auto it = m_column_index.find(name);
+    if (it == m_column_index.end()) {
+        std::ostringstream builder;
+        builder << "Signal " << name << " not found.";
+        throw std::runtime_error(builder.str());
+    }
+    Column & col = m_columns[it->second];
+    if (col.m_type->m_data_type != data_type) {
+        std::ostringstream builder;
+        builder << "Signal " << name << " has type " << col.m_type->m_type_name << ".";
+        throw std::runtime_error(builder.str());
+    }
+    return col;
+}
+
+const char * PsfFile::get_column(const std::string & name, uint32_t data_type) {
+    Column & col = find_column(name, data_type);
+    if (!col.m_decoded) {
+        decode_column(col);
+    }
+    return col.m_values.data();
+}
+
+/**
+ * Decode all values of a column into its buffer.
+ */
+void PsfFile::decode_column(Column & col) {
+    const TypeDef & type = *(col.m_type);
+    size_t read_size = type.m_read_size;
+    size_t value_size = type.m_value_size;
+    // values are read as stored, then decoded in place into value_size records.
+    col.m_values.resize(static_cast<size_t>(m_num_points) * read_size);
+    char * dst = col.m_values.data();
+
+    m_data->seek(col.m_pos);
+    if (m_np_window > 0) {
+        // the window size is the same for all variables, so each window is read whole.
+        for (uint64_t points_read = 0; points_read < m_num_points; points_read += m_np_window) {
+            uint32_t num_window = static_cast<uint32_t>(std::min(static_cast<uint64_t>(m_np_window),
+                m_num_points - points_read));
+            if (points_read > 0) {
+                m_data->skip(col.m_stride - m_win_size);
+            }
+            decode_values(type, m_data->read(m_win_size), dst + points_read * value_size, num_window);
+        }
+    }
+    else {
+        for (uint64_t idx = 0; idx < m_num_points; ++idx) {
+            if (idx > 0) {
+                m_data->skip(col.m_stride - read_size);
+            }
+            m_data->read(dst + idx * read_size, read_size);
+        }
+        decode_values(type, dst, dst, m_num_points);
+    }
+    col.m_values.resize(static_cast<size_t>(m_num_points) * value_size);
+    col.m_decoded = true;
+}
+
+/**
+ * Returns the file position of point idx of a column.  Windows and points
+ * of simple sweeps have a fixed size, so no values are read.
+ */
+uint64_t PsfFile::get_value_pos(const Column & col, uint64_t idx) const {
+    if (m_np_window > 0) {
+        return col.m_pos + (idx / m_np_window) * col.m_stride + (idx % m_np_window) * col.m_type->m_read_size;
+    }
+    return col.m_pos + idx * col.m_stride;
+}
+
+double PsfFile::get_sweep_value(uint64_t idx) {
+    const Column & col = m_columns.front();
+    if (col.m_decoded) {
+        return reinterpret_cast<const double *>(col.m_values.data())[idx];
+    }
+    double ans;
+    m_data->seek(get_value_pos(col, idx));
+    decode_values(*(col.m_type), m_data->read(col.m_type->m_read_size), reinterpret_cast<char *>(&ans), 1);
+    return ans;
+}
+
+/**
+ * Binary search the sweep for the first point whose value is greater than t
+ * if after, or not less than t otherwise.  Returns m_num_points if there is
+ * none.
+ */
+uint64_t PsfFile::find_point(double t, bool after) {
+    const Column & col = m_columns.front();
+    if (col.m_type->m_data_type != TypeDef::TYPEID_DOUBLE) {
+        std::ostringstream builder;
+        builder << "Sweep variable " << col.m_name << " has type " << col.m_type->m_type_name << ".";
+        throw std::runtime_error(builder.str());
+    }
+    uint64_t lo = 0, hi = m_num_points;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        double val = get_sweep_value(mid);
+        if (after ? val <= t : val < t) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Decode the values of a column in range.  Each window is read only for the
+ * part of it in range.
+ */
+std::vector<char> PsfFile::read_range(const std::string & name, uint32_t data_type, const PointRange & range) {
+    Column & col = find_column(name, data_type);
+    if (m_sections->m_sweep_list->size() > 1) {
+        // ranges are intervals of a single sweep, as found by find_range().
+        throw std::runtime_error("Cannot read a range of points of a nested sweep.");
+    }
+    if (range.m_first > m_num_points || range.m_size > m_num_points - range.m_first) {
+        std::ostringstream builder;
+        builder << "Points " << range.m_first << " to " << range.m_first + range.m_size <<
+            " are out of range, " << name << " has " << m_num_points << " points.";
+        throw std::runtime_error(builder.str());
+    }
+    const TypeDef & type = *(col.m_type);
+    size_t read_size = type.m_read_size;
+    size_t value_size = type.m_value_size;
+    std::vector<char> ans(static_cast<size_t>(range.m_size) * value_size);
+    if (col.m_decoded) {
+        if (!ans.empty()) {
+            memcpy(ans.data(), col.m_values.data() + range.m_first * value_size, ans.size());
+        }
+        return ans;
+    }
+
+    uint64_t end = range.m_first + range.m_size;
+    for (uint64_t idx = range.m_first; idx < end;) {
+        // points of a window are contiguous, points of simple sweeps are not.
+        uint64_t num = 1;
+        if (m_np_window > 0) {
+            num = std::min(m_np_window - idx % m_np_window, end - idx);
+        }
+        m_data->seek(get_value_pos(col, idx));
+        decode_values(type, m_data->read(static_cast<size_t>(num * read_size)),
+            ans.data() + (idx - range.m_first) * value_size, static_cast<size_t>(num));
+        idx += num;
+    }
+    return ans;
+}
@@ -0,0 +1,137 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "psffilter.hpp"
+
+using namespace psf;
+
+namespace {
+
+    // returns the index after the set starting at pattern[pos] == '[', or npos if
+    // the set is not closed.  matched is set if c is in the set.
+    size_t match_set(const std::string & pattern, size_t pos, char c, bool & matched) {
+        ++pos;
+        bool negate = pos < pattern.size() && (pattern[pos] == '!' || pattern[pos] == '^');
+        if (negate) {
+            ++pos;
+        }
+        matched = false;
+        bool first = true;
+        for (; pos < pattern.size() && (first || pattern[pos] != ']'); ++pos, first = false) {
+            if (pos + 2 < pattern.size() && pattern[pos + 1] == '-' && pattern[pos + 2] != ']') {
+                matched = matched || (pattern[pos] <= c && c <= pattern[pos + 2]);
+                pos += 2;
+            }
+            else {
+                matched = matched || pattern[pos] == c;
+            }
+        }
+        if (pos >= pattern.size()) {
+            return std::string::npos;
+        }
+        matched = matched != negate;
+        return pos + 1;
+    }
+
+    std::vector<std::regex> compile_all(const std::vector<std::string> & patterns) {
+        std::vector<std::regex> ans;
+        for (auto it = patterns.begin(); it != patterns.end(); ++it) {
+            try {
+                ans.push_back(std::regex(*it, std::regex::ECMAScript | std::regex::optimize));
+            }
+            catch (std::regex_error & e) {
+                std::ostringstream builder;
+                builder << "Invalid regular expression \"" << *it << "\": " << e.what();
+                throw std::runtime_error(builder.str());
+            }
+        }
+        return ans;
+    }
+
+}
+
+bool psf::glob_match(const std::string & pattern, const std::string & name) {
+    // backtrack to the last '*' on mismatch.
+    size_t pat_pos = 0, name_pos = 0;
+    size_t star_pos = std::string::npos, star_name_pos = 0;
+    while (name_pos < name.size()) {
+        if (pat_pos < pattern.size()) {
+            char p = pattern[pat_pos];
+            if (p == '*') {
+                star_pos = pat_pos++;
+                star_name_pos = name_pos;
+                continue;
+            }
+            if (p == '?') {
+                ++pat_pos;
+                ++name_pos;
+                continue;
+            }
+            if (p == '[') {
+                bool matched;
+                size_t next = match_set(pattern, pat_pos, name[name_pos], matched);
+                if (next != std::string::npos) {
+                    if (matched) {
+                        pat_pos = next;
+                        ++name_pos;
+                        continue;
+                    }
+                }
+                else if (name[name_pos] == p) {
+                    // unclosed set, match '[' literally.
+                    ++pat_pos;
+                    ++name_pos;
+                    continue;
+                }
+            }
+            else if (p == name[name_pos]) {
+                ++pat_pos;
+                ++name_pos;
+                continue;
+            }
+        }
+        if (star_pos == std::string::npos) {
+            return false;
+        }
+        pat_pos = star_pos + 1;
+        name_pos = ++star_name_pos;
+    }
+    while (pat_pos < pattern.size() && pattern[pat_pos] == '*') {
+        ++pat_pos;
+    }
+    return pat_pos == pattern.size();
+}
+
+NameFilter::NameFilter(const std::vector<std::string> & include, const std::vector<std::string> & exclude,
+    bool use_regex) : m_include(include), m_exclude(exclude), m_use_regex(use_regex) {
+    if (m_use_regex) {
+        m_include_regex = compile_all(m_include);
+        m_exclude_regex = compile_all(m_exclude);
+    }
+}
+
+bool NameFilter::match(const std::string & name) const {
+    if (!m_include.empty() && !match_any(m_include, m_include_regex, name)) {
+        return false;
+    }
+    return !match_any(m_exclude, m_exclude_regex, name);
+}
+
+bool NameFilter::match_any(const std::vector<std::string> & patterns, const std::vector<std::regex> & regexes,
+    const std::string & name) const {
+    if (m_use_regex) {
+        for (auto it = regexes.begin(); it != regexes.end(); ++it) {
+            if (std::regex_match(name, *it)) {
+                return true;
+            }
+        }
+    }
+    else {
+        for (auto it = patterns.begin(); it != patterns.end(); ++it) {
+            if (glob_match(*it, name)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,476 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "psfbuffer.hpp"
+#include "psfgen.hpp"
+
+using namespace psf;
+
+namespace {
+
+    // first word of a PSF file, before the header section.
+    static constexpr uint32_t FILE_START_CODE = 0x400;
+    static constexpr uint32_t INDEX_CODE = 19;
+    static constexpr uint32_t ZERO_PAD_CODE = 20;
+    // marks the end of the value section.
+    static constexpr uint32_t VALUE_END_CODE = 15;
+    // windows of windowed sweeps start on a page boundary.
+    static constexpr uint64_t WINDOW_ALIGN = 4096;
+    static constexpr const char * TRAILER_SIGNATURE = "Clarissa";
+    // values are buffered and written in chunks of this size.
+    static constexpr size_t WRITE_CHUNK_BYTES = 1 << 20;
+
+    static constexpr uint32_t SWEEP_TYPE_ID = 1;
+    static constexpr uint32_t DOUBLE_TYPE_ID = 2;
+    static constexpr uint32_t COMPLEX_TYPE_ID = 3;
+    static constexpr uint32_t INT32_TYPE_ID = 4;
+    // the last top-level type, so also the number of them.
+    static constexpr uint32_t STRUCT_TYPE_ID = 5;
+    static constexpr uint32_t FIRST_MEMBER_TYPE_ID = 6;
+    static constexpr uint32_t FIRST_VAR_ID = 100;
+
+    // a trace, or a value of a non-sweep file.
+    class GenSignal {
+    public:
+        GenSignal() : m_id(0), m_type_id(0), m_index(0) {}
+        ~GenSignal() {}
+
+        std::string m_name;
+        uint32_t m_id;
+        uint32_t m_type_id;
+        // position among all signals, which selects the values.
+        uint32_t m_index;
+    };
+
+    // PSF offsets are 32-bit words, which wrap around in files larger than 4 GB.
+    uint32_t to_offset(uint64_t pos) {
+        return static_cast<uint32_t>(pos & UINT32_MAX);
+    }
+
+    // start a section.  Returns the position of its end word.
+    size_t begin_section(PsfBuffer & buf, uint32_t section_code) {
+        buf.put_uint32(section_code);
+        buf.put_uint32(0);
+        return buf.size() - WORD_SIZE;
+    }
+
+    // end a major section with the marker of the next section, which the end position points past.
+    void end_section(PsfBuffer & buf, size_t end_word, uint32_t next_marker) {
+        buf.put_uint32(next_marker);
+        buf.set_uint32(end_word, to_offset(buf.size()));
+    }
+
+    size_t get_value_size(uint32_t type_id) {
+        switch (type_id) {
+        case COMPLEX_TYPE_ID:
+            return 2 * DOUB_SIZE;
+        case INT32_TYPE_ID:
+            return WORD_SIZE;
+        case STRUCT_TYPE_ID:
+            return 2 * DOUB_SIZE + WORD_SIZE;
+        default:
+            return DOUB_SIZE;
+        }
+    }
+
+    void put_value(PsfBuffer & buf, uint32_t type_id, uint32_t signal, uint32_t point) {
+        double val = get_synthetic_value(signal, point);
+        switch (type_id) {
+        case COMPLEX_TYPE_ID:
+            buf.put_double(val);
+            buf.put_double(-val);
+            break;
+        case INT32_TYPE_ID:
+            buf.put_uint32(static_cast<uint32_t>(static_cast<int32_t>(val)));
+            break;
+        case STRUCT_TYPE_ID:
+            buf.put_double(val);
+            buf.put_double(2 * val);
+            buf.put_uint32(static_cast<uint32_t>(static_cast<int32_t>(val)));
+            break;
+        default:
+            buf.put_double(val);
+        }
+    }
+
+    void put_type(PsfBuffer & buf, uint32_t id, const std::string & name, uint32_t data_type) {
+        buf.put_uint32(TypeDef::code);
+        buf.put_uint32(id);
+        buf.put_str(name);
+        buf.put_uint32(0);
+        buf.put_uint32(data_type);
+    }
+
+    /**
+     * Write the type section.  Index entries hold the type id and the offset
+     * of the definition from the start of the subsection.
+     */
+    void put_type_section(PsfBuffer & buf, uint32_t next_marker) {
+        size_t end_word = begin_section(buf, MAJOR_SECTION_CODE);
+        size_t sub_end_word = begin_section(buf, MINOR_SECTION_CODE);
+        size_t sub_start = buf.size();
+        std::vector<std::pair<uint32_t, size_t>> index;
+
+        index.push_back(std::make_pair(SWEEP_TYPE_ID, buf.size() - sub_start));
+        put_type(buf, SWEEP_TYPE_ID, "time", TypeDef::TYPEID_DOUBLE);
+        buf.put_prop("units", std::string("s"));
+
+        index.push_back(std::make_pair(DOUBLE_TYPE_ID, buf.size() - sub_start));
+        put_type(buf, DOUBLE_TYPE_ID, "V", TypeDef::TYPEID_DOUBLE);
+        buf.put_prop("units", std::string("V"));
+        buf.put_prop("key", std::string("node"));
+
+        // type names may hold a '/', as in noise analyses.
+        index.push_back(std::make_pair(COMPLEX_TYPE_ID, buf.size() - sub_start));
+        put_type(buf, COMPLEX_TYPE_ID, "V/sqrt(Hz)", TypeDef::TYPEID_COMPLEXDOUBLE);
+        buf.put_prop("units", std::string("V"));
+
+        index.push_back(std::make_pair(INT32_TYPE_ID, buf.size() - sub_start));
+        put_type(buf, INT32_TYPE_ID, "N", TypeDef::TYPEID_INT32);
+
+        // a struct lists its members, each a type definition of its own.
+        index.push_back(std::make_pair(STRUCT_TYPE_ID, buf.size() - sub_start));
+        put_type(buf, STRUCT_TYPE_ID, "op", TypeDef::TYPEID_STRUCT);
+        const char * member_names[3] = { "ids", "vgs", "region" };
+        for (uint32_t idx = 0; idx < 3; ++idx) {
+            buf.put_uint32(TypeDef::tuple_code);
+            put_type(buf, FIRST_MEMBER_TYPE_ID + idx, member_names[idx],
+                (idx < 2) ? TypeDef::TYPEID_DOUBLE : TypeDef::TYPEID_INT32);
+        }
+        buf.put_prop("key", std::string("op"));
+
+        buf.set_uint32(sub_end_word, to_offset(buf.size()));
+        buf.put_uint32(INDEX_CODE);
+        buf.put_uint32(static_cast<uint32_t>(index.size() * 2 * WORD_SIZE));
+        for (auto iti = index.begin(); iti != index.end(); ++iti) {
+            buf.put_uint32((*iti).first);
+            buf.put_uint32(static_cast<uint32_t>((*iti).second));
+        }
+        end_section(buf, end_word, next_marker);
+    }
+
+    void put_variable(PsfBuffer & buf, uint32_t id, const std::string & name, uint32_t type_id) {
+        buf.put_uint32(Variable::code);
+        buf.put_uint32(id);
+        buf.put_str(name);
+        buf.put_uint32(type_id);
+    }
+
+    /**
+     * Write the trace section.  Index entries hold the variable id, its offset
+     * from the start of the subsection, and two words Spectre uses for its
+     * own bookkeeping.
+     */
+    void put_trace_section(PsfBuffer & buf, const std::vector<GenSignal> & signals, bool use_group,
+        uint32_t group_id) {
+        size_t end_word = begin_section(buf, MAJOR_SECTION_CODE);
+        size_t sub_end_word = begin_section(buf, MINOR_SECTION_CODE);
+        size_t sub_start = buf.size();
+        if (use_group) {
+            buf.put_uint32(Group::code);
+            buf.put_uint32(group_id);
+            buf.put_str("group");
+            buf.put_uint32(static_cast<uint32_t>(signals.size()));
+        }
+        std::vector<size_t> offsets;
+        for (auto its = signals.begin(); its != signals.end(); ++its) {
+            offsets.push_back(buf.size() - sub_start);
+            put_variable(buf, (*its).m_id, (*its).m_name, (*its).m_type_id);
+            buf.put_prop("units", std::string("V"));
+        }
+
+        buf.set_uint32(sub_end_word, to_offset(buf.size()));
+        buf.put_uint32(INDEX_CODE);
+        buf.put_uint32(static_cast<uint32_t>(signals.size() * 4 * WORD_SIZE));
+        for (size_t idx = 0; idx < signals.size(); ++idx) {
+            buf.put_uint32(signals[idx].m_id);
+            buf.put_uint32(static_cast<uint32_t>(offsets[idx]));
+            buf.put_uint32(0);
+            buf.put_uint32(UINT32_MAX);
+        }
+        end_section(buf, end_word, VALUE_START);
+    }
+
+    // the value section of a non-sweep file, up to and including its end code.
+    void put_no_swp_values(PsfBuffer & buf, const std::vector<GenSignal> & signals) {
+        size_t end_word = begin_section(buf, MAJOR_SECTION_CODE);
+        size_t sub_end_word = begin_section(buf, MINOR_SECTION_CODE);
+        size_t sub_start = buf.size();
+        std::vector<size_t> offsets;
+        for (auto its = signals.begin(); its != signals.end(); ++its) {
+            offsets.push_back(buf.size() - sub_start);
+            put_variable(buf, (*its).m_id, (*its).m_name, (*its).m_type_id);
+            put_value(buf, (*its).m_type_id, (*its).m_index, 0);
+            buf.put_prop("units", std::string("V"));
+        }
+
+        buf.set_uint32(sub_end_word, to_offset(buf.size()));
+        buf.put_uint32(INDEX_CODE);
+        buf.put_uint32(static_cast<uint32_t>(signals.size() * 2 * WORD_SIZE));
+        for (size_t idx = 0; idx < signals.size(); ++idx) {
+            buf.put_uint32(signals[idx].m_id);
+            buf.put_uint32(static_cast<uint32_t>(offsets[idx]));
+        }
+        end_section(buf, end_word, VALUE_END_CODE);
+    }
+
+    // writes buffered values to a file in large chunks.
+    class ChunkWriter {
+    public:
+        explicit ChunkWriter(std::ofstream & file) : m_file(file), m_pos(0) {}
+        ~ChunkWriter() {}
+
+        // flush the buffer if it is full.
+        void flush_full() {
+            if (m_buf.size() >= WRITE_CHUNK_BYTES) {
+                flush();
+            }
+        }
+
+        void flush() {
+            m_file.write(m_buf.m_data.data(), m_buf.size());
+            m_pos += m_buf.size();
+            m_buf.clear();
+        }
+
+        // position of the end of the buffer in the file.
+        uint64_t tell() const { return m_pos + m_buf.size(); }
+
+        std::ofstream & m_file;
+        PsfBuffer m_buf;
+        uint64_t m_pos;
+    };
+
+    /**
+     * Write the value section of a simple or nested sweep.  Every point holds a
+     * (code, id, value) record of each sweep variable and every trace.  The
+     * outer sweep variable of a nested sweep comes first, and the inner sweep
+     * restarts in every row.
+     */
+    void put_simple_values(ChunkWriter & out, const GenOptions & opts, uint32_t outer_id, uint32_t sweep_id,
+        const std::vector<GenSignal> & signals) {
+        bool nested = (opts.m_layout == GenOptions::layout::NESTED);
+        uint32_t num_rows = nested ? opts.m_num_rows : 1;
+        uint64_t point_size = (nested ? 2 : 1) * (2 * WORD_SIZE + DOUB_SIZE);
+        for (auto its = signals.begin(); its != signals.end(); ++its) {
+            point_size += 2 * WORD_SIZE + get_value_size((*its).m_type_id);
+        }
+        uint64_t start = out.tell();
+        uint64_t end_pos = start + 2 * WORD_SIZE + point_size * num_rows * opts.m_num_points + WORD_SIZE;
+
+        out.m_buf.put_uint32(MAJOR_SECTION_CODE);
+        out.m_buf.put_uint32(to_offset(end_pos));
+        for (uint32_t row = 0; row < num_rows; ++row) {
+            for (uint32_t inner = 0; inner < opts.m_num_points; ++inner) {
+                uint32_t point = row * opts.m_num_points + inner;
+                if (nested) {
+                    out.m_buf.put_uint32(Variable::code);
+                    out.m_buf.put_uint32(outer_id);
+                    out.m_buf.put_double(get_synthetic_outer(row));
+                }
+                out.m_buf.put_uint32(Variable::code);
+                out.m_buf.put_uint32(sweep_id);
+                out.m_buf.put_double(get_synthetic_sweep(inner));
+                for (auto its = signals.begin(); its != signals.end(); ++its) {
+                    out.m_buf.put_uint32(Variable::code);
+                    out.m_buf.put_uint32((*its).m_id);
+                    put_value(out.m_buf, (*its).m_type_id, (*its).m_index, point);
+                }
+                out.flush_full();
+            }
+        }
+        out.m_buf.put_uint32(VALUE_END_CODE);
+    }
+
+    /**
+     * Write the value section of a windowed sweep.  After a zero pad that
+     * aligns the windows to a page, a header gives the points per window.
+     * Each window then holds window_size bytes of the sweep variable and of
+     * every trace, of which the first points per window values are valid.
+     */
+    void put_windowed_values(ChunkWriter & out, const GenOptions & opts, const std::vector<GenSignal> & signals) {
+        uint32_t capacity = opts.m_window_size / DOUB_SIZE;
+        uint32_t np_window = std::min(capacity, std::max(opts.m_num_points, static_cast<uint32_t>(1)));
+        uint64_t num_windows = (static_cast<uint64_t>(opts.m_num_points) + np_window - 1) / np_window;
+        uint64_t num_vars = signals.size() + 1;
+
+        uint64_t start = out.tell();
+        uint64_t pad_size = (WINDOW_ALIGN - (start + 4 * WORD_SIZE) % WINDOW_ALIGN) % WINDOW_ALIGN;
+        uint64_t windows_start = start + 4 * WORD_SIZE + pad_size + 2 * WORD_SIZE;
+        uint64_t end_pos = windows_start + num_windows * num_vars * opts.m_window_size + WORD_SIZE;
+
+        out.m_buf.put_uint32(MAJOR_SECTION_CODE);
+        out.m_buf.put_uint32(to_offset(end_pos));
+        out.m_buf.put_uint32(ZERO_PAD_CODE);
+        out.m_buf.put_uint32(static_cast<uint32_t>(pad_size));
+        out.m_buf.put_zeros(pad_size);
+        out.m_buf.put_uint32(SWP_WINDOW_SECTION_CODE);
+        out.m_buf.put_uint32(((capacity - 1) << 16) | np_window);
+
+        for (uint64_t win_idx = 0; win_idx < num_windows; ++win_idx) {
+            uint32_t first = static_cast<uint32_t>(win_idx * np_window);
+            uint32_t num_window = std::min(np_window, opts.m_num_points - first);
+            size_t unused = opts.m_window_size - num_window * DOUB_SIZE;
+            for (uint32_t point = first; point < first + num_window; ++point) {
+                out.m_buf.put_double(get_synthetic_sweep(point));
+            }
+            out.m_buf.put_zeros(unused);
+            for (auto its = signals.begin(); its != signals.end(); ++its) {
+                for (uint32_t point = first; point < first + num_window; ++point) {
+                    out.m_buf.put_double(get_synthetic_value((*its).m_index, point));
+                }
+                out.m_buf.put_zeros(unused);
+            }
+            out.flush_full();
+        }
+        out.m_buf.put_uint32(VALUE_END_CODE);
+    }
+
+    void check_options(const GenOptions & opts) {
+        std::ostringstream builder;
+        if (opts.m_layout == GenOptions::layout::WINDOWED) {
+            if (opts.m_num_complex > 0 || opts.m_num_int32 > 0 || opts.m_num_struct > 0) {
+                builder << "Windowed sweeps only support double traces.";
+            }
+            else if (opts.m_window_size < DOUB_SIZE || opts.m_window_size % DOUB_SIZE != 0 ||
+                opts.m_window_size / DOUB_SIZE > 0xffff) {
+                builder << "Invalid window size " << opts.m_window_size << ".";
+            }
+        }
+        else if (opts.m_layout == GenOptions::layout::NESTED &&
+            static_cast<uint64_t>(opts.m_num_rows) * opts.m_num_points > UINT32_MAX) {
+            builder << "Too many points in " << opts.m_num_rows << " rows of " << opts.m_num_points << ".";
+        }
+        if (!builder.str().empty()) {
+            throw std::runtime_error(builder.str());
+        }
+    }
+
+}
+
+double psf::get_synthetic_sweep(uint32_t point) {
+    return point * 1.0e-9;
+}
+
+double psf::get_synthetic_outer(uint32_t row) {
+    return 1.0 + static_cast<double>(row / 2) / 8.0;
+}
+
+double psf::get_synthetic_value(uint32_t signal, uint32_t point) {
+    // small dyadic fractions, so values survive any exact round trip.
+    return static_cast<double>(signal) + static_cast<double>(point % 4096) / 4096.0;
+}
+
+uint64_t psf::write_synthetic_psf(const std::string & psf_filename, const GenOptions & opts) {
+    check_options(opts);
+    bool has_sweep = (opts.m_layout != GenOptions::layout::NO_SWEEP);
+    bool nested = (opts.m_layout == GenOptions::layout::NESTED);
+    uint32_t num_points = nested ? opts.m_num_rows * opts.m_num_points : opts.m_num_points;
+
+    // name and number the signals by type.
+    std::vector<GenSignal> signals;
+    const uint32_t counts[4] = { opts.m_num_double, opts.m_num_complex, opts.m_num_int32, opts.m_num_struct };
+    const uint32_t type_ids[4] = { DOUBLE_TYPE_ID, COMPLEX_TYPE_ID, INT32_TYPE_ID, STRUCT_TYPE_ID };
+    const char * prefixes[4] = { "d", "c", "i", "s" };
+    uint32_t next_id = FIRST_VAR_ID;
+    uint32_t sweep_id = next_id++;
+    uint32_t group_id = next_id++;
+    uint32_t outer_id = next_id++;
+    for (int type_idx = 0; type_idx < 4; ++type_idx) {
+        for (uint32_t idx = 0; idx < counts[type_idx]; ++idx) {
+            GenSignal signal;
+            signal.m_name = prefixes[type_idx] + std::to_string(idx);
+            signal.m_id = next_id++;
+            signal.m_type_id = type_ids[type_idx];
+            signal.m_index = static_cast<uint32_t>(signals.size());
+            signals.push_back(signal);
+        }
+    }
+
+    // all sections before the values are built in memory, since they are small.
+    PsfBuffer buf;
+    std::vector<std::pair<uint32_t, size_t>> toc;
+    buf.put_uint32(FILE_START_CODE);
+
+    toc.push_back(std::make_pair(0u, buf.size()));
+    size_t end_word = begin_section(buf, MAJOR_SECTION_CODE);
+    buf.put_prop("PSFversion", std::string("1.1"));
+    buf.put_prop("PSF style", 7);
+    buf.put_prop("PSF types", static_cast<int32_t>(STRUCT_TYPE_ID));
+    buf.put_prop("PSF sweeps", has_sweep ? (nested ? 2 : 1) : 0);
+    if (has_sweep) {
+        buf.put_prop("PSF sweep points", static_cast<int32_t>(num_points));
+        buf.put_prop("PSF sweep min", get_synthetic_sweep(0));
+        buf.put_prop("PSF sweep max", get_synthetic_sweep(std::max(opts.m_num_points, 1u) - 1));
+        buf.put_prop("PSF groups", opts.m_use_group ? 1 : 0);
+        buf.put_prop("PSF traces", static_cast<int32_t>(signals.size()));
+    }
+    if (opts.m_layout == GenOptions::layout::WINDOWED) {
+        buf.put_prop("PSF buffer size", static_cast<int32_t>(opts.m_window_size * (signals.size() + 1)));
+        buf.put_prop("PSF window size", static_cast<int32_t>(opts.m_window_size));
+    }
+    buf.put_prop("simulator", std::string("psfgen"));
+    buf.put_prop("analysis type", std::string(has_sweep ? "tran" : "dc"));
+    end_section(buf, end_word, TYPE_START);
+
+    toc.push_back(std::make_pair(TYPE_START, buf.size()));
+    put_type_section(buf, has_sweep ? SWEEP_START : VALUE_START);
+
+    if (has_sweep) {
+        toc.push_back(std::make_pair(SWEEP_START, buf.size()));
+        end_word = begin_section(buf, MAJOR_SECTION_CODE);
+        if (nested) {
+            put_variable(buf, outer_id, "vdd", DOUBLE_TYPE_ID);
+            buf.put_prop("units", std::string("V"));
+        }
+        put_variable(buf, sweep_id, "time", SWEEP_TYPE_ID);
+        buf.put_prop("units", std::string("s"));
+        end_section(buf, end_word, TRACE_START);
+
+        toc.push_back(std::make_pair(TRACE_START, buf.size()));
+        put_trace_section(buf, signals, opts.m_use_group, group_id);
+    }
+
+    std::ofstream file(psf_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::ostringstream builder;
+        builder << "Cannot open " << psf_filename << " for writing.";
+        throw std::runtime_error(builder.str());
+    }
+    ChunkWriter out(file);
+    out.m_buf.m_data.swap(buf.m_data);
+
+    toc.push_back(std::make_pair(VALUE_START, out.tell()));
+    switch (opts.m_layout) {
+    case GenOptions::layout::NO_SWEEP:
+        put_no_swp_values(out.m_buf, signals);
+        break;
+    case GenOptions::layout::SIMPLE:
+    case GenOptions::layout::NESTED:
+        put_simple_values(out, opts, outer_id, sweep_id, signals);
+        break;
+    default:
+        put_windowed_values(out, opts, signals);
+    }
+
+    // the trailer lists the offset of every section, then the signature and
+    // the offset of the list.
+    uint64_t toc_pos = out.tell();
+    for (auto itt = toc.begin(); itt != toc.end(); ++itt) {
+        out.m_buf.put_uint32((*itt).first);
+        out.m_buf.put_uint32(to_offset((*itt).second));
+    }
+    out.m_buf.m_data.insert(out.m_buf.m_data.end(), TRAILER_SIGNATURE, TRAILER_SIGNATURE + strlen(TRAILER_SIGNATURE));
+    out.m_buf.put_uint32(to_offset(toc_pos));
+    out.flush();
+    file.close();
+    if (!file) {
+        std::ostringstream builder;
+        builder << "Error writing " << psf_filename;
+        throw std::runtime_error(builder.str());
+    }
+    return out.m_pos;
+}
@@ -0,0 +1,366 @@
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "psfbuffer.hpp"
+#include "psfindex.hpp"
+#include "psfreader.hpp"
+
+using namespace psf;
+
+namespace {
+
+    // first and last word of an index file, "PSFX".
+    static constexpr uint32_t INDEX_MAGIC = 0x50534658;
+    static constexpr uint32_t INDEX_VERSION = 2;
+
+    /**
+     * Returns a temporary file name next to filename, unique to this process
+     * and call, so concurrent writers of the same index do not collide.
+     */
+    std::string get_tmp_filename(const std::string & filename) {
+        static std::atomic<uint32_t> next_id(0);
+#ifdef _WIN32
+        int pid = _getpid();
+#else
+        int pid = static_cast<int>(getpid());
+#endif
+        std::ostringstream builder;
+        builder << filename << "." << pid << "." << next_id++ << ".tmp";
+        return builder.str();
+    }
+
+    // 64-bit FNV-1a hash of size bytes, taken 8 bytes at a time.
+    uint64_t get_checksum(const char * data, uint64_t size) {
+        uint64_t ans = 0xcbf29ce484222325ull;
+        uint64_t idx = 0;
+        for (; idx + sizeof(uint64_t) <= size; idx += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, data + idx, sizeof(word));
+            ans ^= word;
+            ans *= 0x100000001b3ull;
+        }
+        for (; idx < size; ++idx) {
+            ans ^= static_cast<unsigned char>(data[idx]);
+            ans *= 0x100000001b3ull;
+        }
+        return ans;
+    }
+
+    // write a type definition, and those of its members, as TypeDef::read() reads them.
+    void put_type(PsfBuffer & buf, const TypeDef & type, const TypeMap & type_map) {
+        buf.put_uint32(TypeDef::code);
+        buf.put_uint32(type.m_id);
+        buf.put_str(type.m_name);
+        buf.put_uint32(type.m_array_type);
+        buf.put_uint32(type.m_data_type);
+        for (auto itm = type.m_member_ids.begin(); itm != type.m_member_ids.end(); ++itm) {
+            buf.put_uint32(TypeDef::tuple_code);
+            put_type(buf, type_map.at(*itm), type_map);
+        }
+        buf.put_props(type.m_prop_dict);
+    }
+
+    // write a variable as Variable::read() reads it.
+    void put_variable(PsfBuffer & buf, const Variable & var) {
+        buf.put_uint32(Variable::code);
+        buf.put_uint32(var.m_id);
+        buf.put_str(var.m_name);
+        buf.put_uint32(var.m_type_id);
+        buf.put_props(var.m_prop_dict);
+    }
+
+    void put_variables(PsfBuffer & buf, const VarList & vars) {
+        buf.put_uint32(static_cast<uint32_t>(vars.size()));
+        for (auto itv = vars.begin(); itv != vars.end(); ++itv) {
+            put_variable(buf, *itv);
+        }
+    }
+
+    Variable read_variable(ByteCursor & data) {
+        Variable ans;
+        if (!ans.read(data)) {
+            throw std::runtime_error("Invalid variable in index.");
+        }
+        return ans;
+    }
+
+    std::unique_ptr<VarList> read_variables(ByteCursor & data) {
+        auto ans = std::unique_ptr<VarList>(new VarList());
+        uint32_t num_vars = read_uint32(data);
+        for (uint32_t idx = 0; idx < num_vars; ++idx) {
+            ans->push_back(read_variable(data));
+        }
+        return ans;
+    }
+
+    /**
+     * Read the values section of a non-sweep file, recording the variable and
+     * file position of each value.
+     */
+    void index_no_swp_values(ByteCursor & data, const TypeMap & type_map, PsfIndex * index) {
+        read_section_preamble(data, MAJOR_SECTION_CODE);
+        uint64_t sub_end_pos = read_section_preamble(data, MINOR_SECTION_CODE);
+        index->m_value_pos = data.tell();
+        while (data.tell() < sub_end_pos) {
+            if (read_uint32(data) != NONSWP_VAL_SECTION_CODE) {
+                break;
+            }
+            Variable var;
+            var.m_id = read_uint32(data);
+            var.m_name = read_str(data);
+            var.m_type_id = read_uint32(data);
+            const TypeDef & var_type = type_map.at(var.m_type_id);
+            if (!var_type.m_is_supported) {
+                std::ostringstream builder;
+                builder << "Output variable " << var.m_name <<
+                    " with type \"" << var_type.m_name << "\" (data type = " <<
+                    var_type.m_type_name << " ) is not supported.";
+                throw std::runtime_error(builder.str());
+            }
+            index->m_value_pos_list.push_back(data.tell());
+            data.skip(var_type.m_read_size);
+            var.m_prop_dict.read(data);
+            index->m_value_list.push_back(var);
+        }
+    }
+
+    /**
+     * Read the start of the values section of a sweep.  Windows and points
+     * have a fixed size, so PsfFile finds them from m_value_pos.
+     */
+    void index_swp_values(ByteCursor & data, const PsfSections & sections, PsfIndex * index) {
+        if (sections.m_win_size > 0) {
+            index->m_np_window = read_window_header(data, sections.m_num_points);
+        }
+        else {
+            read_section_preamble(data, MAJOR_SECTION_CODE);
+        }
+        index->m_value_pos = data.tell();
+    }
+
+}
+
+PsfIndex::PsfIndex() : m_value_pos(0), m_np_window(0) {}
+
+PsfIndex::~PsfIndex() {
+    if (m_sections) {
+        // the type map holds HDF5 data types.
+        H5Lock h5_lock;
+        m_sections.reset();
+    }
+}
+
+std::string PsfIndex::get_index_filename(const std::string & psf_filename) {
+    return psf_filename + INDEX_SUFFIX;
+}
+
+SourceStamp PsfIndex::get_stamp(const std::string & psf_filename, uint64_t metadata_bytes) {
+#ifdef _WIN32
+    struct _stat64 st;
+    bool found = (_stat64(psf_filename.c_str(), &st) == 0);
+#else
+    struct stat st;
+    bool found = (stat(psf_filename.c_str(), &st) == 0);
+#endif
+    ByteCursor data(psf_filename);
+    if (!found || !data.good()) {
+        std::ostringstream builder;
+        builder << "Error opening file " << psf_filename;
+        throw std::runtime_error(builder.str());
+    }
+    SourceStamp ans;
+    ans.m_size = static_cast<uint64_t>(st.st_size);
+    ans.m_mtime = static_cast<int64_t>(st.st_mtime);
+    ans.m_metadata_bytes = std::min(metadata_bytes, data.size());
+    ans.m_checksum = get_checksum(data.read(static_cast<size_t>(ans.m_metadata_bytes)), ans.m_metadata_bytes);
+    return ans;
+}
+
+std::unique_ptr<PsfIndex> PsfIndex::build(const std::string & psf_filename) {
+    ByteCursor data(psf_filename);
+    if (!data.good()) {
+        std::ostringstream builder;
+        builder << "Error opening file " << psf_filename;
+        throw std::runtime_error(builder.str());
+    }
+
+    auto ans = std::unique_ptr<PsfIndex>(new PsfIndex());
+    {
+        // reading types creates HDF5 data types.
+        H5Lock h5_lock;
+        auto sections = read_sections(data);
+        ans->m_stamp = get_stamp(psf_filename, data.tell());
+        if (sections->m_sweep_list->empty()) {
+            index_no_swp_values(data, *(sections->m_type_map.get()), ans.get());
+        }
+        else {
+            index_swp_values(data, *sections, ans.get());
+        }
+        ans->m_sections = std::move(sections);
+    }
+    return ans;
+}
+
+std::unique_ptr<PsfIndex> PsfIndex::load(const std::string & psf_filename) {
+    std::string index_filename = get_index_filename(psf_filename);
+    ByteCursor data(index_filename);
+    if (!data.good()) {
+        return nullptr;
+    }
+
+    auto ans = std::unique_ptr<PsfIndex>(new PsfIndex());
+    try {
+        if (read_uint32(data) != INDEX_MAGIC || read_uint32(data) != INDEX_VERSION) {
+            PSF_LOG_TRACE << index_filename << " is not a PSF index of this version";
+            return nullptr;
+        }
+        SourceStamp & stamp = ans->m_stamp;
+        stamp.m_size = read_uint64(data);
+        stamp.m_mtime = static_cast<int64_t>(read_uint64(data));
+        stamp.m_metadata_bytes = read_uint64(data);
+        stamp.m_checksum = read_uint64(data);
+        if (get_stamp(psf_filename, stamp.m_metadata_bytes) != stamp) {
+            PSF_LOG_TRACE << index_filename << " is stale";
+            return nullptr;
+        }
+
+        // reading types creates HDF5 data types.
+        H5Lock h5_lock;
+        auto sections = std::unique_ptr<PsfSections>(new PsfSections());
+        sections->m_num_points = read_uint64(data);
+        sections->m_win_size = read_uint32(data);
+        ans->m_np_window = read_uint32(data);
+        ans->m_value_pos = read_uint64(data);
+
+        sections->m_prop_dict = std::unique_ptr<PropDict>(new PropDict());
+        sections->m_prop_dict->read(data);
+        if (read_uint32(data) != 0) {
+            throw std::runtime_error("Invalid header properties in index.");
+        }
+
+        sections->m_type_map = std::unique_ptr<TypeMap>(new TypeMap());
+        uint32_t num_types = read_uint32(data);
+        for (uint32_t idx = 0; idx < num_types; ++idx) {
+            TypeDef temp;
+            if (!temp.read(data, sections->m_type_map.get())) {
+                throw std::runtime_error("Invalid type in index.");
+            }
+        }
+        sections->m_sweep_list = read_variables(data);
+        sections->m_trace_list = read_variables(data);
+
+        uint32_t num_values = read_uint32(data);
+        for (uint32_t idx = 0; idx < num_values; ++idx) {
+            ans->m_value_list.push_back(read_variable(data));
+            ans->m_value_pos_list.push_back(read_uint64(data));
+        }
+        if (read_uint32(data) != INDEX_MAGIC || data.tell() != data.size()) {
+            throw std::runtime_error("Invalid end of index.");
+        }
+        ans->m_sections = std::move(sections);
+    }
+    catch (std::exception & e) {
+        PSF_LOG_TRACE << "Cannot read " << index_filename << ": " << e.what();
+        return nullptr;
+    }
+    catch (H5::Exception & e) {
+        PSF_LOG_TRACE << "Cannot read " << index_filename << ": " << e.getDetailMsg();
+        return nullptr;
+    }
+    return ans;
+}
+
+std::unique_ptr<PsfIndex> PsfIndex::open(const std::string & psf_filename) {
+    auto ans = load(psf_filename);
+    if (!ans) {
+        PSF_LOG_TRACE << "Building index of " << psf_filename;
+        ans = build(psf_filename);
+        try {
+            ans->write(get_index_filename(psf_filename));
+        }
+        catch (std::exception & e) {
+            PSF_LOG_TRACE << "Cannot save index: " << e.what();
+        }
+    }
+    return ans;
+}
+
+void PsfIndex::write(const std::string & index_filename) const {
+    PsfBuffer buf;
+    buf.put_uint32(INDEX_MAGIC);
+    buf.put_uint32(INDEX_VERSION);
+    buf.put_uint64(m_stamp.m_size);
+    buf.put_uint64(static_cast<uint64_t>(m_stamp.m_mtime));
+    buf.put_uint64(m_stamp.m_metadata_bytes);
+    buf.put_uint64(m_stamp.m_checksum);
+
+    buf.put_uint64(m_sections->m_num_points);
+    buf.put_uint32(m_sections->m_win_size);
+    buf.put_uint32(m_np_window);
+    buf.put_uint64(m_value_pos);
+
+    buf.put_props(*(m_sections->m_prop_dict.get()));
+    buf.put_uint32(0);
+
+    // struct members are written with their struct.
+    const TypeMap & type_map = *(m_sections->m_type_map.get());
+    std::set<uint32_t> member_ids;
+    for (auto itt = type_map.begin(); itt != type_map.end(); ++itt) {
+        member_ids.insert(itt->second.m_member_ids.begin(), itt->second.m_member_ids.end());
+    }
+    buf.put_uint32(static_cast<uint32_t>(type_map.size() - member_ids.size()));
+    for (auto itt = type_map.begin(); itt != type_map.end(); ++itt) {
+        if (member_ids.count(itt->first) == 0) {
+            put_type(buf, itt->second, type_map);
+        }
+    }
+    put_variables(buf, *(m_sections->m_sweep_list.get()));
+    put_variables(buf, *(m_sections->m_trace_list.get()));
+
+    buf.put_uint32(static_cast<uint32_t>(m_value_list.size()));
+    auto itp = m_value_pos_list.begin();
+    for (auto itv = m_value_list.begin(); itv != m_value_list.end(); ++itv, ++itp) {
+        put_variable(buf, *itv);
+        buf.put_uint64(*itp);
+    }
+    buf.put_uint32(INDEX_MAGIC);
+
+    // write a temporary file first, so readers never see a partial index.
+    std::string tmp_filename = get_tmp_filename(index_filename);
+    std::ofstream file(tmp_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::ostringstream builder;
+        builder << "Cannot open " << tmp_filename << " for writing.";
+        throw std::runtime_error(builder.str());
+    }
+    file.write(buf.m_data.data(), buf.size());
+    file.close();
+    if (!file) {
+        std::remove(tmp_filename.c_str());
+        std::ostringstream builder;
+        builder << "Error writing " << tmp_filename;
+        throw std::runtime_error(builder.str());
+    }
+    // rename() does not replace existing files on windows.
+    if (std::rename(tmp_filename.c_str(), index_filename.c_str()) != 0) {
+        std::remove(index_filename.c_str());
+        if (std::rename(tmp_filename.c_str(), index_filename.c_str()) != 0) {
+            std::remove(tmp_filename.c_str());
+            std::ostringstream builder;
+            builder << "Cannot replace " << index_filename;
+            throw std::runtime_error(builder.str());
+        }
+    }
+}
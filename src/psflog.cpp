@@ -0,0 +1,65 @@
+#include <atomic>
+
+#include "psf.hpp"
+#include "psflog.hpp"
+
+using namespace psf;
+
+namespace {
+
+    // the scope of the calling thread, or null to use the default logger.
+    thread_local LogScope * current_scope = nullptr;
+    // true if configure_logging() enabled the default logger.
+    std::atomic<bool> default_enabled(false);
+    // numbers the loggers of scopes, so their ids are unique.
+    std::atomic<uint64_t> next_scope_id(0);
+
+    el::Configurations make_log_config(const std::string & log_filename, bool print_msg) {
+        el::Configurations ans;
+        ans.setToDefault();
+        ans.setGlobally(el::ConfigurationType::Format, "%level: %msg");
+        ans.setGlobally(el::ConfigurationType::ToStandardOutput, print_msg ? "true" : "false");
+        if (log_filename.empty()) {
+            ans.setGlobally(el::ConfigurationType::ToFile, "false");
+        }
+        else {
+            ans.setGlobally(el::ConfigurationType::ToFile, "true");
+            ans.setGlobally(el::ConfigurationType::Filename, log_filename);
+        }
+        return ans;
+    }
+
+}
+
+LogScope::LogScope(const std::string & log_filename, bool print_msg) :
+    m_enabled(print_msg || !log_filename.empty()), m_prev(current_scope) {
+    if (m_enabled) {
+        m_id = std::string(DEFAULT_LOGGER_ID) + "." + std::to_string(next_scope_id++);
+        el::Loggers::reconfigureLogger(m_id, make_log_config(log_filename, print_msg));
+    }
+    current_scope = this;
+}
+
+LogScope::~LogScope() {
+    current_scope = m_prev;
+    if (m_enabled) {
+        el::Loggers::unregisterLogger(m_id);
+    }
+}
+
+const char * psf::get_log_id() {
+    return (current_scope == nullptr) ? DEFAULT_LOGGER_ID : current_scope->get_id();
+}
+
+bool psf::is_trace_enabled() {
+    return (current_scope == nullptr) ? default_enabled.load(std::memory_order_relaxed) :
+        current_scope->is_enabled();
+}
+
+void psf::configure_logging(const std::string& log_filename, bool print_msg) {
+    bool enabled = print_msg || !log_filename.empty();
+    if (enabled) {
+        el::Loggers::reconfigureLogger(DEFAULT_LOGGER_ID, make_log_config(log_filename, print_msg));
+    }
+    default_enabled = enabled;
+}
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <limits>
+
+#include "psfascii.hpp"
+#include "psfmerge.hpp"
+#include "psfreader.hpp"
+
+using namespace psf;
+
+namespace {
+
+    /**
+     * Returns the number a design variable value holds, either directly or as
+     * the first member of a struct such as ( 500e-3 ).  Returns false if it
+     * holds no number.
+     */
+    bool get_number(const AsciiValue & value, double & ans) {
+        switch (value.m_kind) {
+        case AsciiValue::kind::DOUBLE:
+            ans = value.m_dval;
+            return true;
+        case AsciiValue::kind::INT:
+            ans = value.m_ival;
+            return true;
+        case AsciiValue::kind::LIST:
+            return !value.m_items.empty() && get_number(value.m_items.front(), ans);
+        default:
+            return false;
+        }
+    }
+
+    // returns the index of the struct member member_name of type, or -1 if there is none.
+    int find_member(const AsciiType & type, const std::string & member_name) {
+        for (size_t idx = 0; idx < type.m_members.size(); ++idx) {
+            if (type.m_members[idx].m_name == member_name) {
+                return static_cast<int>(idx);
+            }
+        }
+        return -1;
+    }
+
+    bool file_exists(const std::string & filename) {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        return file.good();
+    }
+
+    std::string get_parent_dir(const std::string & filename) {
+        size_t pos = filename.find_last_of("/\\");
+        return (pos == std::string::npos) ? std::string() : filename.substr(0, pos + 1);
+    }
+
+    /**
+     * Check that two PSF files have the same sweep and trace variables, so
+     * their values can be merged.
+     */
+    void check_same_vars(const PsfSections & first, const PsfSections & other, const std::string & filename) {
+        const VarList * first_lists[2] = { first.m_sweep_list.get(), first.m_trace_list.get() };
+        const VarList * other_lists[2] = { other.m_sweep_list.get(), other.m_trace_list.get() };
+        for (int idx = 0; idx < 2; ++idx) {
+            bool same = first_lists[idx]->size() == other_lists[idx]->size();
+            auto itf = first_lists[idx]->begin();
+            auto ito = other_lists[idx]->begin();
+            for (; same && itf != first_lists[idx]->end(); ++itf, ++ito) {
+                const TypeDef & first_type = first.m_type_map->at((*itf).m_type_id);
+                const TypeDef & other_type = other.m_type_map->at((*ito).m_type_id);
+                same = (*itf).m_name == (*ito).m_name && first_type.m_type_name == other_type.m_type_name &&
+                    first_type.m_read_size == other_type.m_read_size;
+            }
+            if (!same) {
+                std::ostringstream builder;
+                builder << "PSF file " << filename << " has different sweep or trace variables than the first file.";
+                throw std::runtime_error(builder.str());
+            }
+        }
+    }
+
+    /**
+     * Read the sections of a file to merge.  The caller holds h5_lock, which
+     * is released while parsing and only taken while types are read.
+     */
+    std::unique_ptr<PsfSections> read_merge_sections(ByteCursor & data, const std::string & filename,
+        H5Lock & h5_lock) {
+        if (!data.good()) {
+            std::ostringstream builder;
+            builder << "Error opening file " << filename;
+            throw std::runtime_error(builder.str());
+        }
+        std::unique_ptr<PsfSections> ans;
+        {
+            H5Unlock h5_unlock(h5_lock);
+            ans = read_sections(data, nullptr, &h5_lock);
+        }
+        if (ans->m_sweep_list->size() == 0) {
+            std::ostringstream builder;
+            builder << "Cannot merge PSF file " << filename << " without sweep.";
+            throw std::runtime_error(builder.str());
+        }
+        if (ans->m_sweep_list->size() > 1) {
+            std::ostringstream builder;
+            builder << "Cannot merge PSF file " << filename << " with nested sweep.";
+            throw std::runtime_error(builder.str());
+        }
+        check_sweep_types(*ans);
+        return ans;
+    }
+
+}
+
+DesignVarList psf::read_design_vars(const std::string & filename) {
+    auto psf = read_psf_ascii(filename);
+
+    // each value is "name" "type" value, where value is a number, or a
+    // struct holding a number.  Values that are not numbers are skipped.
+    DesignVarList ans;
+    for (auto itv = psf->m_values.begin(); itv != psf->m_values.end(); ++itv) {
+        double val = 0.0;
+        if (get_number((*itv).m_value, val)) {
+            ans.push_back(std::make_pair((*itv).m_name, val));
+        }
+    }
+    return ans;
+}
+
+std::string psf::find_design_var_file(const std::string & psf_filename) {
+    std::string dir_name = get_parent_dir(psf_filename);
+
+    // the artistLogFile names the design variable file of the run.
+    std::string log_filename = dir_name + ARTIST_LOG_FILENAME;
+    if (file_exists(log_filename)) {
+        // each entry is an analysisInst struct, with the analysis type and its data file.
+        auto log = read_psf_ascii(log_filename);
+        for (auto itv = log->m_values.begin(); itv != log->m_values.end(); ++itv) {
+            const AsciiType & type = log->get_type((*itv).m_type_name);
+            const std::vector<AsciiValue> & members = (*itv).m_value.m_items;
+            int type_idx = find_member(type, "analysisType");
+            int file_idx = find_member(type, "dataFile");
+            if (type_idx < 0 || file_idx < 0 || members.size() != type.m_members.size() ||
+                members[type_idx].m_sval != "design_variables") {
+                continue;
+            }
+            std::string ans = dir_name + members[file_idx].m_sval;
+            if (file_exists(ans)) {
+                return ans;
+            }
+            break;
+        }
+    }
+
+    std::string ans = dir_name + DESIGN_VAR_FILENAME;
+    return file_exists(ans) ? ans : std::string();
+}
+
+void psf::merge_psf(const std::vector<std::string> & psf_filenames, const std::string & hdf5_filename,
+    const ConvertOptions & opts) {
+
+    if (psf_filenames.empty()) {
+        throw std::runtime_error("No PSF files to merge.");
+    }
+
+    // hold the HDF5 lock whenever HDF5 is used.  Declared first, so it is
+    // released after all HDF5 objects below are destroyed.  Files are parsed
+    // with the lock released, so other conversions can run meanwhile.
+    H5Lock h5_lock;
+
+    // first pass: check that all files have the same variables, and find the
+    // number of sweep points of each file.
+    std::unique_ptr<PsfSections> first;
+    std::vector<uint64_t> num_points;
+    uint64_t max_points = 0;
+    for (auto it = psf_filenames.begin(); it != psf_filenames.end(); ++it) {
+        ByteCursor data(*it);
+        auto sections = read_merge_sections(data, *it, h5_lock);
+        if (first) {
+            check_same_vars(*first, *sections, *it);
+        }
+        num_points.push_back(sections->m_num_points);
+        max_points = std::max(max_points, sections->m_num_points);
+        if (!first) {
+            first = std::move(sections);
+        }
+    }
+
+    // read design variables of each run.  The union of all variable names is
+    // stored, in the order they are first seen.
+    std::vector<std::string> param_names;
+    std::vector<DesignVarList> run_vars;
+    {
+        H5Unlock h5_unlock(h5_lock);
+        for (auto it = psf_filenames.begin(); it != psf_filenames.end(); ++it) {
+            std::string var_filename = find_design_var_file(*it);
+            run_vars.push_back(var_filename.empty() ? DesignVarList() : read_design_vars(var_filename));
+            for (auto itv = run_vars.back().begin(); itv != run_vars.back().end(); ++itv) {
+                if (std::find(param_names.begin(), param_names.end(), itv->first) == param_names.end()) {
+                    param_names.push_back(itv->first);
+                }
+            }
+        }
+    }
+
+    auto h5_file = create_hdf5_file(hdf5_filename, opts);
+    PSF_LOG_TRACE << "Writing header to file";
+    write_properties(*(first->m_prop_dict.get()), h5_file.get());
+
+    // append the only sweep variable to front of trace list, and drop the
+    // traces the filter does not select.
+    VarList all_vars(*(first->m_trace_list.get()));
+    all_vars.push_front(first->m_sweep_list->front());
+    std::vector<bool> keep = select_traces(*first, all_vars, opts);
+    VarList out_vars = get_selected(all_vars, keep);
+
+    // create [param_index, sweep_point] output datasets
+    hsize_t num_rows = psf_filenames.size();
+    size_t max_value_size = 0;
+    hsize_t block_points = get_sweep_block_points(*first, out_vars, opts, max_value_size);
+    H5::DSetCreatPropList dset_props = make_value_props(opts, max_points, block_points, max_value_size, num_rows);
+    hsize_t file_dim[2] = { num_rows, max_points };
+    H5::DataSpace file_space(2, file_dim, file_dim);
+    auto out_types = std::unique_ptr<std::list<TypeDef>>(new std::list<TypeDef>());
+    auto out_dsets = std::unique_ptr<DataSetList>(new DataSetList());
+    auto shared_props = make_shared_props(h5_file.get(), opts);
+    create_value_datasets(h5_file.get(), out_vars, *(first->m_type_map.get()), file_space, dset_props,
+        out_dsets.get(), out_types.get(), nullptr, shared_props.get());
+
+    // second pass: write the values of each file to its row.
+    for (hsize_t row = 0; row < num_rows; ++row) {
+        PSF_LOG_TRACE << "Merging " << psf_filenames[row];
+        ByteCursor data(psf_filenames[row]);
+        auto sections = read_merge_sections(data, psf_filenames[row], h5_lock);
+        WriteTarget target;
+        target.m_row = row;
+        read_values_swp(data, *sections, keep, out_dsets.get(), out_types.get(), opts, h5_lock, target);
+        data.close();
+    }
+    for (auto itd = out_dsets->begin(); itd != out_dsets->end(); ++itd) {
+        (*itd)->close();
+    }
+
+    // write number of valid points of each row
+    hsize_t row_dim[1] = { num_rows };
+    H5::DataSpace row_space(1, row_dim, row_dim);
+    H5::DataSet len_dset = h5_file->createDataSet(ROW_POINTS_NAME, H5::PredType::STD_U64LE, row_space);
+    len_dset.write(num_points.data(), H5::PredType::NATIVE_UINT64);
+    len_dset.close();
+
+    // write design variables of each row
+    H5::Group param_group = h5_file->createGroup(MERGE_PARAM_GROUP);
+    std::vector<double> param_vals(num_rows);
+    for (auto itn = param_names.begin(); itn != param_names.end(); ++itn) {
+        for (hsize_t row = 0; row < num_rows; ++row) {
+            param_vals[row] = std::numeric_limits<double>::quiet_NaN();
+            for (auto itv = run_vars[row].begin(); itv != run_vars[row].end(); ++itv) {
+                if (itv->first == *itn) {
+                    param_vals[row] = itv->second;
+                    break;
+                }
+            }
+        }
+        H5::DataSet param_dset = param_group.createDataSet(*itn, H5::PredType::IEEE_F64LE, row_space);
+        param_dset.write(param_vals.data(), H5::PredType::NATIVE_DOUBLE);
+        param_dset.close();
+    }
+    param_group.close();
+
+    PSF_LOG_TRACE << "Finished merging PSF files.";
+    h5_file->close();
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+
+#include "psfpool.hpp"
+
+using namespace psf;
+
+
+ThreadPool::ThreadPool(unsigned int num_threads) : m_queued(0), m_pending(0), m_next(0), m_stop(false) {
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (unsigned int idx = 0; idx < num_threads; ++idx) {
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (unsigned int idx = 0; idx < num_threads; ++idx) {
+        m_threads.push_back(std::thread(&ThreadPool::run, this, idx));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (auto & thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    unsigned int idx;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        idx = m_next;
+        m_next = (m_next + 1) % size();
+        ++m_queued;
+        ++m_pending;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_workers[idx]->m_mutex);
+        m_workers[idx]->m_jobs.push_back(std::move(job));
+    }
+    m_cond.notify_all();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this] { return m_pending == 0; });
+}
+
+/**
+ * Take a job from the front of our own queue, or steal one from the back
+ * of another worker's queue.
+ */
+bool ThreadPool::pop_job(unsigned int idx, std::function<void()> & job) {
+    unsigned int num_workers = size();
+    for (unsigned int offset = 0; offset < num_workers; ++offset) {
+        Worker & worker = *m_workers[(idx + offset) % num_workers];
+        std::lock_guard<std::mutex> lock(worker.m_mutex);
+        if (!worker.m_jobs.empty()) {
+            if (offset == 0) {
+                job = std::move(worker.m_jobs.front());
+                worker.m_jobs.pop_front();
+            }
+            else {
+                job = std::move(worker.m_jobs.back());
+                worker.m_jobs.pop_back();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(unsigned int idx) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_queued > 0 || m_stop; });
+            if (m_queued == 0) {
+                return;
+            }
+        }
+
+        std::function<void()> job;
+        if (!pop_job(idx, job)) {
+            // another worker got it first; the job may not be pushed yet either.
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_queued;
+        }
+
+        try {
+            job();
+        }
+        catch (...) {
+            // jobs report their own errors.
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        m_cond.notify_all();
+    }
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "psfascii.hpp"
+#include "psfreader.hpp"
+#include "psfscan.hpp"
+
+using namespace psf;
+
+namespace {
+
+    // returns the data type of an ASCII type, named as binary types are.
+    std::string get_data_type(const AsciiType & type) {
+        if (type.m_is_array) {
+            return "array";
+        }
+        switch (type.m_kind) {
+        case AsciiType::kind::FLOAT:
+            return "double";
+        case AsciiType::kind::INT:
+            return "int32";
+        case AsciiType::kind::COMPLEX:
+            return "complex";
+        case AsciiType::kind::STRING:
+            return "string";
+        default: {
+            std::string ans = "struct( ";
+            for (auto itm = type.m_members.begin(); itm != type.m_members.end(); ++itm) {
+                ans += get_data_type(*itm) + ", ";
+            }
+            return ans + ")";
+        }
+        }
+    }
+
+    SignalSummary make_signal(const std::string & name, const std::string & type_name, const PropDict & prop_dict) {
+        SignalSummary ans;
+        ans.m_name = name;
+        ans.m_type_name = type_name;
+        ans.m_prop_dict = prop_dict;
+        return ans;
+    }
+
+    std::unique_ptr<PsfSummary> scan_binary(const std::string & psf_filename) {
+        ByteCursor data(psf_filename);
+        if (!data.good()) {
+            std::ostringstream builder;
+            builder << "Error opening file " << psf_filename;
+            throw std::runtime_error(builder.str());
+        }
+
+        // reading types creates HDF5 data types, which are released before the lock.
+        H5Lock h5_lock;
+        auto sections = read_sections(data);
+        auto ans = std::unique_ptr<PsfSummary>(new PsfSummary());
+        ans->m_prop_dict = *(sections->m_prop_dict.get());
+        for (auto itt = sections->m_type_map->begin(); itt != sections->m_type_map->end(); ++itt) {
+            const TypeDef & type = itt->second;
+            TypeSummary summary;
+            summary.m_name = type.m_name;
+            summary.m_data_type = type.m_type_name;
+            summary.m_value_size = type.m_is_supported ? type.m_value_size : 0;
+            summary.m_prop_dict = type.m_prop_dict;
+            ans->m_types.push_back(summary);
+        }
+        const TypeMap & type_map = *(sections->m_type_map.get());
+        for (auto itv = sections->m_sweep_list->begin(); itv != sections->m_sweep_list->end(); ++itv) {
+            ans->m_sweeps.push_back(make_signal((*itv).m_name, type_map.at((*itv).m_type_id).m_name,
+                (*itv).m_prop_dict));
+        }
+        for (auto itv = sections->m_trace_list->begin(); itv != sections->m_trace_list->end(); ++itv) {
+            ans->m_traces.push_back(make_signal((*itv).m_name, type_map.at((*itv).m_type_id).m_name,
+                (*itv).m_prop_dict));
+        }
+        ans->m_num_points = sections->m_num_points;
+        ans->m_win_size = sections->m_win_size;
+        return ans;
+    }
+
+    std::unique_ptr<PsfSummary> scan_ascii(const std::string & psf_filename) {
+        auto psf = scan_psf_ascii(psf_filename);
+        auto ans = std::unique_ptr<PsfSummary>(new PsfSummary());
+        ans->m_is_ascii = true;
+        ans->m_prop_dict = psf->m_prop_dict;
+        for (auto itt = psf->m_types.begin(); itt != psf->m_types.end(); ++itt) {
+            TypeSummary summary;
+            summary.m_name = (*itt).m_name;
+            summary.m_data_type = get_data_type(*itt);
+            summary.m_value_size = (*itt).get_value_size();
+            summary.m_prop_dict = (*itt).m_prop_dict;
+            ans->m_types.push_back(summary);
+        }
+        for (auto itv = psf->m_sweeps.begin(); itv != psf->m_sweeps.end(); ++itv) {
+            ans->m_sweeps.push_back(make_signal((*itv).m_name, (*itv).m_type_name, (*itv).m_prop_dict));
+        }
+        for (auto itv = psf->m_traces.begin(); itv != psf->m_traces.end(); ++itv) {
+            ans->m_traces.push_back(make_signal((*itv).m_name, (*itv).m_type_name, (*itv).m_prop_dict));
+        }
+        ans->m_num_points = psf->m_num_points;
+        return ans;
+    }
+
+    // write properties as a JSON object, sorted by name so the output is stable.
+    void write_props(std::ostringstream & builder, const PropDict & prop_dict) {
+        std::vector<const Property *> props;
+        for (auto itp = prop_dict.begin(); itp != prop_dict.end(); ++itp) {
+            props.push_back(&(itp->second));
+        }
+        std::sort(props.begin(), props.end(), [](const Property * a, const Property * b) {
+            return a->m_name < b->m_name;
+        });
+        builder << "{";
+        for (size_t idx = 0; idx < props.size(); ++idx) {
+            const Property & prop = *props[idx];
+            builder << ((idx > 0) ? ", " : "") << json_quote(prop.m_name) << ": ";
+            switch (prop.m_type) {
+            case Property::type::INT:
+                builder << prop.m_ival;
+                break;
+            case Property::type::DOUBLE:
+                // JSON has no infinities or NaN.
+                if (std::isfinite(prop.m_dval)) {
+                    builder << prop.m_dval;
+                }
+                else {
+                    builder << "null";
+                }
+                break;
+            default:
+                builder << json_quote(prop.m_sval);
+            }
+        }
+        builder << "}";
+    }
+
+    void write_signals(std::ostringstream & builder, const std::vector<SignalSummary> & signals) {
+        builder << "[";
+        for (size_t idx = 0; idx < signals.size(); ++idx) {
+            builder << ((idx > 0) ? ", " : "") << "{\"name\": " << json_quote(signals[idx].m_name) <<
+                ", \"type\": " << json_quote(signals[idx].m_type_name) << ", \"properties\": ";
+            write_props(builder, signals[idx].m_prop_dict);
+            builder << "}";
+        }
+        builder << "]";
+    }
+
+}
+
+std::string PsfSummary::to_json() const {
+    std::ostringstream builder;
+    builder.precision(17);
+    builder << "{\"format\": " << (m_is_ascii ? "\"ascii\"" : "\"binary\"") << ", \"num_points\": " <<
+        m_num_points << ", \"window_size\": " << m_win_size << ", \"properties\": ";
+    write_props(builder, m_prop_dict);
+    builder << ", \"types\": [";
+    for (size_t idx = 0; idx < m_types.size(); ++idx) {
+        builder << ((idx > 0) ? ", " : "") << "{\"name\": " << json_quote(m_types[idx].m_name) <<
+            ", \"data_type\": " << json_quote(m_types[idx].m_data_type) << ", \"value_size\": " <<
+            m_types[idx].m_value_size << ", \"properties\": ";
+        write_props(builder, m_types[idx].m_prop_dict);
+        builder << "}";
+    }
+    builder << "], \"sweeps\": ";
+    write_signals(builder, m_sweeps);
+    builder << ", \"traces\": ";
+    write_signals(builder, m_traces);
+    builder << "}";
+    return builder.str();
+}
+
+std::unique_ptr<PsfSummary> psf::scan_psf(const std::string & psf_filename) {
+    return is_ascii_psf(psf_filename) ? scan_ascii(psf_filename) : scan_binary(psf_filename);
+}
@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "psfstats.hpp"
+
+using namespace psf;
+
+namespace {
+
+    void write_stage(std::ostringstream & builder, const char * name, const StageStats & stage_stats) {
+        builder << "\"" << name << "\": {\"wall_seconds\": " << stage_stats.m_wall_seconds <<
+            ", \"cpu_seconds\": " << stage_stats.m_cpu_seconds << "}";
+    }
+
+}
+
+const char * ConvertStats::get_stage_name(ConvertStats::stage stage_id) {
+    switch (stage_id) {
+    case stage::METADATA_PARSE:
+        return "metadata_parse";
+    case stage::DECODE:
+        return "decode";
+    case stage::HDF5_CREATE:
+        return "hdf5_create";
+    case stage::HDF5_WRITE:
+        return "hdf5_write";
+    case stage::ATTRIBUTE_WRITE:
+        return "attribute_write";
+    default:
+        return "unknown";
+    }
+}
+
+std::string ConvertStats::to_json() const {
+    std::ostringstream builder;
+    builder << "{\"section_bytes\": {\"header\": " << m_header_bytes << ", \"type\": " << m_type_bytes <<
+        ", \"sweep\": " << m_sweep_bytes << ", \"trace\": " << m_trace_bytes << ", \"value\": " <<
+        m_value_bytes << "}";
+    builder << ", \"num_points\": " << m_num_points << ", \"num_traces\": " << m_num_traces;
+    builder << ", \"stages\": {";
+    for (int idx = 0; idx < NUM_STAGES; ++idx) {
+        if (idx > 0) {
+            builder << ", ";
+        }
+        write_stage(builder, get_stage_name(static_cast<ConvertStats::stage>(idx)), m_stages[idx]);
+    }
+    builder << "}, ";
+    write_stage(builder, "total", m_total);
+    builder << ", \"num_write_calls\": " << m_num_write_calls << ", \"num_attributes\": " << m_num_attributes <<
+        ", \"peak_buffer_bytes\": " << m_peak_buffer_bytes << "}";
+    return builder.str();
+}
+
+std::string psf::json_quote(const std::string & val) {
+    std::ostringstream builder;
+    builder << '"';
+    for (auto itc = val.begin(); itc != val.end(); ++itc) {
+        unsigned char c = static_cast<unsigned char>(*itc);
+        if (c == '"' || c == '\\') {
+            builder << '\\' << *itc;
+        }
+        else if (c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            builder << buf;
+        }
+        else {
+            builder << *itc;
+        }
+    }
+    builder << '"';
+    return builder.str();
+}
+
+double psf::get_thread_cpu_seconds() {
+#ifdef _WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+        return 0.0;
+    }
+    // FILETIME counts 100 ns intervals.
+    uint64_t kernel = (static_cast<uint64_t>(kernel_time.dwHighDateTime) << 32) | kernel_time.dwLowDateTime;
+    uint64_t user = (static_cast<uint64_t>(user_time.dwHighDateTime) << 32) | user_time.dwLowDateTime;
+    return (kernel + user) * 1.0e-7;
+#else
+    struct timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+        return 0.0;
+    }
+    return now.tv_sec + now.tv_nsec * 1.0e-9;
+#endif
+}
+
+StageTimer::StageTimer(ConvertStats * stats, ConvertStats::stage stage_id) :
+    m_stage((stats == nullptr) ? nullptr : &stats->m_stages[stage_id]), m_cpu_start(0.0) {
+    if (m_stage != nullptr) {
+        m_start = std::chrono::steady_clock::now();
+        m_cpu_start = get_thread_cpu_seconds();
+    }
+}
+
+StageTimer::StageTimer(StageStats * stage_stats) : m_stage(stage_stats), m_cpu_start(0.0) {
+    if (m_stage != nullptr) {
+        m_start = std::chrono::steady_clock::now();
+        m_cpu_start = get_thread_cpu_seconds();
+    }
+}
+
+void StageTimer::stop() {
+    if (m_stage == nullptr) {
+        return;
+    }
+    m_stage->m_wall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    m_stage->m_cpu_seconds += get_thread_cpu_seconds() - m_cpu_start;
+    m_stage = nullptr;
+}
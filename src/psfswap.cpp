@@ -0,0 +1,322 @@
+#include <cstring>
+
+#include "psfswap.hpp"
+
+#if !defined(PSF_NO_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define PSF_SWAP_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and clang need the target attribute to emit SSSE3/AVX2 code in a
+// translation unit compiled for the baseline instruction set.
+#if defined(__GNUC__) || defined(__clang__)
+#define PSF_TARGET(arch) __attribute__((target(arch)))
+#else
+#define PSF_TARGET(arch)
+#endif
+
+using namespace psf;
+
+namespace {
+
+    typedef void (*swap_fn)(const char *, char *, size_t);
+
+    inline uint32_t bswap32(uint32_t val) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_bswap32(val);
+#else
+        return ((val & 0xff000000u) >> 24) | ((val & 0x00ff0000u) >> 8) |
+            ((val & 0x0000ff00u) << 8) | ((val & 0x000000ffu) << 24);
+#endif
+    }
+
+    inline uint64_t bswap64(uint64_t val) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_bswap64(val);
+#else
+        return (uint64_t(bswap32(uint32_t(val))) << 32) | bswap32(uint32_t(val >> 32));
+#endif
+    }
+
+    void swap_32_scalar(const char * src, char * dst, size_t count) {
+        for (size_t idx = 0; idx < count; ++idx) {
+            uint32_t val;
+            memcpy(&val, src + 4 * idx, 4);
+            val = bswap32(val);
+            memcpy(dst + 4 * idx, &val, 4);
+        }
+    }
+
+    void swap_64_scalar(const char * src, char * dst, size_t count) {
+        for (size_t idx = 0; idx < count; ++idx) {
+            uint64_t val;
+            memcpy(&val, src + 8 * idx, 8);
+            val = bswap64(val);
+            memcpy(dst + 8 * idx, &val, 8);
+        }
+    }
+
+#ifdef PSF_SWAP_X86
+
+    PSF_TARGET("ssse3")
+    void swap_32_ssse3(const char * src, char * dst, size_t count) {
+        const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        size_t idx = 0;
+        for (; idx + 4 <= count; idx += 4) {
+            __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * idx));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * idx), _mm_shuffle_epi8(val, mask));
+        }
+        swap_32_scalar(src + 4 * idx, dst + 4 * idx, count - idx);
+    }
+
+    PSF_TARGET("ssse3")
+    void swap_64_ssse3(const char * src, char * dst, size_t count) {
+        const __m128i mask = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+        size_t idx = 0;
+        for (; idx + 2 <= count; idx += 2) {
+            __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 8 * idx));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 8 * idx), _mm_shuffle_epi8(val, mask));
+        }
+        swap_64_scalar(src + 8 * idx, dst + 8 * idx, count - idx);
+    }
+
+    PSF_TARGET("avx2")
+    void swap_32_avx2(const char * src, char * dst, size_t count) {
+        const __m256i mask = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+            12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        size_t idx = 0;
+        for (; idx + 8 <= count; idx += 8) {
+            __m256i val = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * idx));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * idx), _mm256_shuffle_epi8(val, mask));
+        }
+        swap_32_scalar(src + 4 * idx, dst + 4 * idx, count - idx);
+    }
+
+    PSF_TARGET("avx2")
+    void swap_64_avx2(const char * src, char * dst, size_t count) {
+        const __m256i mask = _mm256_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+            8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+        size_t idx = 0;
+        for (; idx + 4 <= count; idx += 4) {
+            __m256i val = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 8 * idx));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 8 * idx), _mm256_shuffle_epi8(val, mask));
+        }
+        swap_64_scalar(src + 8 * idx, dst + 8 * idx, count - idx);
+    }
+
+    bool cpu_has_avx2() {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        // AVX2 also needs the OS to save YMM registers.
+        bool os_ymm = ((info[2] & (1 << 27)) != 0) && ((_xgetbv(0) & 6) == 6);
+        __cpuidex(info, 7, 0);
+        return os_ymm && ((info[1] & (1 << 5)) != 0);
+#else
+        return false;
+#endif
+    }
+
+    bool cpu_has_ssse3() {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_cpu_supports("ssse3");
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 9)) != 0;
+#else
+        return false;
+#endif
+    }
+
+#endif
+
+    // the kernels selected for this CPU.
+    struct SwapKernels {
+        SwapKernels() : m_name("scalar"), m_swap_32(swap_32_scalar), m_swap_64(swap_64_scalar) {
+#ifdef PSF_SWAP_X86
+            if (cpu_has_avx2()) {
+                m_name = "avx2";
+                m_swap_32 = swap_32_avx2;
+                m_swap_64 = swap_64_avx2;
+            }
+            else if (cpu_has_ssse3()) {
+                m_name = "ssse3";
+                m_swap_32 = swap_32_ssse3;
+                m_swap_64 = swap_64_ssse3;
+            }
+#endif
+        }
+
+        const char * m_name;
+        swap_fn m_swap_32;
+        swap_fn m_swap_64;
+    };
+
+    const SwapKernels & get_kernels() {
+        // initialized once, thread-safe in C++11.
+        static const SwapKernels kernels;
+        return kernels;
+    }
+
+    // decode one member of the given width.  The value is loaded before it
+    // is stored, so src and dst may overlap.
+    template <size_t Width>
+    inline void decode_member(const char * src, char * dst);
+
+    template <>
+    inline void decode_member<1>(const char * src, char * dst) {
+        *dst = *src;
+    }
+
+    template <>
+    inline void decode_member<4>(const char * src, char * dst) {
+        uint32_t val;
+        memcpy(&val, src, sizeof(val));
+        val = bswap32(val);
+        memcpy(dst, &val, sizeof(val));
+    }
+
+    template <>
+    inline void decode_member<8>(const char * src, char * dst) {
+        uint64_t val;
+        memcpy(&val, src, sizeof(val));
+        val = bswap64(val);
+        memcpy(dst, &val, sizeof(val));
+    }
+
+    // decode count records whose members all have the given width.
+    template <size_t Width>
+    void decode_records(const std::vector<DecodeStep> & steps, size_t src_size, size_t dst_size,
+        const char * src, char * dst, size_t count) {
+        for (size_t idx = 0; idx < count; ++idx, src += src_size, dst += dst_size) {
+            for (auto its = steps.begin(); its != steps.end(); ++its) {
+                decode_member<Width>(src + its->m_src_offset, dst + its->m_dst_offset);
+            }
+        }
+    }
+
+    // decode count records of mixed member widths.
+    void decode_records_mixed(const std::vector<DecodeStep> & steps, size_t src_size, size_t dst_size,
+        const char * src, char * dst, size_t count) {
+        for (size_t idx = 0; idx < count; ++idx, src += src_size, dst += dst_size) {
+            for (auto its = steps.begin(); its != steps.end(); ++its) {
+                switch (its->m_width) {
+                case 8:
+                    decode_member<8>(src + its->m_src_offset, dst + its->m_dst_offset);
+                    break;
+                case 4:
+                    decode_member<4>(src + its->m_src_offset, dst + its->m_dst_offset);
+                    break;
+                default:
+                    decode_member<1>(src + its->m_src_offset, dst + its->m_dst_offset);
+                }
+            }
+        }
+    }
+
+}
+
+bool psf::host_is_little_endian() {
+    const uint32_t val = 1;
+    uint8_t first;
+    memcpy(&first, &val, 1);
+    return first == 1;
+}
+
+const char * psf::swap_kernel_name() {
+    return get_kernels().m_name;
+}
+
+void psf::swap_bytes_32(const char * src, char * dst, size_t count) {
+    get_kernels().m_swap_32(src, dst, count);
+}
+
+void psf::swap_bytes_64(const char * src, char * dst, size_t count) {
+    get_kernels().m_swap_64(src, dst, count);
+}
+
+DecodePlan DecodePlan::scalar(size_t width, size_t src_size) {
+    DecodePlan ans;
+    ans.m_src_size = src_size;
+    ans.m_dst_size = width;
+    ans.m_steps.push_back(DecodeStep(src_size - width, 0, width));
+    ans.select_kernel();
+    return ans;
+}
+
+void DecodePlan::append(const DecodePlan & member) {
+    for (auto its = member.m_steps.begin(); its != member.m_steps.end(); ++its) {
+        m_steps.push_back(DecodeStep(m_src_size + its->m_src_offset, m_dst_size + its->m_dst_offset,
+            its->m_width));
+    }
+    m_src_size += member.m_src_size;
+    m_dst_size += member.m_dst_size;
+    select_kernel();
+}
+
+/**
+ * Use a bulk swap kernel if records are packed words of one size, so the
+ * whole buffer is one array of words.
+ */
+void DecodePlan::select_kernel() {
+    m_kernel = kernel::NONE;
+    m_width = m_steps.empty() ? 0 : m_steps.front().m_width;
+    if (m_steps.empty()) {
+        return;
+    }
+    size_t offset = 0;
+    bool packed = (m_src_size == m_dst_size);
+    for (auto its = m_steps.begin(); its != m_steps.end(); ++its) {
+        if (its->m_width != m_width) {
+            m_width = 0;
+        }
+        packed = packed && its->m_src_offset == offset && its->m_dst_offset == offset;
+        offset += its->m_width;
+    }
+    packed = packed && offset == m_src_size;
+    if (packed && m_width == sizeof(uint64_t)) {
+        m_kernel = kernel::SWAP64;
+    }
+    else if (packed && m_width == sizeof(uint32_t)) {
+        m_kernel = kernel::SWAP32;
+    }
+    else {
+        m_kernel = kernel::GENERIC;
+    }
+}
+
+void DecodePlan::decode(const char * src, char * dst, size_t count) const {
+    switch (m_kernel) {
+    case kernel::SWAP64:
+        swap_bytes_64(src, dst, count * m_src_size / sizeof(uint64_t));
+        break;
+    case kernel::SWAP32:
+        swap_bytes_32(src, dst, count * m_src_size / sizeof(uint32_t));
+        break;
+    case kernel::GENERIC:
+        switch (m_width) {
+        case 1:
+            decode_records<1>(m_steps, m_src_size, m_dst_size, src, dst, count);
+            break;
+        case sizeof(uint32_t):
+            decode_records<4>(m_steps, m_src_size, m_dst_size, src, dst, count);
+            break;
+        case sizeof(uint64_t):
+            decode_records<8>(m_steps, m_src_size, m_dst_size, src, dst, count);
+            break;
+        default:
+            decode_records_mixed(m_steps, m_src_size, m_dst_size, src, dst, count);
+        }
+        break;
+    default:
+        if (src != dst) {
+            memcpy(dst, src, count * m_src_size);
+        }
+    }
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cstring>
+
+#include "psf.hpp"
+#include "psftable.hpp"
+
+using namespace psf;
+
+namespace {
+
+    // returns a fixed-length string type of the given length (at least 1).
+    H5::StrType make_str_type(size_t len) {
+        // HDF5 strings cannot be empty.
+        H5::StrType ans(H5::PredType::C_S1, std::max(len, static_cast<size_t>(1)));
+        ans.setStrpad(H5T_STR_NULLPAD);
+        return ans;
+    }
+
+    // write a 1-D dataset of count elements to loc.
+    void write_column(H5::H5Location * loc, const char * name, const H5::DataType & mem_type,
+        const H5::DataType & file_type, const void * buf, hsize_t count, ConvertStats * stats) {
+        hsize_t dim[1] = { count };
+        H5::DataSpace space(1, dim, dim);
+        StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+        H5::DataSet dset = loc->createDataSet(name, file_type, space);
+        create_timer.stop();
+        StageTimer write_timer(stats, ConvertStats::stage::HDF5_WRITE);
+        dset.write(buf, mem_type, space, space);
+        write_timer.stop();
+        dset.close();
+        if (stats != nullptr) {
+            ++stats->m_num_write_calls;
+        }
+    }
+
+}
+
+std::string psf::escape_link_name(const std::string & name) {
+    if (name == ".") {
+        return "%2E";
+    }
+    std::string ans;
+    for (auto itc = name.begin(); itc != name.end(); ++itc) {
+        if (*itc == '%') {
+            ans += "%25";
+        }
+        else if (*itc == '/') {
+            ans += "%2F";
+        }
+        else {
+            ans += *itc;
+        }
+    }
+    return ans;
+}
+
+void psf::write_name_column(H5::H5Location * loc, const char * dset_name, const std::vector<std::string> & names,
+    ConvertStats * stats) {
+    size_t name_len = 1;
+    for (auto itn = names.begin(); itn != names.end(); ++itn) {
+        name_len = std::max(name_len, (*itn).size());
+    }
+    std::vector<char> buffer(names.size() * name_len, 0);
+    for (size_t idx = 0; idx < names.size(); ++idx) {
+        memcpy(buffer.data() + idx * name_len, names[idx].data(), names[idx].size());
+    }
+    H5::StrType name_type = make_str_type(name_len);
+    write_column(loc, dset_name, name_type, name_type, buffer.data(), names.size(), stats);
+}
+
+void psf::write_property_table(H5::H5Location * loc, const std::vector<uint32_t> & rows,
+    const std::vector<Property> & props, ConvertStats * stats) {
+    size_t name_len = 1, str_len = 1;
+    for (auto itp = props.begin(); itp != props.end(); ++itp) {
+        name_len = std::max(name_len, (*itp).m_name.size());
+        str_len = std::max(str_len, (*itp).m_sval.size());
+    }
+    // records are packed: row, type, int, double, name, string.
+    const size_t int_offset = 2 * sizeof(int32_t);
+    const size_t double_offset = 3 * sizeof(int32_t);
+    const size_t name_offset = double_offset + sizeof(double);
+    const size_t str_offset = name_offset + name_len;
+    const size_t record_size = str_offset + str_len;
+    H5::StrType name_type = make_str_type(name_len);
+    H5::StrType str_type = make_str_type(str_len);
+
+    H5::CompType mem_type(record_size);
+    mem_type.insertMember("row", 0, H5::PredType::NATIVE_UINT32);
+    mem_type.insertMember("type", sizeof(int32_t), H5::PredType::NATIVE_INT32);
+    mem_type.insertMember("int", int_offset, H5::PredType::NATIVE_INT32);
+    mem_type.insertMember("double", double_offset, H5::PredType::NATIVE_DOUBLE);
+    mem_type.insertMember("name", name_offset, name_type);
+    mem_type.insertMember("string", str_offset, str_type);
+    H5::CompType file_type(record_size);
+    file_type.insertMember("row", 0, H5::PredType::STD_U32LE);
+    file_type.insertMember("type", sizeof(int32_t), H5::PredType::STD_I32LE);
+    file_type.insertMember("int", int_offset, H5::PredType::STD_I32LE);
+    file_type.insertMember("double", double_offset, H5::PredType::IEEE_F64LE);
+    file_type.insertMember("name", name_offset, name_type);
+    file_type.insertMember("string", str_offset, str_type);
+
+    std::vector<char> buffer(props.size() * record_size, 0);
+    for (size_t idx = 0; idx < props.size(); ++idx) {
+        const Property & prop = props[idx];
+        char * dst = buffer.data() + idx * record_size;
+        int32_t type_id = static_cast<int32_t>(prop.m_type);
+        int32_t ival = prop.m_ival;
+        memcpy(dst, &rows[idx], sizeof(uint32_t));
+        memcpy(dst + sizeof(int32_t), &type_id, sizeof(int32_t));
+        memcpy(dst + int_offset, &ival, sizeof(int32_t));
+        memcpy(dst + double_offset, &prop.m_dval, sizeof(double));
+        memcpy(dst + name_offset, prop.m_name.data(), prop.m_name.size());
+        memcpy(dst + str_offset, prop.m_sval.data(), prop.m_sval.size());
+    }
+    write_column(loc, "properties", mem_type, file_type, buffer.data(), props.size(), stats);
+}
+
+void ValueTable::add(const std::string & name, const char * value, const PropDict & prop_dict) {
+    uint32_t row = static_cast<uint32_t>(m_names.size());
+    m_names.push_back(name);
+    m_values.insert(m_values.end(), value, value + m_value_size);
+    for (auto itp = prop_dict.begin(); itp != prop_dict.end(); ++itp) {
+        m_prop_rows.push_back(row);
+        m_props.push_back(itp->second);
+    }
+}
+
+void ValueTable::write(H5::H5Location * loc, const std::string & table_name, ConvertStats * stats) const {
+    StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+    H5::Group group = loc->createGroup(table_name.c_str());
+    create_timer.stop();
+
+    write_column(&group, "values", m_mem_type, m_file_type, m_values.data(), m_names.size(), stats);
+    write_name_column(&group, "names", m_names, stats);
+    if (!m_props.empty()) {
+        write_property_table(&group, m_prop_rows, m_props, stats);
+    }
+    group.close();
+}
+
+ValueTable & ValueTableSet::get_table(const std::string & type_name, const H5::DataType & mem_type,
+    const H5::DataType & file_type, size_t value_size) {
+    std::string table_name = type_name;
+    for (uint32_t suffix = 1; ; ++suffix) {
+        auto it = m_tables.find(table_name);
+        if (it == m_tables.end()) {
+            break;
+        }
+        if (it->second.m_file_type == file_type && it->second.m_value_size == value_size) {
+            return it->second;
+        }
+        table_name = type_name + "_" + std::to_string(suffix);
+    }
+    m_order.push_back(table_name);
+    return m_tables.emplace(table_name, ValueTable(mem_type, file_type, value_size)).first->second;
+}
+
+void ValueTableSet::write(H5::H5Location * loc, ConvertStats * stats) const {
+    if (m_order.empty()) {
+        return;
+    }
+    StageTimer create_timer(stats, ConvertStats::stage::HDF5_CREATE);
+    H5::Group group = loc->createGroup(TABLES_NAME);
+    create_timer.stop();
+    for (auto itn = m_order.begin(); itn != m_order.end(); ++itn) {
+        m_tables.at(*itn).write(&group, escape_link_name(*itn), stats);
+    }
+    group.close();
+}
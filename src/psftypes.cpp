@@ -15,20 +15,20 @@ using namespace psf;
  * ...
  *
  */
-std::vector<int> read_type_list(std::ifstream & data, std::map<const uint32_t, TypeDef> * type_lookup) {
+std::vector<int> read_type_list(ByteCursor & data, std::map<const uint32_t, TypeDef> * type_lookup) {
 
     std::vector<int> ans;
     bool valid_type = true;
     while (valid_type) {
         uint32_t code = read_uint32(data);
         if (code != TypeDef::tuple_code) {
-            LOG(TRACE) << "Read code = " << code << " != " <<
+            PSF_LOG_TRACE << "Read code = " << code << " != " <<
                 TypeDef::tuple_code << ", Stopping";
             undo_read_uint32(data);
             return ans;
         }
 
-        LOG(TRACE) << "Reading element of TypeDef Tuple";
+        PSF_LOG_TRACE << "Reading element of TypeDef Tuple";
         TypeDef temp;
         valid_type = temp.read(data, type_lookup);
         if (valid_type) {
@@ -65,10 +65,10 @@ std::vector<int> read_type_list(std::ifstream & data, std::map<const uint32_t, T
  * ...
  *
  */
-bool TypeDef::read(std::ifstream & data, std::map<const uint32_t, TypeDef> * type_lookup) {
+bool TypeDef::read(ByteCursor & data, std::map<const uint32_t, TypeDef> * type_lookup) {
     uint32_t code = read_uint32(data);
     if (code != TypeDef::code) {
-        LOG(TRACE) << "Invalid TypeDef code " << code << ", expected " << TypeDef::code;
+        PSF_LOG_TRACE << "Invalid TypeDef code " << code << ", expected " << TypeDef::code;
         undo_read_uint32(data);
         return false;
     }
@@ -78,7 +78,7 @@ bool TypeDef::read(std::ifstream & data, std::map<const uint32_t, TypeDef> * typ
     m_array_type = read_uint32(data);
     m_data_type = read_uint32(data);
 
-    LOG(TRACE) << "TypeDef = (" << m_id << ", " << m_name <<
+    PSF_LOG_TRACE << "TypeDef = (" << m_id << ", " << m_name <<
         ", " << m_array_type << ", " << m_data_type << ")";
 
     m_is_supported = true;
@@ -88,25 +88,28 @@ bool TypeDef::read(std::ifstream & data, std::map<const uint32_t, TypeDef> * typ
     std::vector<int> subtypes;
     size_t read_size = 0, write_size = 0;
     std::ostringstream strbuilder;
-    m_read_offset = 0;
-    m_read_stride = 1;
+    m_read_size = 0;
+    m_value_size = 0;
+    m_plan = DecodePlan();
     std::string rname("r"), iname("i");
     switch (m_data_type) {
     case TypeDef::TYPEID_INT8:
         m_h5_read_type = H5::PredType::STD_I8BE;
         m_h5_write_type = H5::PredType::STD_I8LE;
-        m_read_offset = WORD_SIZE - BYTE_SIZE;
-        m_read_stride = WORD_SIZE;
+        // int8 values take a whole word, with the value in its last byte.
+        m_plan = DecodePlan::scalar(BYTE_SIZE, WORD_SIZE);
         m_type_name = "int8";
         break;
     case TypeDef::TYPEID_INT32:
         m_h5_read_type = H5::PredType::STD_I32BE;
         m_h5_write_type = H5::PredType::STD_I32LE;
+        m_plan = DecodePlan::scalar(WORD_SIZE, WORD_SIZE);
         m_type_name = "int32";
         break;
     case TypeDef::TYPEID_DOUBLE:
         m_h5_read_type = H5::PredType::IEEE_F64BE;
         m_h5_write_type = H5::PredType::IEEE_F64LE;
+        m_plan = DecodePlan::scalar(DOUB_SIZE, DOUB_SIZE);
         m_type_name = "double";
         break;
     case TypeDef::TYPEID_COMPLEXDOUBLE:
@@ -119,11 +122,14 @@ bool TypeDef::read(std::ifstream & data, std::map<const uint32_t, TypeDef> * typ
 
         m_h5_read_type = comp_read_type;
         m_h5_write_type = comp_write_type;
+        m_plan.append(DecodePlan::scalar(DOUB_SIZE, DOUB_SIZE));
+        m_plan.append(DecodePlan::scalar(DOUB_SIZE, DOUB_SIZE));
         m_type_name = "complex";
         break;
     case TypeDef::TYPEID_STRUCT:
         // read subtype definitions first
         subtypes = read_type_list(data, type_lookup);
+        m_member_ids.assign(subtypes.begin(), subtypes.end());
         // check all subtypes are supported, calculate total size, and build string name.
         strbuilder << "struct( ";
         for (int sub_id : subtypes) {
@@ -155,6 +161,11 @@ bool TypeDef::read(std::ifstream & data, std::map<const uint32_t, TypeDef> * typ
             }
             m_h5_read_type = comp_read_type;
             m_h5_write_type = comp_write_type;
+
+            // members are decoded back to back, as laid out in m_h5_write_type.
+            for (int sub_id : subtypes) {
+                m_plan.append(type_lookup->at(sub_id).m_plan);
+            }
         }
         break;
     case TypeDef::TYPEID_STRING:
@@ -169,8 +180,17 @@ bool TypeDef::read(std::ifstream & data, std::map<const uint32_t, TypeDef> * typ
         m_is_supported = false;
     }
 
+    if (m_is_supported) {
+        m_read_size = m_plan.m_src_size;
+        m_value_size = can_swap() ? m_plan.m_dst_size : m_read_size;
+        if (!can_swap() && m_read_size != m_h5_read_type.getSize()) {
+            // values are padded in the file, so HDF5 cannot convert them as read.
+            m_is_supported = false;
+        }
+    }
+
     // serialize properties
-    LOG(TRACE) << "Reading TypeDef Properties";
+    PSF_LOG_TRACE << "Reading TypeDef Properties";
     m_prop_dict.read(data);
     type_lookup->emplace(m_id, *this);
     return true;
@@ -189,10 +209,10 @@ bool TypeDef::read(std::ifstream & data, std::map<const uint32_t, TypeDef> * typ
  * ...
  *
  */
-bool Variable::read(std::ifstream & data) {
+bool Variable::read(ByteCursor & data) {
     uint32_t code = read_uint32(data);
     if (code != Variable::code) {
-        LOG(TRACE) << "Invalid Variable code " << code << ", expected " << Variable::code;
+        PSF_LOG_TRACE << "Invalid Variable code " << code << ", expected " << Variable::code;
         undo_read_uint32(data);
         return false;
     }
@@ -201,10 +221,10 @@ bool Variable::read(std::ifstream & data) {
     m_name = read_str(data);
     m_type_id = read_uint32(data);
 
-    LOG(TRACE) << "Variable = (" << m_id << ", " << m_name << ", " << m_type_id << ")";
+    PSF_LOG_TRACE << "Variable = (" << m_id << ", " << m_name << ", " << m_type_id << ")";
 
     // serialize properties
-    LOG(TRACE) << "Reading Variable Properties";
+    PSF_LOG_TRACE << "Reading Variable Properties";
     m_prop_dict.read(data);
 
     return true;
@@ -223,10 +243,10 @@ bool Variable::read(std::ifstream & data) {
  * ...
  *
  */
-bool Group::read(std::ifstream & data) {
+bool Group::read(ByteCursor & data) {
     uint32_t code = read_uint32(data);
     if (code != Group::code) {
-        LOG(TRACE) << "Invalid Group code " << code << ", expected " << Group::code;
+        PSF_LOG_TRACE << "Invalid Group code " << code << ", expected " << Group::code;
         undo_read_uint32(data);
         return false;
     }
@@ -235,9 +255,9 @@ bool Group::read(std::ifstream & data) {
     m_name = read_str(data);
     uint32_t len = read_uint32(data);
 
-    LOG(TRACE) << "Group = (" << m_id << ", " << m_name << ", " << len << ")";
+    PSF_LOG_TRACE << "Group = (" << m_id << ", " << m_name << ", " << len << ")";
 
-    LOG(TRACE) << "Reading Variable list";
+    PSF_LOG_TRACE << "Reading Variable list";
     bool valid = true;
     for (uint32_t i = 0; i < len; i++) {
         Variable temp;
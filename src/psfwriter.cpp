@@ -0,0 +1,302 @@
+#include "psfwriter.hpp"
+
+using namespace psf;
+
+
+std::mutex & psf::hdf5_mutex() {
+    static std::mutex ans;
+    return ans;
+}
+
+BlockWriter::BlockWriter(DataSetList * dsets, std::list<TypeDef> * type_list, WriteTarget * target,
+    hsize_t block_points, bool pipelined, uint32_t num_blocks, ConvertStats * stats) : m_dsets(dsets),
+    m_type_list(type_list), m_target(target), m_pipelined(pipelined), m_stats(stats), m_last_inner(0),
+    m_inner_dir(0), m_num_cols(0), m_stop(false) {
+
+    // a serial writer only ever needs one block.
+    num_blocks = m_pipelined ? std::max(num_blocks, static_cast<uint32_t>(2)) : 1;
+    size_t buffer_bytes = 0;
+    for (uint32_t idx = 0; idx < num_blocks; ++idx) {
+        auto block = std::unique_ptr<ValueBlock>(new ValueBlock());
+        for (auto itv = m_type_list->begin(); itv != m_type_list->end(); ++itv) {
+            block->m_columns.push_back(std::unique_ptr<char[]>(new char[(*itv).m_read_size * block_points]));
+            buffer_bytes += (*itv).m_read_size * block_points;
+        }
+        m_free.push_back(block.get());
+        m_blocks.push_back(std::move(block));
+    }
+    if (m_stats != nullptr) {
+        m_stats->m_peak_buffer_bytes = std::max(m_stats->m_peak_buffer_bytes, buffer_bytes);
+    }
+
+    if (m_pipelined) {
+        m_thread = std::thread(&BlockWriter::run, this);
+    }
+}
+
+BlockWriter::~BlockWriter() {
+    stop();
+}
+
+ValueBlock * BlockWriter::acquire() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this] { return !m_free.empty() || m_error; });
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    ValueBlock * ans = m_free.front();
+    m_free.pop_front();
+    return ans;
+}
+
+void BlockWriter::submit(ValueBlock * block) {
+    if (!m_pipelined) {
+        write_block(block);
+        m_free.push_back(block);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_full.push_back(block);
+    }
+    m_cond.notify_all();
+}
+
+void BlockWriter::finish() {
+    if (m_pipelined) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this] { return m_full.empty() && m_free.size() == m_blocks.size(); });
+    }
+    stop();
+    check_error();
+}
+
+/**
+ * Writer thread main loop.  Write filled blocks in submission order until stopped.
+ */
+void BlockWriter::run() {
+    while (true) {
+        ValueBlock * block;
+        bool failed;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return !m_full.empty() || m_stop; });
+            if (m_full.empty()) {
+                return;
+            }
+            block = m_full.front();
+            m_full.pop_front();
+            failed = static_cast<bool>(m_error);
+        }
+
+        try {
+            // after an error, just recycle blocks until the decoder sees it.
+            if (!failed) {
+                write_block(block);
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(block);
+        }
+        m_cond.notify_all();
+    }
+}
+
+/**
+ * Write each column of the block with one hyperslab write.
+ */
+void BlockWriter::write_block(ValueBlock * block) {
+    if (m_target->m_num_outer > 0) {
+        write_nested_block(block);
+        return;
+    }
+
+    H5Lock h5_lock;
+    StageTimer timer(m_stats, ConvertStats::stage::HDF5_WRITE);
+    hsize_t mem_dim[1] = { block->m_count };
+    hsize_t file_offset[2] = { m_target->m_row, block->m_offset };
+    hsize_t count[2] = { 1, block->m_count };
+    hsize_t unit_step[2] = { 1, 1 };
+    H5::DataSpace mem_space(1, mem_dim, mem_dim);
+
+    auto itv = m_type_list->begin();
+    auto itd = m_dsets->begin();
+    for (size_t col = 0; itv != m_type_list->end(); ++itv, ++itd, ++col) {
+        H5::DataSpace file_space = (*itd)->getSpace();
+        if (!m_target->m_rows.empty()) {
+            file_offset[0] = m_target->m_rows[col];
+        }
+        if (file_space.getSimpleExtentNdims() == 1) {
+            file_space.selectHyperslab(H5S_SELECT_SET, count + 1, file_offset + 1, unit_step, unit_step);
+        }
+        else {
+            file_space.selectHyperslab(H5S_SELECT_SET, count, file_offset, unit_step, unit_step);
+        }
+        write_values((*itd).get(), *itv, block->m_columns[col].get(), mem_space, file_space);
+    }
+    if (m_stats != nullptr) {
+        m_stats->m_num_write_calls += m_dsets->size();
+    }
+}
+
+namespace {
+
+    // returns the value of a numeric sweep variable as a double.
+    double get_sweep_double(const TypeDef & type, const char * val) {
+        switch (type.m_data_type) {
+        case TypeDef::TYPEID_INT8:
+            return static_cast<double>(static_cast<int8_t>(*val));
+        case TypeDef::TYPEID_INT32: {
+            int32_t ans;
+            memcpy(&ans, val, sizeof(ans));
+            return static_cast<double>(ans);
+        }
+        default: {
+            double ans;
+            memcpy(&ans, val, sizeof(ans));
+            return ans;
+        }
+        }
+    }
+
+}
+
+/**
+ * Split a block of a nested sweep into rows.  A new row starts whenever an
+ * outer sweep value changes, or the inner sweep restarts: its value repeats,
+ * or moves against the direction of the first two points of the row.  Outer
+ * sweep values alone cannot tell rows apart, since they may repeat.  Only the
+ * current row is kept in memory.
+ */
+void BlockWriter::write_nested_block(ValueBlock * block) {
+    H5Lock h5_lock;
+    StageTimer timer(m_stats, ConvertStats::stage::HDF5_WRITE);
+    std::vector<hsize_t> & row_points = m_target->m_row_points;
+    auto inner_type = std::next(m_type_list->begin(), m_target->m_num_outer);
+    bool inner_numeric = ((*inner_type).m_data_type == TypeDef::TYPEID_DOUBLE ||
+        (*inner_type).m_data_type == TypeDef::TYPEID_INT32 || (*inner_type).m_data_type == TypeDef::TYPEID_INT8);
+    hsize_t start = 0;
+    for (hsize_t idx = 0; idx < block->m_count; ++idx) {
+        // compare outer sweep values of this point with those of the current row.
+        bool new_row = row_points.empty();
+        size_t pos = 0;
+        auto itv = m_type_list->begin();
+        for (uint32_t col = 0; col < m_target->m_num_outer; ++itv, ++col) {
+            size_t size = (*itv).m_value_size;
+            const char * val = block->m_columns[col].get() + idx * size;
+            if (new_row || memcmp(m_outer_values.data() + pos, val, size) != 0) {
+                new_row = true;
+            }
+            pos += size;
+        }
+
+        // check whether the inner sweep continues in the direction of the row.
+        if (inner_numeric) {
+            double inner = get_sweep_double(*inner_type, block->m_columns[m_target->m_num_outer].get() +
+                idx * (*inner_type).m_value_size);
+            if (!new_row) {
+                hsize_t num_row = row_points.back() + (idx - start);
+                if (num_row == 1) {
+                    m_inner_dir = (inner > m_last_inner) ? 1 : -1;
+                    new_row = (inner == m_last_inner);
+                }
+                else {
+                    new_row = (m_inner_dir > 0) ? (inner <= m_last_inner) : (inner >= m_last_inner);
+                }
+            }
+            m_last_inner = inner;
+        }
+        if (!new_row) {
+            continue;
+        }
+
+        // finish current row, then record outer values of the new row.
+        if (idx > start) {
+            write_row_values(block, start, idx - start);
+        }
+        start = idx;
+        row_points.push_back(0);
+        hsize_t row_dim[1] = { row_points.size() };
+        hsize_t row_offset[1] = { row_points.size() - 1 };
+        hsize_t one[1] = { 1 };
+        H5::DataSpace mem_space(1, one, one);
+        m_outer_values.clear();
+        itv = m_type_list->begin();
+        auto itd = m_dsets->begin();
+        for (uint32_t col = 0; col < m_target->m_num_outer; ++itv, ++itd, ++col) {
+            size_t size = (*itv).m_value_size;
+            const char * val = block->m_columns[col].get() + idx * size;
+            m_outer_values.insert(m_outer_values.end(), val, val + size);
+            (*itd)->extend(row_dim);
+            H5::DataSpace file_space = (*itd)->getSpace();
+            file_space.selectHyperslab(H5S_SELECT_SET, one, row_offset);
+            write_values((*itd).get(), *itv, val, mem_space, file_space);
+        }
+        if (m_stats != nullptr) {
+            m_stats->m_num_write_calls += m_target->m_num_outer;
+        }
+    }
+    if (block->m_count > start) {
+        write_row_values(block, start, block->m_count - start);
+    }
+}
+
+/**
+ * Append count points of the block, starting at start, to the current row of
+ * the 2-D datasets of a nested sweep.  Called with the HDF5 mutex held.
+ */
+void BlockWriter::write_row_values(ValueBlock * block, hsize_t start, hsize_t count) {
+    std::vector<hsize_t> & row_points = m_target->m_row_points;
+    hsize_t row = row_points.size() - 1;
+    hsize_t file_dim[2] = { row_points.size(), std::max(m_num_cols, row_points.back() + count) };
+    hsize_t file_offset[2] = { row, row_points.back() };
+    hsize_t file_count[2] = { 1, count };
+    hsize_t mem_dim[1] = { count };
+    H5::DataSpace mem_space(1, mem_dim, mem_dim);
+    m_num_cols = file_dim[1];
+
+    auto itv = m_type_list->begin();
+    auto itd = m_dsets->begin();
+    for (size_t col = 0; itv != m_type_list->end(); ++itv, ++itd, ++col) {
+        if (col < m_target->m_num_outer) {
+            continue;
+        }
+        (*itd)->extend(file_dim);
+        H5::DataSpace file_space = (*itd)->getSpace();
+        file_space.selectHyperslab(H5S_SELECT_SET, file_count, file_offset);
+        write_values((*itd).get(), *itv, block->m_columns[col].get() + start * (*itv).m_value_size,
+            mem_space, file_space);
+    }
+    if (m_stats != nullptr) {
+        m_stats->m_num_write_calls += m_dsets->size() - m_target->m_num_outer;
+    }
+    row_points.back() += count;
+}
+
+void BlockWriter::stop() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        m_thread.join();
+    }
+}
+
+void BlockWriter::check_error() {
+    // only called after the writer thread is joined.
+    if (m_error) {
+        std::exception_ptr err = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(err);
+    }
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+
+#include "psf.hpp"
+#include "psffile.hpp"
+#include "psfgen.hpp"
+
+/**
+ * Checks that binary PSF files larger than 4 GB, whose 32-bit offsets wrap
+ * around, are read and converted.  A synthetic windowed file just past 4 GB
+ * is written to the given directory (default: current directory), read with
+ * PsfFile, and converted for one trace, whose values lie past 4 GB in the
+ * file.  Both files are removed afterwards.
+ */
+
+namespace {
+
+    // number of double traces, and of sweep points: 20 variables of 8 bytes
+    // per point make the file about 4.5 GB.
+    static constexpr uint32_t NUM_TRACES = 19;
+    static constexpr uint32_t NUM_POINTS = 28000000;
+
+    // returns the number of values of signal that differ from the synthetic ones.
+    uint64_t count_errors(const double * values, uint64_t num_values, int64_t signal) {
+        uint64_t ans = 0;
+        for (uint64_t point = 0; point < num_values; ++point) {
+            double expected = (signal < 0) ? psf::get_synthetic_sweep(static_cast<uint32_t>(point)) :
+                psf::get_synthetic_value(static_cast<uint32_t>(signal), static_cast<uint32_t>(point));
+            if (values[point] != expected) {
+                ++ans;
+            }
+        }
+        return ans;
+    }
+
+    bool check(bool cond, const std::string & msg) {
+        std::cout << (cond ? "ok    " : "FAIL  ") << msg << std::endl;
+        return cond;
+    }
+
+    bool check_psf_file(const std::string & psf_filename) {
+        psf::PsfFile file(psf_filename);
+        bool ans = check(file.get_num_points() == NUM_POINTS, "number of sweep points");
+        ans = check(count_errors(file.get_double("time").data(), file.get_num_points(), -1) == 0,
+            "sweep values") && ans;
+        file.release_all();
+        std::string last_name = "d" + std::to_string(NUM_TRACES - 1);
+        ans = check(count_errors(file.get_double(last_name).data(), file.get_num_points(), NUM_TRACES - 1) == 0,
+            "values of " + last_name) && ans;
+        return ans;
+    }
+
+    bool check_hdf5_file(const std::string & hdf5_filename, const std::string & trace_name) {
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        H5::DataSet dset = file.openDataSet(trace_name);
+        hsize_t dim[1] = { 0 };
+        dset.getSpace().getSimpleExtentDims(dim);
+        bool ans = check(dim[0] == NUM_POINTS, "number of converted points");
+        if (ans) {
+            std::vector<double> values(dim[0]);
+            dset.read(values.data(), H5::PredType::NATIVE_DOUBLE);
+            ans = check(count_errors(values.data(), dim[0], NUM_TRACES - 1) == 0, "converted values");
+        }
+        return ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    std::string psf_filename = dir_name + "/large.psf";
+    std::string hdf5_filename = dir_name + "/large.hdf5";
+    bool ok = false;
+    try {
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::WINDOWED;
+        gen_opts.m_num_points = NUM_POINTS;
+        gen_opts.m_num_double = NUM_TRACES;
+        gen_opts.m_use_group = true;
+        uint64_t size = psf::write_synthetic_psf(psf_filename, gen_opts);
+        std::cout << psf_filename << ": " << size << " bytes." << std::endl;
+        ok = check(size > UINT32_MAX, "file is larger than 4 GB");
+
+        ok = check_psf_file(psf_filename) && ok;
+
+        // convert the last trace only, so the HDF5 file stays small.
+        std::string last_name = "d" + std::to_string(NUM_TRACES - 1);
+        psf::ConvertOptions opts;
+        opts.m_include.push_back(last_name);
+        psf::read_psf(psf_filename, hdf5_filename, false, opts);
+        ok = check_hdf5_file(hdf5_filename, last_name) && ok;
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    std::remove(psf_filename.c_str());
+    std::remove(hdf5_filename.c_str());
+    std::cout << (ok ? "Large file test passed." : "Large file test failed.") << std::endl;
+    return ok ? 0 : 1;
+}
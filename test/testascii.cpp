@@ -0,0 +1,268 @@
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+
+#include "psf.hpp"
+#include "psfascii.hpp"
+#include "psffile.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks the ASCII PSF reader: numbers are parsed exactly as strtod() does,
+ * small hand-written sweep files are parsed and converted with the expected
+ * values whatever their layout, and if a psf_samples directory is given,
+ * ASCII results of Spectre agree with the binary results of the same
+ * analyses.  Files are written to the given directory (default: current
+ * directory) and removed afterwards.
+ */
+
+namespace {
+
+    // a sweep with a group of double, integer and complex traces.
+    const char * SWEEP_FILE =
+        "HEADER\n"
+        "\"PSFversion\" \"1.00\"\n"
+        "\"analysis type\" \"tran\"\n"
+        "TYPE\n"
+        "\"sweep\" FLOAT DOUBLE PROP(\n\"key\" \"sweep\"\n)\n"
+        "\"V\" FLOAT DOUBLE PROP(\n\"units\" \"V\"\n\"tolerance\" 1.00000e-06\n)\n"
+        "\"N\" INT LONG\n"
+        "\"Z\" COMPLEX DOUBLE\n"
+        "SWEEP\n"
+        "\"time\" \"sweep\" PROP(\n\"units\" \"s\"\n)\n"
+        "TRACE\n"
+        "\"group\" GROUP 3\n"
+        "\"v1\" \"V\"\n"
+        "\"n1\" \"N\"\n"
+        "\"z1\" \"Z\"\n"
+        "VALUE\n"
+        "\"time\" 0.00000\n"
+        "\"group\" 0.100000\n-7\n(1.50000 -2.50000)\n"
+        "\"time\" 1.00000e-11\n"
+        "\"group\" -3.33333e+02\n12\n(0.00000 1.00000e-300)\n"
+        "\"time\" 2.5e-11\n"
+        "\"group\" 123456789012345678901234\n0\n(-0.000666667 3.49066e-08)\n"
+        "END\n";
+
+    /**
+     * A sweep whose records are indented or share lines, and whose trace is
+     * named like the sweep variable, so points can only be counted by
+     * tokenizing the values.
+     */
+    const char * COMPACT_FILE =
+        "HEADER\n"
+        "\"PSFversion\" \"1.00\"\n"
+        "TYPE\n"
+        "\"sweep\" FLOAT DOUBLE\n"
+        "\"V\" FLOAT DOUBLE\n"
+        "SWEEP\n"
+        "\"time\" \"sweep\"\n"
+        "TRACE\n"
+        "\"time\" \"V\"\n"
+        "VALUE\n"
+        "\"time\" 0 \"time\" 1\n"
+        "  \"time\" 1e-11\n"
+        "\"time\" 2 \"time\" 2e-11 \"time\" 3\n"
+        "\t\"time\" 3e-11\t\"time\" 4 END\n";
+
+    const std::vector<double> SWEEP = { 0.0, 1.0e-11, 2.5e-11 };
+    const std::vector<double> V1 = { 0.1, -3.33333e+02, 123456789012345678901234.0 };
+    const std::vector<int32_t> N1 = { -7, 12, 0 };
+    const std::vector<std::complex<double>> Z1 = { { 1.5, -2.5 }, { 0.0, 1.0e-300 }, { -0.000666667, 3.49066e-08 } };
+
+    // the layout of complex values in HDF5 files.
+    struct Complex {
+        double m_real;
+        double m_imag;
+    };
+
+    bool parses_as_strtod(const std::string & text) {
+        double val = 0.0;
+        bool ok = psf::parse_double(text.data(), text.data() + text.size(), val);
+        double expected = std::strtod(text.c_str(), nullptr);
+        return ok && std::memcmp(&val, &expected, sizeof(double)) == 0;
+    }
+
+    bool check_parse_double() {
+        const std::vector<std::string> numbers = { "0", "0.00000", "-0.0", "1", "+2.5", "0.1", "0.100000",
+            "1.00000e-11", "-3.33333e+02", "1.07000e-07", "4.5E6", "123456789012345678",
+            "123456789012345678901234", "0.000000000000000000000000001", "1e-300", "2.2250738585072014e-308",
+            "4.9e-324", "1.7976931348623157e308", "9007199254740993", "1e22", "1e23", "3.14159265358979323846" };
+        bool all_ok = true;
+        for (auto itn = numbers.begin(); itn != numbers.end(); ++itn) {
+            if (!parses_as_strtod(*itn)) {
+                std::cout << "  parse_double(\"" << *itn << "\") differs from strtod()" << std::endl;
+                all_ok = false;
+            }
+        }
+        bool ans = psftest::check(all_ok, "numbers parsed as strtod()");
+
+        const std::vector<std::string> words = { "", "-", ".", "e5", "abc", "1.5x", "1e", "--1" };
+        bool rejected = true;
+        for (auto itw = words.begin(); itw != words.end(); ++itw) {
+            double val = 0.0;
+            rejected = rejected && !psf::parse_double(itw->data(), itw->data() + itw->size(), val);
+        }
+        return psftest::check(rejected, "non-numbers rejected") && ans;
+    }
+
+    template <typename T>
+    std::vector<T> get_column(const psf::AsciiPsf & psf, size_t idx) {
+        const std::vector<char> & col = psf.m_columns[idx];
+        const T * data = reinterpret_cast<const T *>(col.data());
+        return std::vector<T>(data, data + col.size() / sizeof(T));
+    }
+
+    bool check_read(const std::string & psf_filename) {
+        using psftest::check;
+        auto psf = psf::read_psf_ascii(psf_filename);
+        bool ans = check(psf->m_prop_dict.at("analysis type").m_sval == "tran", "header properties");
+        ans = check(psf->m_types.size() == 4 && psf->get_type("N").m_kind == psf::AsciiType::kind::INT &&
+            psf->get_type("V").m_prop_dict.at("tolerance").m_dval == 1.0e-6, "types") && ans;
+        ans = check(psf->m_sweeps.size() == 1 && psf->m_sweeps[0].m_name == "time" &&
+            psf->m_sweeps[0].m_prop_dict.at("units").m_sval == "s", "sweep variable") && ans;
+        ans = check(psf->m_traces.size() == 3 && psf->m_traces[0].m_name == "v1" && psf->m_traces[2].m_name == "z1",
+            "group traces expanded") && ans;
+        ans = check(psf->m_num_points == SWEEP.size() && psf->m_columns.size() == 4, "number of points") && ans;
+        if (psf->m_columns.size() == 4) {
+            ans = check(get_column<double>(*psf, 0) == SWEEP, "sweep values") && ans;
+            ans = check(get_column<double>(*psf, 1) == V1, "double values") && ans;
+            ans = check(get_column<int32_t>(*psf, 2) == N1, "integer values") && ans;
+            ans = check(get_column<std::complex<double>>(*psf, 3) == Z1, "complex values") && ans;
+        }
+        return ans;
+    }
+
+    bool check_compact(const std::string & psf_filename) {
+        using psftest::check;
+        {
+            std::ofstream out(psf_filename, std::ios::binary | std::ios::trunc);
+            out << COMPACT_FILE;
+        }
+        auto psf = psf::read_psf_ascii(psf_filename);
+        bool ans = check(psf->m_num_points == 4 && psf->m_columns.size() == 2, "compact records counted");
+        if (psf->m_columns.size() == 2) {
+            ans = check(get_column<double>(*psf, 0) == std::vector<double>({ 0.0, 1e-11, 2e-11, 3e-11 }) &&
+                get_column<double>(*psf, 1) == std::vector<double>({ 1.0, 2.0, 3.0, 4.0 }),
+                "compact record values") && ans;
+        }
+        return check(psf::scan_psf_ascii(psf_filename)->m_num_points == 4, "compact records scanned") && ans;
+    }
+
+    bool check_convert(const std::string & psf_filename, const std::string & hdf5_filename) {
+        using psftest::check;
+        psf::read_psf(psf_filename, hdf5_filename, false);
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        bool ans = check(psftest::read_dataset<double>(file, "time", H5::PredType::NATIVE_DOUBLE) == SWEEP,
+            "converted sweep");
+        ans = check(psftest::read_dataset<double>(file, "v1", H5::PredType::NATIVE_DOUBLE) == V1,
+            "converted double trace") && ans;
+        ans = check(psftest::read_dataset<int32_t>(file, "n1", H5::PredType::NATIVE_INT32) == N1,
+            "converted integer trace") && ans;
+        H5::CompType complex_type(sizeof(Complex));
+        complex_type.insertMember("r", HOFFSET(Complex, m_real), H5::PredType::NATIVE_DOUBLE);
+        complex_type.insertMember("i", HOFFSET(Complex, m_imag), H5::PredType::NATIVE_DOUBLE);
+        std::vector<Complex> z1 = psftest::read_dataset<Complex>(file, "z1", complex_type);
+        bool values_ok = (z1.size() == Z1.size());
+        for (size_t idx = 0; values_ok && idx < z1.size(); ++idx) {
+            values_ok = (z1[idx].m_real == Z1[idx].real() && z1[idx].m_imag == Z1[idx].imag());
+        }
+        ans = check(values_ok, "converted complex trace") && ans;
+        file.close();
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+    // ASCII files print 6 significant digits.
+    bool close_to(double ascii, double binary) {
+        return std::fabs(ascii - binary) <= 1.0e-5 * std::fabs(binary) + 1.0e-30;
+    }
+
+    // compares the ASCII and binary results of the same sweep, trace by trace.
+    bool check_sample_sweep(const std::string & ascii_filename, const std::string & binary_filename,
+        const std::string & msg) {
+        auto ascii = psf::read_psf_ascii(ascii_filename);
+        psf::PsfFile binary(binary_filename);
+        std::vector<std::string> names = binary.get_names();
+        bool ans = (ascii->m_num_points == binary.get_num_points() &&
+            names.size() == ascii->m_sweeps.size() + ascii->m_traces.size() &&
+            ascii->m_columns.size() == names.size());
+        for (size_t idx = 0; ans && idx < names.size(); ++idx) {
+            if (binary.get_type(names[idx]).m_data_type == psf::TypeDef::TYPEID_DOUBLE) {
+                std::vector<double> lhs = get_column<double>(*ascii, idx);
+                psf::Span<double> rhs = binary.get_double(names[idx]);
+                ans = (lhs.size() == rhs.size());
+                for (size_t point = 0; ans && point < lhs.size(); ++point) {
+                    ans = close_to(lhs[point], rhs[point]);
+                }
+            }
+            else {
+                std::vector<std::complex<double>> lhs = get_column<std::complex<double>>(*ascii, idx);
+                psf::Span<std::complex<double>> rhs = binary.get_complex(names[idx]);
+                ans = (lhs.size() == rhs.size());
+                for (size_t point = 0; ans && point < lhs.size(); ++point) {
+                    ans = close_to(lhs[point].real(), rhs[point].real()) &&
+                        close_to(lhs[point].imag(), rhs[point].imag());
+                }
+            }
+        }
+        return psftest::check(ans, msg);
+    }
+
+    bool check_samples(const std::string & samples_dir) {
+        std::string dir_name = samples_dir + "/tran_dc_ac_long/1/test/psf";
+        bool ans = check_sample_sweep(dir_name + "/tran.ascii", dir_name + "/tran.tran.tran",
+            "ASCII transient analysis matches binary");
+        ans = check_sample_sweep(dir_name + "/ac.ascii", dir_name + "/ac.ac", "ASCII AC analysis matches binary") &&
+            ans;
+
+        auto dc_op = psf::read_psf_ascii(samples_dir + "/dcOp.ascii");
+        bool values_ok = dc_op->m_sweeps.empty() && dc_op->m_values.size() == 4 &&
+            dc_op->m_values[0].m_name == "vo1" && dc_op->m_values[0].m_value.m_dval == 0.333333 &&
+            dc_op->m_values[3].m_type_name == "I" && dc_op->m_values[3].m_value.m_dval == -0.000333333;
+        return psftest::check(values_ok, "ASCII DC operating point values") && ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    std::string psf_filename = dir_name + "/sweep.ascii";
+    std::string hdf5_filename = dir_name + "/sweep.hdf5";
+    bool ok = true;
+    try {
+        ok = check_parse_double() && ok;
+        {
+            std::ofstream out(psf_filename, std::ios::binary | std::ios::trunc);
+            out << SWEEP_FILE;
+        }
+        ok = psftest::check(psf::is_ascii_psf(psf_filename), "ASCII file detected") && ok;
+        ok = check_read(psf_filename) && ok;
+        ok = check_convert(psf_filename, hdf5_filename) && ok;
+        ok = check_compact(psf_filename) && ok;
+        if (argc >= 3) {
+            ok = check_samples(argv[2]) && ok;
+        }
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    catch (H5::Exception & e) {
+        std::cout << "HDF5 exception caught: " << std::endl;
+        std::cout << e.getDetailMsg() << std::endl;
+        ok = false;
+    }
+    std::remove(psf_filename.c_str());
+    std::remove(hdf5_filename.c_str());
+    return psftest::report(ok, "ASCII reader");
+}
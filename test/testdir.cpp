@@ -0,0 +1,150 @@
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "psfdir.hpp"
+#include "psfgen.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks the conversion of result directories: PSF files are found in
+ * nested directories and other files are skipped, results come back sorted
+ * with mirrored HDF5 names, parametric runs are listed in numeric order, and
+ * the job memory cap limits the value buffers of each conversion.  A tree is
+ * written to the given directory (default: current directory) and removed
+ * afterwards.
+ */
+
+namespace {
+
+    static constexpr uint32_t NUM_POINTS = 10000;
+    static constexpr uint32_t NUM_DOUBLE = 10;
+    static constexpr size_t JOB_MEMORY_BYTES = 64 * 1024;
+
+    // PSF files of the tree, relative to its root, in sorted order.
+    const std::vector<std::string> PSF_NAMES = { "a.tran", "sub/b.psf", "sub/deeper/c.dc" };
+
+    bool file_exists(const std::string & filename) {
+        return std::ifstream(filename).good();
+    }
+
+    void write_tree(const std::string & in_dir) {
+        psf::make_dirs(in_dir + "/sub/deeper");
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::SIMPLE;
+        gen_opts.m_num_points = NUM_POINTS;
+        gen_opts.m_num_double = NUM_DOUBLE;
+        psf::write_synthetic_psf(in_dir + "/" + PSF_NAMES[0], gen_opts);
+        gen_opts.m_layout = psf::GenOptions::layout::WINDOWED;
+        gen_opts.m_num_points = 1000;
+        psf::write_synthetic_psf(in_dir + "/" + PSF_NAMES[1], gen_opts);
+        gen_opts.m_layout = psf::GenOptions::layout::NO_SWEEP;
+        psf::write_synthetic_psf(in_dir + "/" + PSF_NAMES[2], gen_opts);
+        std::ofstream(in_dir + "/sub/notes.txt") << "not a PSF file" << std::endl;
+    }
+
+    void remove_tree(const std::string & in_dir, const std::string & out_dir) {
+        for (auto itn = PSF_NAMES.begin(); itn != PSF_NAMES.end(); ++itn) {
+            std::remove((in_dir + "/" + *itn).c_str());
+            std::remove(psf::get_hdf5_filename(*itn, out_dir).c_str());
+        }
+        std::remove((in_dir + "/sub/notes.txt").c_str());
+        const char * sub_dirs[3] = { "/sub/deeper", "/sub", "" };
+        for (uint32_t idx = 0; idx < 3; ++idx) {
+            std::remove((in_dir + sub_dirs[idx]).c_str());
+            std::remove((out_dir + sub_dirs[idx]).c_str());
+        }
+    }
+
+    bool check_job_options() {
+        using psftest::check;
+        psf::DirOptions opts;
+        bool ans = check(opts.get_job_options().m_buffer_bytes == psf::DEFAULT_BUFFER_BYTES, "no memory cap");
+        opts.m_job_memory_bytes = JOB_MEMORY_BYTES;
+        opts.m_convert.m_pipeline_depth = 4;
+        ans = check(opts.get_job_options().m_buffer_bytes == JOB_MEMORY_BYTES,
+            "memory cap is the buffer budget of a job") && ans;
+        opts.m_job_memory_bytes = 2 * psf::DEFAULT_BUFFER_BYTES;
+        return check(opts.get_job_options().m_buffer_bytes == psf::DEFAULT_BUFFER_BYTES,
+            "memory cap above the budget") && ans;
+    }
+
+    bool check_convert_dir(const std::string & in_dir, const std::string & out_dir) {
+        using psftest::check;
+        write_tree(in_dir);
+        bool ans = check(psf::find_psf_files(in_dir) == PSF_NAMES, "PSF files found, sorted");
+
+        psf::DirOptions opts;
+        opts.m_num_threads = 2;
+        opts.m_job_memory_bytes = JOB_MEMORY_BYTES;
+        opts.m_convert.m_pipeline_depth = 4;
+        std::vector<psf::DirResult> results = psf::convert_psf_dir(in_dir, out_dir, opts);
+        bool names_ok = (results.size() == PSF_NAMES.size());
+        bool all_ok = names_ok;
+        for (size_t idx = 0; names_ok && idx < results.size(); ++idx) {
+            const psf::DirResult & result = results[idx];
+            names_ok = (result.m_psf_filename == in_dir + "/" + PSF_NAMES[idx] &&
+                result.m_hdf5_filename == out_dir + "/" + PSF_NAMES[idx] + ".hdf5");
+            if (!result.m_ok || !file_exists(result.m_hdf5_filename)) {
+                std::cout << "  " << result.m_psf_filename << ": " << result.m_error << std::endl;
+                all_ok = false;
+            }
+        }
+        ans = check(names_ok, "results sorted, with mirrored HDF5 names") && ans;
+        ans = check(all_ok, "all files converted") && ans;
+
+        // the blocks in flight share the cap, and together use most of it.
+        if (!results.empty()) {
+            size_t peak = results[0].m_stats.m_peak_buffer_bytes;
+            ans = check(peak <= JOB_MEMORY_BYTES && peak > JOB_MEMORY_BYTES / 2,
+                "value buffers fill the memory cap") && ans;
+        }
+        remove_tree(in_dir, out_dir);
+        return ans;
+    }
+
+    bool check_param_runs(const std::string & run_dir) {
+        const char * runs[3] = { "10", "2", "1" };
+        psf::GenOptions gen_opts;
+        gen_opts.m_num_points = 10;
+        for (uint32_t idx = 0; idx < 3; ++idx) {
+            psf::make_dirs(run_dir + "/" + runs[idx]);
+            psf::write_synthetic_psf(run_dir + "/" + runs[idx] + "/tran.tran", gen_opts);
+        }
+        // a run directory without the file is skipped.
+        psf::make_dirs(run_dir + "/logs");
+
+        std::vector<std::string> expected = { run_dir + "/1/tran.tran", run_dir + "/2/tran.tran",
+            run_dir + "/10/tran.tran" };
+        bool ans = psftest::check(psf::find_param_runs(run_dir, "tran.tran") == expected,
+            "parametric runs in numeric order");
+        for (auto itf = expected.begin(); itf != expected.end(); ++itf) {
+            std::remove((*itf).c_str());
+        }
+        for (uint32_t idx = 0; idx < 3; ++idx) {
+            std::remove((run_dir + "/" + runs[idx]).c_str());
+        }
+        std::remove((run_dir + "/logs").c_str());
+        std::remove(run_dir.c_str());
+        return ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    bool ok = true;
+    try {
+        ok = check_job_options() && ok;
+        ok = check_convert_dir(dir_name + "/dir_in", dir_name + "/dir_out") && ok;
+        ok = check_param_runs(dir_name + "/dir_runs") && ok;
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    return psftest::report(ok, "Directory conversion");
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+
+#include "psf.hpp"
+#include "psfgen.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks that trace filters convert the selected traces only, with correct
+ * values whichever runs of records the skip plan jumps over, and that a value
+ * record of an unexpected variable is rejected.  Files are written to the
+ * given directory (default: current directory) and removed afterwards.
+ */
+
+namespace {
+
+    static constexpr uint32_t NUM_POINTS = 300;
+    static constexpr uint32_t NUM_DOUBLE = 4;
+
+    // the traces of the synthetic files, in file order.
+    const std::vector<std::string> TRACE_NAMES = { "d0", "d1", "d2", "d3", "i0" };
+
+    /**
+     * Checks that exactly the traces named in expected are converted, with
+     * the synthetic values.
+     */
+    bool check_traces(const std::string & hdf5_filename, const std::vector<std::string> & expected,
+        const std::string & msg) {
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        std::vector<std::string> found;
+        bool values_ok = true;
+        for (uint32_t signal = 0; signal < TRACE_NAMES.size(); ++signal) {
+            const std::string & name = TRACE_NAMES[signal];
+            if (H5Lexists(file.getId(), name.c_str(), H5P_DEFAULT) <= 0) {
+                continue;
+            }
+            found.push_back(name);
+            std::vector<double> values = psftest::read_dataset<double>(file, name, H5::PredType::NATIVE_DOUBLE);
+            values_ok = values_ok && values.size() == NUM_POINTS;
+            for (uint32_t point = 0; values_ok && point < NUM_POINTS; ++point) {
+                double val = psf::get_synthetic_value(signal, point);
+                values_ok = (values[point] == ((signal < NUM_DOUBLE) ? val : static_cast<int32_t>(val)));
+            }
+        }
+        std::vector<double> sweep = psftest::read_dataset<double>(file, "time", H5::PredType::NATIVE_DOUBLE);
+        bool sweep_ok = (sweep.size() == NUM_POINTS);
+        for (uint32_t point = 0; sweep_ok && point < NUM_POINTS; ++point) {
+            sweep_ok = (sweep[point] == psf::get_synthetic_sweep(point));
+        }
+        bool ans = psftest::check(found == expected, msg + ": selected traces");
+        ans = psftest::check(values_ok, msg + ": trace values") && ans;
+        return psftest::check(sweep_ok, msg + ": sweep values") && ans;
+    }
+
+    bool check_filter(const std::string & psf_filename, const std::string & hdf5_filename,
+        const std::vector<std::string> & include, const std::vector<std::string> & exclude, bool regex,
+        const std::vector<std::string> & expected, const std::string & msg) {
+        psf::ConvertOptions opts;
+        opts.m_include = include;
+        opts.m_exclude = exclude;
+        opts.m_regex = regex;
+        // small blocks, so the skip plan runs across blocks.
+        opts.m_block_points = 64;
+        psf::read_psf(psf_filename, hdf5_filename, false, opts);
+        bool ans = check_traces(hdf5_filename, expected, msg);
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+    /**
+     * Changes the variable id of the last value record of the variable var_id,
+     * and checks that the conversion fails.
+     */
+    bool check_bad_record(const std::string & psf_filename, const std::string & hdf5_filename, uint32_t var_id) {
+        std::vector<char> data;
+        {
+            std::ifstream in(psf_filename, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        // PSF words are big-endian.
+        const char record[8] = { 0, 0, 0, 16, 0, 0, 0, static_cast<char>(var_id) };
+        auto pos = std::find_end(data.begin(), data.end(), record, record + 8);
+        if (!psftest::check(pos != data.end(), "value record found")) {
+            return false;
+        }
+        *(pos + 7) = static_cast<char>(var_id + 50);
+        {
+            std::ofstream out(psf_filename, std::ios::binary | std::ios::trunc);
+            out.write(data.data(), data.size());
+        }
+
+        bool thrown = false;
+        try {
+            psf::read_psf(psf_filename, hdf5_filename, false);
+        }
+        catch (std::runtime_error & e) {
+            thrown = (std::string(e.what()).find("Invalid value record") != std::string::npos);
+        }
+        std::remove(hdf5_filename.c_str());
+        return psftest::check(thrown, "value record of another variable is rejected");
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    std::string psf_filename = dir_name + "/filter.psf";
+    std::string hdf5_filename = dir_name + "/filter.hdf5";
+    const std::vector<std::string> none;
+    bool ok = true;
+    try {
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::SIMPLE;
+        gen_opts.m_num_points = NUM_POINTS;
+        gen_opts.m_num_double = NUM_DOUBLE;
+        gen_opts.m_num_int32 = 1;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        ok = check_filter(psf_filename, hdf5_filename, none, none, false, TRACE_NAMES, "simple, all") && ok;
+        ok = check_filter(psf_filename, hdf5_filename, { "d1", "d3" }, none, false, { "d1", "d3" },
+            "simple, include d1 d3") && ok;
+        ok = check_filter(psf_filename, hdf5_filename, none, { "d*" }, false, { "i0" },
+            "simple, exclude d*") && ok;
+        ok = check_filter(psf_filename, hdf5_filename, { "d[02]|i.*" }, { "i0" }, true, { "d0", "d2" },
+            "simple, regex") && ok;
+        ok = check_filter(psf_filename, hdf5_filename, { "x*" }, none, false, none, "simple, none") && ok;
+        // d0 gets the id after the sweep, group and outer sweep ids.
+        ok = check_bad_record(psf_filename, hdf5_filename, 103) && ok;
+
+        gen_opts.m_layout = psf::GenOptions::layout::WINDOWED;
+        gen_opts.m_num_int32 = 0;
+        gen_opts.m_window_size = 512;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        ok = check_filter(psf_filename, hdf5_filename, { "d0", "d2" }, none, false, { "d0", "d2" },
+            "windowed, include d0 d2") && ok;
+        ok = check_filter(psf_filename, hdf5_filename, none, { "d0" }, false, { "d1", "d2", "d3" },
+            "windowed, exclude d0") && ok;
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    std::remove(psf_filename.c_str());
+    std::remove(hdf5_filename.c_str());
+    return psftest::report(ok, "Trace filter");
+}
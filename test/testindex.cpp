@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "psffile.hpp"
+#include "psfgen.hpp"
+#include "psfindex.hpp"
+#include "psfreader.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks the .psfidx sidecar index: it is built and saved when missing,
+ * loaded with the same contents as a fresh build, rebuilt when its PSF file
+ * changes, rejected when truncated, and written safely by concurrent
+ * writers.  Files are written to the given directory (default: current
+ * directory) and removed afterwards.
+ */
+
+namespace {
+
+    bool file_exists(const std::string & filename) {
+        return std::ifstream(filename).good();
+    }
+
+    // returns true if the index has the same contents as a fresh build.
+    bool same_index(const psf::PsfIndex & lhs, const psf::PsfIndex & rhs) {
+        return lhs.m_stamp == rhs.m_stamp && lhs.m_value_pos == rhs.m_value_pos &&
+            lhs.m_np_window == rhs.m_np_window &&
+            lhs.m_value_pos_list == rhs.m_value_pos_list &&
+            lhs.m_sections->m_num_points == rhs.m_sections->m_num_points &&
+            lhs.m_sections->m_trace_list->size() == rhs.m_sections->m_trace_list->size() &&
+            lhs.m_sections->m_type_map->size() == rhs.m_sections->m_type_map->size();
+    }
+
+    // returns true if opening with and without the index gives the same double values.
+    bool same_values(const std::string & psf_filename) {
+        psf::PsfFile plain(psf_filename, false);
+        psf::PsfFile indexed(psf_filename, true);
+        std::vector<std::string> names = plain.get_names();
+        bool ans = (names == indexed.get_names() && plain.get_num_points() == indexed.get_num_points());
+        for (auto itn = names.begin(); ans && itn != names.end(); ++itn) {
+            if (plain.get_type(*itn).m_data_type == psf::TypeDef::TYPEID_DOUBLE) {
+                psf::Span<double> lhs = plain.get_double(*itn);
+                psf::Span<double> rhs = indexed.get_double(*itn);
+                ans = std::equal(lhs.begin(), lhs.end(), rhs.begin());
+            }
+        }
+        return ans;
+    }
+
+    bool check_layout(const std::string & psf_filename, psf::GenOptions gen_opts, const std::string & msg) {
+        using psftest::check;
+        std::string index_filename = psf::PsfIndex::get_index_filename(psf_filename);
+        std::remove(index_filename.c_str());
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+
+        bool ans = check(psf::PsfIndex::load(psf_filename) == nullptr, msg + ": no index to load");
+        psf::PsfIndex::open(psf_filename);
+        ans = check(file_exists(index_filename), msg + ": index saved") && ans;
+        auto loaded = psf::PsfIndex::load(psf_filename);
+        auto built = psf::PsfIndex::build(psf_filename);
+        ans = check(loaded != nullptr && same_index(*loaded, *built), msg + ": loaded index matches build") && ans;
+        ans = check(same_values(psf_filename), msg + ": values read through the index") && ans;
+
+        // a different file of the same name makes the index stale.
+        gen_opts.m_num_double += 1;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        ans = check(psf::PsfIndex::load(psf_filename) == nullptr, msg + ": stale index is not loaded") && ans;
+        {
+            psf::PsfFile file(psf_filename, true);
+            std::string last_name = "d" + std::to_string(gen_opts.m_num_double - 1);
+            ans = check(file.has_signal(last_name), msg + ": stale index is rebuilt") && ans;
+        }
+        ans = check(psf::PsfIndex::load(psf_filename) != nullptr, msg + ": rebuilt index is saved") && ans;
+
+        // a truncated index is rejected, and rebuilt on open.
+        std::vector<char> data;
+        {
+            std::ifstream in(index_filename, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream out(index_filename, std::ios::binary | std::ios::trunc);
+            out.write(data.data(), data.size() / 2);
+        }
+        ans = check(psf::PsfIndex::load(psf_filename) == nullptr, msg + ": truncated index is rejected") && ans;
+        ans = check(same_values(psf_filename), msg + ": values after truncated index") && ans;
+
+        std::remove(index_filename.c_str());
+        std::remove(psf_filename.c_str());
+        return ans;
+    }
+
+    // several threads write the same index at once; the result must be whole.
+    bool check_concurrent_writes(const std::string & psf_filename) {
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::WINDOWED;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        std::string index_filename = psf::PsfIndex::get_index_filename(psf_filename);
+        auto index = psf::PsfIndex::build(psf_filename);
+
+        std::vector<std::thread> threads;
+        std::vector<int> errors(4, 0);
+        for (size_t idx = 0; idx < errors.size(); ++idx) {
+            threads.push_back(std::thread([&, idx]() {
+                try {
+                    for (int rep = 0; rep < 20; ++rep) {
+                        index->write(index_filename);
+                    }
+                }
+                catch (std::exception &) {
+                    errors[idx] = 1;
+                }
+            }));
+        }
+        for (auto itt = threads.begin(); itt != threads.end(); ++itt) {
+            (*itt).join();
+        }
+        bool ans = psftest::check(errors == std::vector<int>(errors.size(), 0), "concurrent index writes succeed");
+        auto loaded = psf::PsfIndex::load(psf_filename);
+        ans = psftest::check(loaded != nullptr && same_index(*loaded, *index), "concurrently written index loads") &&
+            ans;
+        std::remove(index_filename.c_str());
+        std::remove(psf_filename.c_str());
+        return ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    std::string psf_filename = dir_name + "/index.psf";
+    bool ok = true;
+    try {
+        psf::GenOptions gen_opts;
+        gen_opts.m_num_points = 5000;
+        gen_opts.m_window_size = 1024;
+        ok = check_layout(psf_filename, gen_opts, "windowed") && ok;
+
+        gen_opts.m_layout = psf::GenOptions::layout::SIMPLE;
+        gen_opts.m_num_points = 9000;
+        gen_opts.m_num_complex = 1;
+        gen_opts.m_num_struct = 1;
+        ok = check_layout(psf_filename, gen_opts, "simple") && ok;
+
+        gen_opts.m_layout = psf::GenOptions::layout::NO_SWEEP;
+        gen_opts.m_num_points = 1;
+        ok = check_layout(psf_filename, gen_opts, "no sweep") && ok;
+
+        ok = check_concurrent_writes(psf_filename) && ok;
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    return psftest::report(ok, "Index");
+}
@@ -0,0 +1,293 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+
+#include "psf.hpp"
+#include "psfgen.hpp"
+#include "psftable.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks the optional layouts of converted files: the value tables of
+ * non-sweep files and the trace matrices of sweeps, including types whose
+ * name holds a '/', and interned dataset properties.  Files are written to
+ * the given directory (default: current directory) and removed afterwards.
+ * If a psf_samples directory is given, Spectre files are converted as well.
+ */
+
+namespace {
+
+    static constexpr uint32_t NUM_DOUBLE = 3;
+    static constexpr uint32_t NUM_POINTS = 50;
+
+    // the layout of complex values in HDF5 files.
+    struct Complex {
+        double m_real;
+        double m_imag;
+    };
+
+    H5::CompType make_complex_type() {
+        H5::CompType ans(sizeof(Complex));
+        ans.insertMember("r", HOFFSET(Complex, m_real), H5::PredType::NATIVE_DOUBLE);
+        ans.insertMember("i", HOFFSET(Complex, m_imag), H5::PredType::NATIVE_DOUBLE);
+        return ans;
+    }
+
+    // returns the strings of a names dataset, without their padding.
+    std::vector<std::string> read_names(H5::H5Location & loc, const std::string & name) {
+        H5::DataSet dset = loc.openDataSet(name);
+        size_t len = dset.getStrType().getSize();
+        std::vector<char> buffer(dset.getSpace().getSimpleExtentNpoints() * len);
+        dset.read(buffer.data(), dset.getStrType());
+        std::vector<std::string> ans;
+        for (size_t pos = 0; pos < buffer.size(); pos += len) {
+            std::string val(buffer.data() + pos, len);
+            ans.push_back(val.substr(0, val.find('\0')));
+        }
+        return ans;
+    }
+
+    bool check_escape() {
+        bool ans = psftest::check(psf::escape_link_name("V/Sec") == "V%2FSec", "escape '/'");
+        ans = psftest::check(psf::escape_link_name("a%2Fb") == "a%252Fb", "escape '%'") && ans;
+        return psftest::check(psf::escape_link_name(".") == "%2E", "escape \".\"") && ans;
+    }
+
+    bool check_value_tables(const std::string & dir_name) {
+        using psftest::check;
+        std::string psf_filename = dir_name + "/tables.psf";
+        std::string hdf5_filename = dir_name + "/tables.hdf5";
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::NO_SWEEP;
+        gen_opts.m_num_double = NUM_DOUBLE;
+        gen_opts.m_num_complex = 2;
+        gen_opts.m_num_int32 = 1;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        psf::ConvertOptions opts;
+        opts.m_value_tables = true;
+        psf::read_psf(psf_filename, hdf5_filename, false, opts);
+
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        H5::Group tables = file.openGroup(psf::TABLES_NAME);
+        bool ans = check(tables.getNumObjs() == 3, "one table per type");
+
+        H5::Group doubles = tables.openGroup("V");
+        ans = check(read_names(doubles, "names") == std::vector<std::string>({ "d0", "d1", "d2" }),
+            "double table names") && ans;
+        std::vector<double> dvals = psftest::read_dataset<double>(doubles, "values", H5::PredType::NATIVE_DOUBLE);
+        bool values_ok = (dvals.size() == NUM_DOUBLE);
+        for (uint32_t idx = 0; values_ok && idx < NUM_DOUBLE; ++idx) {
+            values_ok = (dvals[idx] == psf::get_synthetic_value(idx, 0));
+        }
+        ans = check(values_ok, "double table values") && ans;
+
+        // the complex type name holds a '/'.
+        H5::Group complexes = tables.openGroup(psf::escape_link_name("V/sqrt(Hz)"));
+        ans = check(read_names(complexes, "names") == std::vector<std::string>({ "c0", "c1" }),
+            "complex table names") && ans;
+        std::vector<Complex> cvals = psftest::read_dataset<Complex>(complexes, "values", make_complex_type());
+        values_ok = (cvals.size() == 2);
+        for (uint32_t idx = 0; values_ok && idx < 2; ++idx) {
+            double val = psf::get_synthetic_value(NUM_DOUBLE + idx, 0);
+            values_ok = (cvals[idx].m_real == val && cvals[idx].m_imag == -val);
+        }
+        ans = check(values_ok, "complex table values") && ans;
+
+        std::vector<int32_t> ivals = psftest::read_dataset<int32_t>(tables, "N/values", H5::PredType::NATIVE_INT32);
+        ans = check(ivals.size() == 1 && ivals[0] == static_cast<int32_t>(psf::get_synthetic_value(NUM_DOUBLE + 2, 0)),
+            "int32 table values") && ans;
+        file.close();
+        std::remove(psf_filename.c_str());
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+    bool check_trace_matrices(const std::string & dir_name) {
+        using psftest::check;
+        std::string psf_filename = dir_name + "/matrix.psf";
+        std::string hdf5_filename = dir_name + "/matrix.hdf5";
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::SIMPLE;
+        gen_opts.m_num_points = NUM_POINTS;
+        gen_opts.m_num_double = NUM_DOUBLE;
+        gen_opts.m_num_complex = 2;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        psf::ConvertOptions opts;
+        opts.m_trace_matrix = true;
+        psf::read_psf(psf_filename, hdf5_filename, false, opts);
+
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        std::vector<double> sweep = psftest::read_dataset<double>(file, "time", H5::PredType::NATIVE_DOUBLE);
+        bool ans = check(sweep.size() == NUM_POINTS && sweep.back() == psf::get_synthetic_sweep(NUM_POINTS - 1),
+            "sweep dataset");
+        H5::Group matrices = file.openGroup(psf::MATRICES_NAME);
+        ans = check(matrices.getNumObjs() == 2, "one matrix per type") && ans;
+
+        H5::Group doubles = matrices.openGroup("V");
+        ans = check(read_names(doubles, "names") == std::vector<std::string>({ "d0", "d1", "d2" }),
+            "double matrix names") && ans;
+        std::vector<hsize_t> dims = psftest::get_dims(doubles, "values");
+        ans = check(dims.size() == 2 && dims[0] == NUM_DOUBLE && dims[1] == NUM_POINTS, "double matrix shape") &&
+            ans;
+        std::vector<double> dvals = psftest::read_dataset<double>(doubles, "values", H5::PredType::NATIVE_DOUBLE);
+        bool values_ok = (dvals.size() == NUM_DOUBLE * NUM_POINTS);
+        for (uint32_t idx = 0; values_ok && idx < dvals.size(); ++idx) {
+            values_ok = (dvals[idx] == psf::get_synthetic_value(idx / NUM_POINTS, idx % NUM_POINTS));
+        }
+        ans = check(values_ok, "double matrix values") && ans;
+
+        // the complex type name holds a '/'.
+        H5::Group complexes = matrices.openGroup(psf::escape_link_name("V/sqrt(Hz)"));
+        ans = check(read_names(complexes, "names") == std::vector<std::string>({ "c0", "c1" }),
+            "complex matrix names") && ans;
+        std::vector<Complex> cvals = psftest::read_dataset<Complex>(complexes, "values", make_complex_type());
+        values_ok = (cvals.size() == 2 * NUM_POINTS);
+        for (uint32_t idx = 0; values_ok && idx < cvals.size(); ++idx) {
+            double val = psf::get_synthetic_value(NUM_DOUBLE + idx / NUM_POINTS, idx % NUM_POINTS);
+            values_ok = (cvals[idx].m_real == val && cvals[idx].m_imag == -val);
+        }
+        ans = check(values_ok, "complex matrix values") && ans;
+        file.close();
+        std::remove(psf_filename.c_str());
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+    // returns the string attribute name of loc, or "" if there is none.
+    std::string read_str_attr(H5::H5Object & loc, const std::string & name) {
+        if (!loc.attrExists(name)) {
+            return "";
+        }
+        H5::Attribute attr = loc.openAttribute(name);
+        std::string ans;
+        attr.read(attr.getStrType(), ans);
+        return ans.substr(0, ans.find('\0'));
+    }
+
+    // returns the path of the group the shared properties reference of a dataset points to.
+    std::string get_props_path(H5::H5File & file, const std::string & dset_name) {
+        H5::DataSet dset = file.openDataSet(dset_name);
+        if (!dset.attrExists(psf::SHARED_PROPS_NAME)) {
+            return "";
+        }
+        hobj_ref_t ref;
+        dset.openAttribute(psf::SHARED_PROPS_NAME).read(H5::PredType::STD_REF_OBJ, &ref);
+        char path[256];
+        ssize_t len = H5Rget_name(file.getId(), H5R_OBJECT, &ref, path, sizeof(path));
+        return (len > 0) ? std::string(path, len) : "";
+    }
+
+    /**
+     * Converts a sweep, whose traces share their properties and whose sweep
+     * variable has its own, with and without interning.
+     */
+    bool check_interned_props(const std::string & dir_name, bool intern) {
+        using psftest::check;
+        std::string psf_filename = dir_name + "/props.psf";
+        std::string hdf5_filename = dir_name + "/props.hdf5";
+        std::string msg = intern ? "interned properties" : "plain properties";
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::SIMPLE;
+        gen_opts.m_num_points = NUM_POINTS;
+        gen_opts.m_num_double = NUM_DOUBLE;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        psf::ConvertOptions opts;
+        opts.m_intern_properties = intern;
+        psf::read_psf(psf_filename, hdf5_filename, false, opts);
+
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        bool has_group = (H5Lexists(file.getId(), psf::SHARED_PROPS_NAME, H5P_DEFAULT) > 0);
+        // header properties stay attributes of the file.
+        bool ans = check(read_str_attr(file, "simulator") == "psfgen", msg + ": header attributes");
+        if (intern) {
+            ans = check(has_group && file.openGroup(psf::SHARED_PROPS_NAME).getNumObjs() == 2,
+                msg + ": one group per distinct dict") && ans;
+            std::string sweep_path = get_props_path(file, "time");
+            std::string trace_path = get_props_path(file, "d0");
+            bool shared = !trace_path.empty() && trace_path != sweep_path;
+            for (uint32_t idx = 1; idx < NUM_DOUBLE; ++idx) {
+                shared = shared && get_props_path(file, "d" + std::to_string(idx)) == trace_path;
+            }
+            ans = check(shared, msg + ": traces reference the same group") && ans;
+            if (!sweep_path.empty() && !trace_path.empty()) {
+                H5::Group sweep_props = file.openGroup(sweep_path);
+                H5::Group trace_props = file.openGroup(trace_path);
+                ans = check(read_str_attr(sweep_props, "units") == "s" && read_str_attr(trace_props, "units") == "V",
+                    msg + ": referenced properties") && ans;
+            }
+            H5::DataSet dset = file.openDataSet("d0");
+            ans = check(!dset.attrExists("units") && dset.getNumAttrs() == 1, msg + ": no plain attributes") && ans;
+        }
+        else {
+            ans = check(!has_group, msg + ": no shared group") && ans;
+            H5::DataSet dset = file.openDataSet("d0");
+            ans = check(read_str_attr(dset, "units") == "V" && !dset.attrExists(psf::SHARED_PROPS_NAME),
+                msg + ": dataset attributes") && ans;
+        }
+        file.close();
+        std::remove(psf_filename.c_str());
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+    // converts a DC operating point of psf_samples, which defines types such as "V/Sec".
+    bool check_sample_tables(const std::string & dir_name, const std::string & samples_dir) {
+        std::string psf_filename = samples_dir + "/tran_dc_ac_single/1/test/psf/dcOp.dc";
+        std::string hdf5_filename = dir_name + "/dcOp.hdf5";
+        psf::ConvertOptions opts;
+        opts.m_value_tables = true;
+        psf::read_psf(psf_filename, hdf5_filename, false, opts);
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        H5::Group tables = file.openGroup(psf::TABLES_NAME);
+        bool ans = psftest::check(!read_names(tables, "V/names").empty(), "DC operating point tables");
+        file.close();
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+    // converts an AC analysis of psf_samples as trace matrices.
+    bool check_sample_matrices(const std::string & dir_name, const std::string & samples_dir) {
+        std::string psf_filename = samples_dir + "/tran_dc_ac_single/1/test/psf/ac.ac";
+        std::string hdf5_filename = dir_name + "/ac.hdf5";
+        psf::ConvertOptions opts;
+        opts.m_trace_matrix = true;
+        psf::read_psf(psf_filename, hdf5_filename, false, opts);
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        H5::Group matrices = file.openGroup(psf::MATRICES_NAME);
+        bool ans = psftest::check(read_names(matrices, "V/names").size() == 3, "AC analysis matrices");
+        file.close();
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    bool ok = true;
+    try {
+        ok = check_escape() && ok;
+        ok = check_value_tables(dir_name) && ok;
+        ok = check_trace_matrices(dir_name) && ok;
+        ok = check_interned_props(dir_name, true) && ok;
+        ok = check_interned_props(dir_name, false) && ok;
+        if (argc >= 3) {
+            ok = check_sample_tables(dir_name, argv[2]) && ok;
+            ok = check_sample_matrices(dir_name, argv[2]) && ok;
+        }
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    catch (H5::Exception & e) {
+        std::cout << "HDF5 exception caught: " << std::endl;
+        std::cout << e.getDetailMsg() << std::endl;
+        ok = false;
+    }
+    return psftest::report(ok, "Layout");
+}
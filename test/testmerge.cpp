@@ -0,0 +1,202 @@
+#include <cmath>
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+
+#include "psfdir.hpp"
+#include "psfgen.hpp"
+#include "psfmerge.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks the merge of parametric runs: two sweeps with different numbers of
+ * points and design variables are merged into [param_index, sweep_point]
+ * datasets, padded with zeros, with the points of each row and the design
+ * variables of each run, and files with different variables are rejected.
+ * Files are written to the given directory (default: current directory) and
+ * removed afterwards.
+ */
+
+namespace {
+
+    static constexpr uint32_t NUM_DOUBLE = 3;
+    const std::vector<uint32_t> NUM_POINTS = { 300, 200 };
+
+    // the design variables of run 2 are named by its artistLogFile.
+    const char * ARTIST_LOG =
+        "HEADER\n"
+        "\"PSFversion\" \"1.00\"\n"
+        "TYPE\n"
+        "\"analysisInst\" STRUCT(\n"
+        "\"analysisType\" STRING *\n"
+        "\"dataFile\" STRING *\n"
+        "\"sweepVariable\" ARRAY ( * ) STRING *\n"
+        ")\n"
+        "VALUE\n"
+        "\"tran\" \"analysisInst\" (\n\"tran\"\n\"tran.tran\"\n()\n)\n"
+        "\"variables\" \"analysisInst\" (\n\"design_variables\"\n\"run_vars\"\n()\n)\n"
+        "END\n";
+
+    const char * RUN_VARS[2] = {
+        "HEADER\n"
+        "\"PSFversion\" \"1.00\"\n"
+        "TYPE\n"
+        "\"variable\" STRUCT(\n\"value\" FLOAT DOUBLE\n) PROP( \"key\" \"element\" )\n"
+        "VALUE\n"
+        "\"vdc\" \"variable\" ( 500e-3 ) PROP( )\n"
+        "\"res\" \"variable\" ( 500 ) PROP( )\n"
+        "END\n",
+        "HEADER\n"
+        "\"PSFversion\" \"1.00\"\n"
+        "TYPE\n"
+        "\"variable\" STRUCT(\n\"value\" FLOAT DOUBLE\n) PROP( \"key\" \"element\" )\n"
+        "\"label\" STRING *\n"
+        "VALUE\n"
+        "\"vdc\" \"variable\" ( 0.7 ) PROP( )\n"
+        "\"corner\" \"label\" \"tt\"\n"
+        "\"cap\" \"variable\" ( 1e-12 ) PROP( )\n"
+        "END\n" };
+
+    void write_text(const std::string & filename, const char * text) {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out << text;
+    }
+
+    std::string get_run_dir(const std::string & dir_name, size_t run) {
+        return dir_name + "/" + std::to_string(run + 1);
+    }
+
+    std::vector<std::string> write_runs(const std::string & dir_name) {
+        std::vector<std::string> ans;
+        for (size_t run = 0; run < NUM_POINTS.size(); ++run) {
+            std::string run_dir = get_run_dir(dir_name, run);
+            psf::make_dirs(run_dir);
+            psf::GenOptions gen_opts;
+            gen_opts.m_layout = (run == 0) ? psf::GenOptions::layout::SIMPLE : psf::GenOptions::layout::WINDOWED;
+            gen_opts.m_num_points = NUM_POINTS[run];
+            gen_opts.m_num_double = NUM_DOUBLE;
+            gen_opts.m_window_size = 512;
+            ans.push_back(run_dir + "/tran.tran");
+            psf::write_synthetic_psf(ans.back(), gen_opts);
+        }
+        write_text(get_run_dir(dir_name, 0) + "/" + psf::DESIGN_VAR_FILENAME, RUN_VARS[0]);
+        write_text(get_run_dir(dir_name, 1) + "/" + psf::ARTIST_LOG_FILENAME, ARTIST_LOG);
+        write_text(get_run_dir(dir_name, 1) + "/run_vars", RUN_VARS[1]);
+        return ans;
+    }
+
+    void remove_runs(const std::string & dir_name) {
+        const char * names[4] = { "tran.tran", psf::DESIGN_VAR_FILENAME, psf::ARTIST_LOG_FILENAME, "run_vars" };
+        for (size_t run = 0; run < NUM_POINTS.size(); ++run) {
+            for (uint32_t idx = 0; idx < 4; ++idx) {
+                std::remove((get_run_dir(dir_name, run) + "/" + names[idx]).c_str());
+            }
+            std::remove(get_run_dir(dir_name, run).c_str());
+        }
+        std::remove(dir_name.c_str());
+    }
+
+    // returns true if lhs and rhs are equal, or both NaN.
+    bool same_param(double lhs, double rhs) {
+        return (std::isnan(lhs) && std::isnan(rhs)) || lhs == rhs;
+    }
+
+    bool check_params(H5::H5File & file, const std::string & name, const std::vector<double> & expected) {
+        std::vector<double> vals = psftest::read_dataset<double>(file, std::string(psf::MERGE_PARAM_GROUP) + "/" +
+            name, H5::PredType::NATIVE_DOUBLE);
+        bool ans = (vals.size() == expected.size());
+        for (size_t idx = 0; ans && idx < vals.size(); ++idx) {
+            ans = same_param(vals[idx], expected[idx]);
+        }
+        return psftest::check(ans, "design variable " + name);
+    }
+
+    bool check_merge(const std::string & dir_name, const std::string & hdf5_filename) {
+        using psftest::check;
+        std::vector<std::string> psf_filenames = write_runs(dir_name);
+        bool ans = check(psf::find_design_var_file(psf_filenames[1]) == get_run_dir(dir_name, 1) + "/run_vars",
+            "design variable file named by the log");
+        psf::ConvertOptions opts;
+        // small blocks, so rows are written in several blocks.
+        opts.m_block_points = 64;
+        psf::merge_psf(psf_filenames, hdf5_filename, opts);
+
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        uint32_t max_points = NUM_POINTS[0];
+        std::vector<uint64_t> row_points = psftest::read_dataset<uint64_t>(file, psf::ROW_POINTS_NAME,
+            H5::PredType::NATIVE_UINT64);
+        ans = check(row_points == std::vector<uint64_t>(NUM_POINTS.begin(), NUM_POINTS.end()),
+            "points of each row") && ans;
+        std::vector<hsize_t> dims = psftest::get_dims(file, "d1");
+        ans = check(dims.size() == 2 && dims[0] == NUM_POINTS.size() && dims[1] == max_points,
+            "[param_index, sweep_point] shape") && ans;
+
+        std::vector<double> sweep = psftest::read_dataset<double>(file, "time", H5::PredType::NATIVE_DOUBLE);
+        std::vector<double> trace = psftest::read_dataset<double>(file, "d1", H5::PredType::NATIVE_DOUBLE);
+        bool values_ok = (sweep.size() == NUM_POINTS.size() * max_points && trace.size() == sweep.size());
+        bool padding_ok = values_ok;
+        for (size_t row = 0; values_ok && row < NUM_POINTS.size(); ++row) {
+            for (uint32_t point = 0; point < max_points; ++point) {
+                size_t idx = row * max_points + point;
+                if (point < NUM_POINTS[row]) {
+                    values_ok = values_ok && sweep[idx] == psf::get_synthetic_sweep(point) &&
+                        trace[idx] == psf::get_synthetic_value(1, point);
+                }
+                else {
+                    padding_ok = padding_ok && sweep[idx] == 0.0 && trace[idx] == 0.0;
+                }
+            }
+        }
+        ans = check(values_ok, "values of each row") && ans;
+        ans = check(padding_ok, "short rows padded with zeros") && ans;
+
+        double nan = std::nan("");
+        ans = check(file.openGroup(psf::MERGE_PARAM_GROUP).getNumObjs() == 3, "union of design variables") && ans;
+        ans = check_params(file, "vdc", { 0.5, 0.7 }) && ans;
+        ans = check_params(file, "res", { 500.0, nan }) && ans;
+        ans = check_params(file, "cap", { nan, 1e-12 }) && ans;
+        file.close();
+        std::remove(hdf5_filename.c_str());
+
+        // a run with other traces cannot be merged.
+        psf::GenOptions gen_opts;
+        gen_opts.m_num_points = NUM_POINTS[1];
+        gen_opts.m_num_double = NUM_DOUBLE + 1;
+        psf::write_synthetic_psf(psf_filenames[1], gen_opts);
+        bool thrown = false;
+        try {
+            psf::merge_psf(psf_filenames, hdf5_filename, opts);
+        }
+        catch (std::runtime_error & e) {
+            thrown = (std::string(e.what()).find("different sweep or trace variables") != std::string::npos);
+        }
+        ans = check(thrown, "runs with different traces are rejected") && ans;
+        std::remove(hdf5_filename.c_str());
+        remove_runs(dir_name);
+        return ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    bool ok = true;
+    try {
+        ok = check_merge(dir_name + "/merge_runs", dir_name + "/merge.hdf5") && ok;
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    catch (H5::Exception & e) {
+        std::cout << "HDF5 exception caught: " << std::endl;
+        std::cout << e.getDetailMsg() << std::endl;
+        ok = false;
+    }
+    return psftest::report(ok, "Merge");
+}
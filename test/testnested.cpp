@@ -0,0 +1,97 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+
+#include "psf.hpp"
+#include "psfgen.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks that nested sweeps are converted to one row per inner sweep.  A
+ * synthetic nested file, whose outer sweep values repeat, is converted with
+ * blocks smaller and larger than a row, and all datasets are compared with the
+ * synthetic values.  Files are written to the given directory (default:
+ * current directory) and removed afterwards.
+ */
+
+namespace {
+
+    static constexpr uint32_t NUM_ROWS = 5;
+    static constexpr uint32_t NUM_INNER = 7;
+
+    bool check_hdf5_file(const std::string & hdf5_filename, uint32_t num_rows, const std::string & msg) {
+        using psftest::check;
+        H5::H5File file(hdf5_filename, H5F_ACC_RDONLY);
+        std::vector<uint64_t> row_points = psftest::read_dataset<uint64_t>(file, psf::ROW_POINTS_NAME,
+            H5::PredType::NATIVE_UINT64);
+        bool ans = check(row_points == std::vector<uint64_t>(num_rows, NUM_INNER), msg + ": points of each row");
+
+        std::vector<double> outer = psftest::read_dataset<double>(file, "vdd", H5::PredType::NATIVE_DOUBLE);
+        bool outer_ok = (outer.size() == num_rows);
+        for (uint32_t row = 0; outer_ok && row < num_rows; ++row) {
+            outer_ok = (outer[row] == psf::get_synthetic_outer(row));
+        }
+        ans = check(outer_ok, msg + ": outer sweep values") && ans;
+
+        std::vector<hsize_t> dims = psftest::get_dims(file, "time");
+        ans = check(dims.size() == 2 && dims[0] == num_rows && dims[1] == NUM_INNER, msg + ": inner sweep shape") &&
+            ans;
+        std::vector<double> inner = psftest::read_dataset<double>(file, "time", H5::PredType::NATIVE_DOUBLE);
+        std::vector<double> trace = psftest::read_dataset<double>(file, "d1", H5::PredType::NATIVE_DOUBLE);
+        std::vector<int32_t> ints = psftest::read_dataset<int32_t>(file, "i0", H5::PredType::NATIVE_INT32);
+        bool inner_ok = (inner.size() == num_rows * NUM_INNER);
+        bool trace_ok = (trace.size() == inner.size() && ints.size() == inner.size());
+        for (uint32_t point = 0; point < num_rows * NUM_INNER; ++point) {
+            double val = psf::get_synthetic_value(1, point);
+            inner_ok = inner_ok && inner[point] == psf::get_synthetic_sweep(point % NUM_INNER);
+            trace_ok = trace_ok && trace[point] == val &&
+                ints[point] == static_cast<int32_t>(psf::get_synthetic_value(2, point));
+        }
+        ans = check(inner_ok, msg + ": inner sweep values") && ans;
+        return check(trace_ok, msg + ": trace values") && ans;
+    }
+
+    bool check_conversion(const std::string & dir_name, uint32_t num_rows, uint32_t block_points, bool pipeline) {
+        std::string psf_filename = dir_name + "/nested.psf";
+        std::string hdf5_filename = dir_name + "/nested.hdf5";
+        std::string msg = std::to_string(num_rows) + " rows, " + std::to_string(block_points) + " point blocks";
+
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::NESTED;
+        gen_opts.m_num_rows = num_rows;
+        gen_opts.m_num_points = NUM_INNER;
+        gen_opts.m_num_double = 2;
+        gen_opts.m_num_int32 = 1;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+
+        psf::ConvertOptions opts;
+        opts.m_block_points = block_points;
+        opts.m_pipeline = pipeline;
+        psf::read_psf(psf_filename, hdf5_filename, false, opts);
+        bool ans = check_hdf5_file(hdf5_filename, num_rows, msg);
+        std::remove(psf_filename.c_str());
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    bool ok = true;
+    try {
+        ok = check_conversion(dir_name, NUM_ROWS, 3, false) && ok;
+        ok = check_conversion(dir_name, NUM_ROWS, NUM_INNER, true) && ok;
+        ok = check_conversion(dir_name, NUM_ROWS, 1000, true) && ok;
+        ok = check_conversion(dir_name, 1, 4, true) && ok;
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    return psftest::report(ok, "Nested sweep");
+}
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "psffile.hpp"
+#include "psfgen.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks range queries: find_range() returns the points of a sweep interval,
+ * and the range getters return the same values as a slice of the whole
+ * signal, for windowed and simple sweeps and ranges across window
+ * boundaries.  Nested sweeps are rejected.  Files are written to the given
+ * directory (default: current directory) and removed afterwards.
+ */
+
+namespace {
+
+    static constexpr uint32_t NUM_POINTS = 1000;
+    // 64 points per window.
+    static constexpr uint32_t WINDOW_SIZE = 512;
+
+    // returns true if the range values equal the slice of the whole signal.
+    template <typename T>
+    bool same_slice(const std::vector<T> & values, const psf::Span<T> & whole, const psf::PointRange & range) {
+        return values.size() == range.m_size && range.m_first + range.m_size <= whole.size() &&
+            std::equal(values.begin(), values.end(), whole.begin() + range.m_first);
+    }
+
+    /**
+     * Checks the range of sweep points [first, last].  The range is found
+     * from sweep values halfway between points, and read both before and
+     * after the whole signals are decoded.
+     */
+    bool check_range(const std::string & psf_filename, uint32_t first, uint32_t last, bool with_others,
+        const std::string & msg) {
+        using psftest::check;
+        double t_start = (first - 0.5) * psf::get_synthetic_sweep(1);
+        double t_stop = (last + 0.5) * psf::get_synthetic_sweep(1);
+
+        psf::PsfFile file(psf_filename);
+        psf::PointRange range = file.find_range(t_start, t_stop);
+        bool ans = check(range.m_first == first && range.m_size == last - first + 1, msg + ": points found");
+        std::vector<double> sweep = file.get_double("time", range);
+        std::vector<double> trace = file.get_double("d1", range);
+        std::vector<std::complex<double>> complexes;
+        std::vector<int32_t> ints;
+        if (with_others) {
+            complexes = file.get_complex("c0", range);
+            ints = file.get_int32("i0", range);
+        }
+
+        // the whole signals, decoded after the ranges.
+        bool values_ok = same_slice(sweep, file.get_double("time"), range) &&
+            same_slice(trace, file.get_double("d1"), range);
+        if (with_others) {
+            values_ok = values_ok && same_slice(complexes, file.get_complex("c0"), range) &&
+                same_slice(ints, file.get_int32("i0"), range);
+        }
+        for (uint32_t idx = 0; values_ok && idx < trace.size(); ++idx) {
+            values_ok = (trace[idx] == psf::get_synthetic_value(1, first + idx));
+        }
+        ans = check(values_ok, msg + ": values equal a slice") && ans;
+
+        // ranges of decoded signals are copied from them.
+        ans = check(file.get_double("d1", range) == trace, msg + ": values of a decoded signal") && ans;
+        return ans;
+    }
+
+    bool check_empty_ranges(const std::string & psf_filename, const std::string & msg) {
+        psf::PsfFile file(psf_filename);
+        double step = psf::get_synthetic_sweep(1);
+        psf::PointRange between = file.find_range(10.25 * step, 10.75 * step);
+        psf::PointRange after = file.find_range((NUM_POINTS + 1) * step, (NUM_POINTS + 2) * step);
+        bool ans = psftest::check(between.m_size == 0 && file.get_double("d1", between).empty(),
+            msg + ": no point between two points");
+        return psftest::check(after.m_size == 0, msg + ": no point after the sweep") && ans;
+    }
+
+    bool check_sweep(const std::string & psf_filename, const psf::GenOptions & gen_opts, const std::string & msg) {
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        bool with_others = (gen_opts.m_num_complex > 0);
+        bool ans = check_range(psf_filename, 0, NUM_POINTS - 1, with_others, msg + ", whole sweep");
+        ans = check_range(psf_filename, 10, 20, with_others, msg + ", inside a window") && ans;
+        ans = check_range(psf_filename, 60, 70, with_others, msg + ", across a window boundary") && ans;
+        ans = check_range(psf_filename, 63, 64, with_others, msg + ", last and first points of windows") && ans;
+        ans = check_range(psf_filename, 100, 300, with_others, msg + ", across several windows") && ans;
+        ans = check_range(psf_filename, 990, NUM_POINTS - 1, with_others, msg + ", last window") && ans;
+        ans = check_range(psf_filename, 500, 500, with_others, msg + ", one point") && ans;
+        ans = check_empty_ranges(psf_filename, msg) && ans;
+        std::remove(psf_filename.c_str());
+        return ans;
+    }
+
+    bool check_nested(const std::string & psf_filename) {
+        psf::GenOptions gen_opts;
+        gen_opts.m_layout = psf::GenOptions::layout::NESTED;
+        gen_opts.m_num_rows = 3;
+        gen_opts.m_num_points = 10;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        // the file itself is valid, so only the range queries may throw.
+        psf::PsfFile file(psf_filename);
+        bool ans = psftest::check(file.get_num_points() > 0, "nested sweep is opened");
+
+        bool thrown = false;
+        try {
+            file.find_range(0.0, 1.0);
+        }
+        catch (std::runtime_error &) {
+            thrown = true;
+        }
+        ans = psftest::check(thrown, "nested sweep range is rejected") && ans;
+
+        thrown = false;
+        try {
+            file.get_double("d0", psf::PointRange(0, 5));
+        }
+        catch (std::runtime_error &) {
+            thrown = true;
+        }
+        ans = psftest::check(thrown, "nested sweep range getter is rejected") && ans;
+        std::remove(psf_filename.c_str());
+        return ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    std::string psf_filename = dir_name + "/range.psf";
+    bool ok = true;
+    try {
+        psf::GenOptions gen_opts;
+        gen_opts.m_num_points = NUM_POINTS;
+        gen_opts.m_num_double = 3;
+        gen_opts.m_window_size = WINDOW_SIZE;
+        ok = check_sweep(psf_filename, gen_opts, "windowed") && ok;
+
+        gen_opts.m_layout = psf::GenOptions::layout::SIMPLE;
+        gen_opts.m_num_complex = 1;
+        gen_opts.m_num_int32 = 1;
+        ok = check_sweep(psf_filename, gen_opts, "simple") && ok;
+
+        ok = check_nested(psf_filename) && ok;
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    std::remove(psf_filename.c_str());
+    return psftest::report(ok, "Range");
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "psfascii.hpp"
+#include "psffile.hpp"
+#include "psfgen.hpp"
+#include "psfscan.hpp"
+#include "testutil.hpp"
+
+/**
+ * Checks that scan_psf() lists the types, sweeps and traces of binary and
+ * ASCII PSF files, and their number of points, without reading values.
+ * Synthetic files are written to the given directory (default: current
+ * directory) and removed afterwards.  If a psf_samples directory is given,
+ * the binary and ASCII results of a Spectre transient analysis are scanned
+ * as well.
+ */
+
+namespace {
+
+    std::vector<std::string> get_names(const std::vector<psf::SignalSummary> & signals) {
+        std::vector<std::string> ans;
+        for (auto its = signals.begin(); its != signals.end(); ++its) {
+            ans.push_back((*its).m_name);
+        }
+        return ans;
+    }
+
+    const psf::TypeSummary * find_type(const psf::PsfSummary & summary, const std::string & name) {
+        for (auto itt = summary.m_types.begin(); itt != summary.m_types.end(); ++itt) {
+            if ((*itt).m_name == name) {
+                return &(*itt);
+            }
+        }
+        return nullptr;
+    }
+
+    bool check_synthetic(const std::string & psf_filename, const psf::GenOptions & gen_opts,
+        const std::vector<std::string> & sweeps, const std::vector<std::string> & traces, const std::string & msg) {
+        using psftest::check;
+        psf::write_synthetic_psf(psf_filename, gen_opts);
+        auto summary = psf::scan_psf(psf_filename);
+        bool ans = check(!summary->m_is_ascii, msg + ": binary format");
+        ans = check(get_names(summary->m_sweeps) == sweeps, msg + ": sweep names") && ans;
+        ans = check(get_names(summary->m_traces) == traces, msg + ": trace names") && ans;
+        const psf::TypeSummary * type = find_type(*summary, "V");
+        ans = check(type != nullptr && type->m_data_type == "double" && type->m_value_size == sizeof(double),
+            msg + ": double type") && ans;
+        if (gen_opts.m_layout != psf::GenOptions::layout::NESTED) {
+            uint64_t num_points = sweeps.empty() ? 0 : psf::PsfFile(psf_filename).get_num_points();
+            ans = check(summary->m_num_points == num_points, msg + ": number of points") && ans;
+        }
+        bool windowed = (gen_opts.m_layout == psf::GenOptions::layout::WINDOWED);
+        ans = check(summary->m_win_size == (windowed ? gen_opts.m_window_size : 0), msg + ": window size") && ans;
+
+        std::string json = summary->to_json();
+        ans = check(json.find("{\"format\": \"binary\", \"num_points\": " + std::to_string(summary->m_num_points)) == 0,
+            msg + ": JSON header") && ans;
+        ans = check(traces.empty() || json.find("{\"name\": \"" + traces.back() + "\", \"type\": ") != std::string::npos,
+            msg + ": JSON traces") && ans;
+        std::remove(psf_filename.c_str());
+        return ans;
+    }
+
+    // scans the ASCII and binary results of the same transient analysis.
+    bool check_samples(const std::string & samples_dir) {
+        using psftest::check;
+        std::string dir_name = samples_dir + "/tran_dc_ac_long/1/test/psf";
+        auto ascii = psf::scan_psf(dir_name + "/tran.ascii");
+        auto binary = psf::scan_psf(dir_name + "/tran.tran.tran");
+        bool ans = check(ascii->m_is_ascii && !binary->m_is_ascii, "sample formats");
+        ans = check(ascii->m_num_points == psf::read_psf_ascii(dir_name + "/tran.ascii")->m_num_points,
+            "ASCII points are counted as parsed") && ans;
+        ans = check(binary->m_num_points == psf::PsfFile(dir_name + "/tran.tran.tran").get_num_points(),
+            "binary points") && ans;
+        ans = check(ascii->m_num_points == binary->m_num_points, "ASCII and binary points") && ans;
+        ans = check(get_names(ascii->m_sweeps) == get_names(binary->m_sweeps), "ASCII and binary sweeps") && ans;
+        ans = check(get_names(ascii->m_traces) == get_names(binary->m_traces), "ASCII and binary traces") && ans;
+        const psf::TypeSummary * type = find_type(*ascii, "V");
+        ans = check(type != nullptr && type->m_data_type == "double" && type->m_value_size == sizeof(double),
+            "ASCII double type") && ans;
+        return check(ascii->to_json().find("{\"format\": \"ascii\"") == 0, "ASCII JSON header") && ans;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir_name = (argc >= 2) ? argv[1] : ".";
+    std::string psf_filename = dir_name + "/scan.psf";
+    bool ok = true;
+    try {
+        psf::GenOptions gen_opts;
+        gen_opts.m_num_points = 3000;
+        gen_opts.m_num_double = 2;
+        gen_opts.m_window_size = 1024;
+        ok = check_synthetic(psf_filename, gen_opts, { "time" }, { "d0", "d1" }, "windowed") && ok;
+
+        gen_opts.m_layout = psf::GenOptions::layout::SIMPLE;
+        gen_opts.m_num_int32 = 1;
+        ok = check_synthetic(psf_filename, gen_opts, { "time" }, { "d0", "d1", "i0" }, "simple") && ok;
+
+        gen_opts.m_layout = psf::GenOptions::layout::NESTED;
+        gen_opts.m_num_rows = 3;
+        gen_opts.m_num_points = 10;
+        ok = check_synthetic(psf_filename, gen_opts, { "vdd", "time" }, { "d0", "d1", "i0" }, "nested") && ok;
+
+        gen_opts.m_layout = psf::GenOptions::layout::NO_SWEEP;
+        ok = check_synthetic(psf_filename, gen_opts, {}, {}, "no sweep") && ok;
+
+        if (argc >= 3) {
+            ok = check_samples(argv[2]) && ok;
+        }
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        ok = false;
+    }
+    std::remove(psf_filename.c_str());
+    return psftest::report(ok, "Scan");
+}
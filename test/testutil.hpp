@@ -0,0 +1,48 @@
+#ifndef LIBPSF_TESTUTIL_H_
+#define LIBPSF_TESTUTIL_H_
+
+/**
+ *  This header file define helpers shared by the test programs.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "H5Cpp.h"
+
+namespace psftest {
+
+    // prints the result of a check, and returns cond.
+    inline bool check(bool cond, const std::string & msg) {
+        std::cout << (cond ? "ok    " : "FAIL  ") << msg << std::endl;
+        return cond;
+    }
+
+    // returns the dimensions of the given dataset.
+    inline std::vector<hsize_t> get_dims(H5::H5Location & loc, const std::string & name) {
+        H5::DataSpace space = loc.openDataSet(name).getSpace();
+        std::vector<hsize_t> ans(space.getSimpleExtentNdims());
+        space.getSimpleExtentDims(ans.data());
+        return ans;
+    }
+
+    // returns all values of the given dataset, converted to type.
+    template <typename T>
+    std::vector<T> read_dataset(H5::H5Location & loc, const std::string & name, const H5::DataType & type) {
+        H5::DataSet dset = loc.openDataSet(name);
+        H5::DataSpace space = dset.getSpace();
+        std::vector<T> ans(space.getSimpleExtentNpoints());
+        dset.read(ans.data(), type);
+        return ans;
+    }
+
+    // prints the result of a test program, and returns its exit code.
+    inline int report(bool ok, const std::string & name) {
+        std::cout << name << (ok ? " test passed." : " test failed.") << std::endl;
+        return ok ? 0 : 1;
+    }
+
+}
+
+#endif
@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "psfdir.hpp"
+#include "psffile.hpp"
+#include "psfgen.hpp"
+#include "psfreader.hpp"
+
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    // the best time and volume of one conversion stage.
+    class StageResult {
+    public:
+        StageResult() : m_seconds(0.0), m_bytes(0), m_points(0) {}
+        ~StageResult() {}
+
+        double m_seconds;
+        uint64_t m_bytes;
+        // sweep points processed, or 0 if the stage does not process values.
+        uint64_t m_points;
+    };
+
+    // benchmark results of one PSF file.
+    class FileResult {
+    public:
+        FileResult() : m_size(0), m_num_points(0), m_num_signals(0) {}
+        ~FileResult() {}
+
+        std::string m_filename;
+        std::string m_layout;
+        uint64_t m_size;
+        uint64_t m_num_points;
+        uint64_t m_num_signals;
+        std::vector<std::pair<std::string, StageResult>> m_stages;
+        std::string m_error;
+    };
+
+    void print_usage() {
+        std::cout << "Usage: psf_bench [options] <file_or_dir> ..." << std::endl;
+        std::cout << "Measure the throughput of each conversion stage of binary PSF files, and" << std::endl;
+        std::cout << "print the results as JSON.  Directories are searched for PSF files." << std::endl;
+        std::cout << "Stages:" << std::endl;
+        std::cout << "  parse       read the header, type, sweep and trace sections." << std::endl;
+        std::cout << "  decode      decode all values, without HDF5." << std::endl;
+        std::cout << "  write       write the decoded values to HDF5." << std::endl;
+        std::cout << "  convert     convert the whole file to HDF5." << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  -n <num>    run each stage num times and keep the fastest (default: 3)." << std::endl;
+        std::cout << "  -o <file>   write results to file instead of standard output." << std::endl;
+        std::cout << "  -t <file>   temporary HDF5 file (default: psf_bench.hdf5)." << std::endl;
+        std::cout << "  -s <dir>    also generate and measure a synthetic set of files in dir." << std::endl;
+        std::cout << "  -p <num>    number of sweep points of the synthetic files (default: 100000)." << std::endl;
+    }
+
+    double elapsed(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    uint64_t get_file_size(const std::string & filename) {
+        std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+        return file ? static_cast<uint64_t>(file.tellg()) : 0;
+    }
+
+    /**
+     * Time reading the header, type, sweep and trace sections, and set
+     * section_bytes to the number of bytes they occupy.
+     */
+    double run_parse(const std::string & filename, FileResult & result, uint64_t & section_bytes) {
+        psf::ByteCursor data(filename);
+        if (!data.good()) {
+            throw std::runtime_error("Error opening file " + filename);
+        }
+        // reading types creates HDF5 data types.
+        psf::H5Lock h5_lock;
+        Clock::time_point start = Clock::now();
+        auto sections = psf::read_sections(data);
+        double ans = elapsed(start);
+        section_bytes = data.tell();
+
+        if (sections->m_sweep_list->empty()) {
+            result.m_layout = "none";
+        }
+        else if (sections->m_sweep_list->size() > 1) {
+            result.m_layout = "nested";
+        }
+        else {
+            result.m_layout = (sections->m_win_size > 0) ? "windowed" : "simple";
+        }
+        return ans;
+    }
+
+    // decode all signals of file.
+    void decode_all(psf::PsfFile & file) {
+        std::vector<std::string> names = file.get_names();
+        for (auto itn = names.begin(); itn != names.end(); ++itn) {
+            switch (file.get_type(*itn).m_data_type) {
+            case psf::TypeDef::TYPEID_DOUBLE:
+                file.get_double(*itn);
+                break;
+            case psf::TypeDef::TYPEID_COMPLEXDOUBLE:
+                file.get_complex(*itn);
+                break;
+            case psf::TypeDef::TYPEID_INT32:
+                file.get_int32(*itn);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    double run_decode(psf::PsfFile & file) {
+        file.release_all();
+        Clock::time_point start = Clock::now();
+        decode_all(file);
+        return elapsed(start);
+    }
+
+    /**
+     * Time writing the decoded values of file to 1-D datasets, the way the
+     * converter lays them out.  Returns the number of bytes written.
+     */
+    double run_write(psf::PsfFile & file, const std::string & hdf5_filename, uint64_t & num_bytes) {
+        decode_all(file);
+        std::vector<std::string> names = file.get_names();
+        psf::ConvertOptions opts;
+        hsize_t num_points = file.get_num_points();
+        hsize_t file_dim[1] = { num_points };
+
+        psf::H5Lock h5_lock;
+        Clock::time_point start = Clock::now();
+        {
+            auto h5_file = psf::create_hdf5_file(hdf5_filename, opts);
+            H5::DataSpace space(1, file_dim, file_dim);
+            num_bytes = 0;
+            for (size_t idx = 0; idx < names.size(); ++idx) {
+                const psf::TypeDef & type = file.get_type(names[idx]);
+                const char * values;
+                switch (type.m_data_type) {
+                case psf::TypeDef::TYPEID_DOUBLE:
+                    values = reinterpret_cast<const char *>(file.get_double(names[idx]).data());
+                    break;
+                case psf::TypeDef::TYPEID_COMPLEXDOUBLE:
+                    values = reinterpret_cast<const char *>(file.get_complex(names[idx]).data());
+                    break;
+                case psf::TypeDef::TYPEID_INT32:
+                    values = reinterpret_cast<const char *>(file.get_int32(names[idx]).data());
+                    break;
+                default:
+                    continue;
+                }
+                H5::DSetCreatPropList dset_props = psf::make_value_props(opts, num_points, num_points,
+                    type.m_value_size);
+                // signal names may contain '/', so datasets are numbered.
+                std::string dset_name = "s" + std::to_string(idx);
+                H5::DataSet dset = h5_file->createDataSet(dset_name.c_str(), type.m_h5_write_type, space,
+                    dset_props);
+                psf::write_values(&dset, type, values, space, space);
+                dset.close();
+                num_bytes += num_points * type.m_value_size;
+            }
+            h5_file->close();
+        }
+        return elapsed(start);
+    }
+
+    double run_convert(const std::string & filename, const std::string & hdf5_filename) {
+        Clock::time_point start = Clock::now();
+        psf::convert_psf(filename, hdf5_filename);
+        return elapsed(start);
+    }
+
+    // keep the fastest of the runs of a stage.
+    void add_run(FileResult & result, const std::string & stage, double seconds, uint64_t bytes,
+        uint64_t points) {
+        for (auto its = result.m_stages.begin(); its != result.m_stages.end(); ++its) {
+            if ((*its).first == stage) {
+                if (seconds < (*its).second.m_seconds) {
+                    (*its).second.m_seconds = seconds;
+                }
+                return;
+            }
+        }
+        StageResult stage_result;
+        stage_result.m_seconds = seconds;
+        stage_result.m_bytes = bytes;
+        stage_result.m_points = points;
+        result.m_stages.push_back(std::make_pair(stage, stage_result));
+    }
+
+    FileResult bench_file(const std::string & filename, const std::string & hdf5_filename, int num_runs) {
+        FileResult ans;
+        ans.m_filename = filename;
+        ans.m_size = get_file_size(filename);
+        try {
+            psf::PsfFile file(filename);
+            ans.m_num_points = file.get_num_points();
+            ans.m_num_signals = file.get_names().size();
+            for (int run = 0; run < num_runs; ++run) {
+                uint64_t section_bytes = 0;
+                double seconds = run_parse(filename, ans, section_bytes);
+                add_run(ans, "parse", seconds, section_bytes, 0);
+
+                seconds = run_decode(file);
+                add_run(ans, "decode", seconds, ans.m_size - section_bytes, ans.m_num_points);
+
+                uint64_t write_bytes = 0;
+                seconds = run_write(file, hdf5_filename, write_bytes);
+                add_run(ans, "write", seconds, write_bytes, ans.m_num_points);
+                file.release_all();
+
+                seconds = run_convert(filename, hdf5_filename);
+                add_run(ans, "convert", seconds, ans.m_size, ans.m_num_points);
+            }
+        }
+        catch (std::exception & e) {
+            ans.m_error = e.what();
+        }
+        catch (H5::Exception & e) {
+            ans.m_error = e.getDetailMsg();
+        }
+        std::remove(hdf5_filename.c_str());
+        return ans;
+    }
+
+    /**
+     * Write the synthetic benchmark set to dir_name: a windowed sweep of
+     * double traces in a group, a simple sweep of every trace type, and a
+     * non-sweep file.  Returns the file names.
+     */
+    std::vector<std::string> write_synthetic_set(const std::string & dir_name, uint32_t num_points) {
+        psf::make_dirs(dir_name);
+        std::vector<std::string> ans;
+
+        psf::GenOptions opts;
+        opts.m_layout = psf::GenOptions::layout::WINDOWED;
+        opts.m_num_points = num_points;
+        opts.m_num_double = 100;
+        opts.m_use_group = true;
+        ans.push_back(dir_name + "/windowed.tran");
+        psf::write_synthetic_psf(ans.back(), opts);
+
+        opts.m_layout = psf::GenOptions::layout::SIMPLE;
+        opts.m_num_double = 8;
+        opts.m_num_complex = 4;
+        opts.m_num_int32 = 2;
+        opts.m_num_struct = 2;
+        opts.m_use_group = false;
+        ans.push_back(dir_name + "/simple.ac");
+        psf::write_synthetic_psf(ans.back(), opts);
+
+        opts.m_layout = psf::GenOptions::layout::NO_SWEEP;
+        opts.m_num_double = 1000;
+        opts.m_num_complex = 100;
+        opts.m_num_int32 = 100;
+        opts.m_num_struct = 100;
+        ans.push_back(dir_name + "/nosweep.dc");
+        psf::write_synthetic_psf(ans.back(), opts);
+        return ans;
+    }
+
+    // returns rate per second, or 0 if the stage was too fast to measure.
+    double get_rate(double amount, double seconds) {
+        return (seconds > 0.0) ? amount / seconds : 0.0;
+    }
+
+    void write_json(std::ostream & out, const std::vector<FileResult> & results, int num_runs) {
+        out << "{" << std::endl;
+        out << "  \"num_runs\": " << num_runs << "," << std::endl;
+        out << "  \"files\": [";
+        for (size_t idx = 0; idx < results.size(); ++idx) {
+            const FileResult & result = results[idx];
+            out << ((idx == 0) ? "" : ",") << std::endl << "    {" << std::endl;
+            out << "      \"file\": " << psf::json_quote(result.m_filename) << "," << std::endl;
+            out << "      \"layout\": " << psf::json_quote(result.m_layout) << "," << std::endl;
+            out << "      \"size\": " << result.m_size << "," << std::endl;
+            out << "      \"num_points\": " << result.m_num_points << "," << std::endl;
+            out << "      \"num_signals\": " << result.m_num_signals << "," << std::endl;
+            if (!result.m_error.empty()) {
+                out << "      \"error\": " << psf::json_quote(result.m_error) << "," << std::endl;
+            }
+            out << "      \"stages\": {";
+            for (size_t stage = 0; stage < result.m_stages.size(); ++stage) {
+                const StageResult & stage_result = result.m_stages[stage].second;
+                out << ((stage == 0) ? "" : ",") << std::endl;
+                out << "        " << psf::json_quote(result.m_stages[stage].first) << ": {";
+                out << "\"seconds\": " << stage_result.m_seconds;
+                out << ", \"bytes\": " << stage_result.m_bytes;
+                out << ", \"mb_per_s\": " << get_rate(stage_result.m_bytes / 1.0e6, stage_result.m_seconds);
+                if (stage_result.m_points > 0) {
+                    out << ", \"points_per_s\": " << get_rate(static_cast<double>(stage_result.m_points),
+                        stage_result.m_seconds);
+                }
+                out << "}";
+            }
+            out << std::endl << "      }" << std::endl << "    }";
+        }
+        out << std::endl << "  ]" << std::endl << "}" << std::endl;
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    int num_runs = 3;
+    std::string out_filename;
+    std::string hdf5_filename = "psf_bench.hdf5";
+    std::string synthetic_dir;
+    uint32_t num_synthetic_points = 100000;
+    std::vector<std::string> inputs;
+
+    for (int idx = 1; idx < argc; ++idx) {
+        std::string arg = argv[idx];
+        if ((arg == "-n" || arg == "-o" || arg == "-t" || arg == "-s" || arg == "-p") && idx + 1 < argc) {
+            std::string val = argv[++idx];
+            if (arg == "-n") {
+                num_runs = std::max(std::atoi(val.c_str()), 1);
+            }
+            else if (arg == "-o") {
+                out_filename = val;
+            }
+            else if (arg == "-s") {
+                synthetic_dir = val;
+            }
+            else if (arg == "-p") {
+                num_synthetic_points = static_cast<uint32_t>(std::strtoul(val.c_str(), nullptr, 10));
+            }
+            else {
+                hdf5_filename = val;
+            }
+        }
+        else if (arg[0] != '-') {
+            inputs.push_back(arg);
+        }
+        else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (inputs.empty() && synthetic_dir.empty()) {
+        print_usage();
+        return 2;
+    }
+
+    try {
+        psf::configure_logging("", false);
+
+        std::vector<std::string> filenames;
+        if (!synthetic_dir.empty()) {
+            filenames = write_synthetic_set(synthetic_dir, num_synthetic_points);
+        }
+        for (auto iti = inputs.begin(); iti != inputs.end(); ++iti) {
+            if (psf::is_binary_psf(*iti)) {
+                filenames.push_back(*iti);
+                continue;
+            }
+            auto found = psf::find_psf_files(*iti);
+            for (auto itf = found.begin(); itf != found.end(); ++itf) {
+                filenames.push_back(*iti + "/" + *itf);
+            }
+        }
+
+        // files that cannot be converted are reported with their error, so
+        // one unsupported sample does not hide the others.
+        std::vector<FileResult> results;
+        for (auto itf = filenames.begin(); itf != filenames.end(); ++itf) {
+            results.push_back(bench_file(*itf, hdf5_filename, num_runs));
+            if (!results.back().m_error.empty()) {
+                std::cerr << "SKIPPED " << *itf << ": " << results.back().m_error << std::endl;
+            }
+        }
+
+        if (out_filename.empty()) {
+            write_json(std::cout, results, num_runs);
+        }
+        else {
+            std::ofstream out(out_filename);
+            write_json(out, results, num_runs);
+        }
+    }
+    catch (std::exception & e) {
+        std::cerr << "Exception caught: " << std::endl;
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
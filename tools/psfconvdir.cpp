@@ -0,0 +1,140 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "psfdir.hpp"
+#include "psfmerge.hpp"
+
+
+void print_usage() {
+    std::cout << "Usage: psfconvdir [options] <run_dir> <out_dir>" << std::endl;
+    std::cout << "       psfconvdir [options] -p <rel_name> <run_dir> <out_file>" << std::endl;
+    std::cout << "Convert all binary PSF files under run_dir to HDF5 files under out_dir, or" << std::endl;
+    std::cout << "merge run_dir/<run>/rel_name of all parametric runs into out_file." << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -j <num>    number of files converted at once (default: number of cores)." << std::endl;
+    std::cout << "  -m <MB>     memory cap for the value buffers of one file, in megabytes." << std::endl;
+    std::cout << "  -p <name>   merge the given file of each parametric run." << std::endl;
+    std::cout << "  -i <pat>    only convert traces matching pattern (may be repeated)." << std::endl;
+    std::cout << "  -x <pat>    do not convert traces matching pattern (may be repeated)." << std::endl;
+    std::cout << "  -r          patterns are regular expressions instead of globs." << std::endl;
+    std::cout << "  -t          write the values of non-sweep files as one table per type." << std::endl;
+    std::cout << "  -g          write the traces of sweep files as one matrix per type." << std::endl;
+    std::cout << "  -a          write each distinct set of trace properties once, and reference it." << std::endl;
+    std::cout << "  -l <file>   write log messages to file." << std::endl;
+    std::cout << "  -s <file>   write conversion statistics of every file to file, as JSON." << std::endl;
+    std::cout << "  -v          print log messages." << std::endl;
+}
+
+// write the statistics of every file as a JSON array.
+void write_stats(const std::string & stats_filename, const std::vector<psf::DirResult> & results) {
+    std::ofstream out(stats_filename);
+    out << "[";
+    for (size_t idx = 0; idx < results.size(); ++idx) {
+        const psf::DirResult & result = results[idx];
+        out << ((idx == 0) ? "" : ",") << std::endl;
+        out << "  {\"file\": " << psf::json_quote(result.m_psf_filename) << ", \"ok\": " <<
+            (result.m_ok ? "true" : "false") << ", \"stats\": " << result.m_stats.to_json() << "}";
+    }
+    out << std::endl << "]" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    psf::DirOptions opts;
+    std::string log_filename;
+    std::string merge_name;
+    std::string stats_filename;
+    bool print_msg = false;
+    std::string in_dir, out_dir;
+
+    for (int idx = 1; idx < argc; ++idx) {
+        std::string arg = argv[idx];
+        if ((arg == "-j" || arg == "-m" || arg == "-l" || arg == "-p" || arg == "-i" ||
+            arg == "-x" || arg == "-s") && idx + 1 < argc) {
+            std::string val = argv[++idx];
+            if (arg == "-j") {
+                opts.m_num_threads = static_cast<unsigned int>(std::strtoul(val.c_str(), nullptr, 10));
+            }
+            else if (arg == "-m") {
+                opts.m_job_memory_bytes = static_cast<size_t>(std::strtoull(val.c_str(), nullptr, 10)) << 20;
+            }
+            else if (arg == "-l") {
+                log_filename = val;
+            }
+            else if (arg == "-i") {
+                opts.m_convert.m_include.push_back(val);
+            }
+            else if (arg == "-x") {
+                opts.m_convert.m_exclude.push_back(val);
+            }
+            else if (arg == "-s") {
+                stats_filename = val;
+            }
+            else {
+                merge_name = val;
+            }
+        }
+        else if (arg == "-v") {
+            print_msg = true;
+        }
+        else if (arg == "-r") {
+            opts.m_convert.m_regex = true;
+        }
+        else if (arg == "-t") {
+            opts.m_convert.m_value_tables = true;
+        }
+        else if (arg == "-g") {
+            opts.m_convert.m_trace_matrix = true;
+        }
+        else if (arg == "-a") {
+            opts.m_convert.m_intern_properties = true;
+        }
+        else if (in_dir.empty() && arg[0] != '-') {
+            in_dir = arg;
+        }
+        else if (out_dir.empty() && arg[0] != '-') {
+            out_dir = arg;
+        }
+        else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (in_dir.empty() || out_dir.empty()) {
+        print_usage();
+        return 2;
+    }
+
+    int num_failed = 0;
+    try {
+        psf::configure_logging(log_filename, print_msg);
+        if (!merge_name.empty()) {
+            auto psf_filenames = psf::find_param_runs(in_dir, merge_name);
+            psf::merge_psf(psf_filenames, out_dir, opts.get_job_options());
+            std::cout << psf_filenames.size() << " runs merged into " << out_dir << std::endl;
+            return 0;
+        }
+        auto results = psf::convert_psf_dir(in_dir, out_dir, opts);
+        for (auto it = results.begin(); it != results.end(); ++it) {
+            if ((*it).m_ok) {
+                std::cout << "OK     " << (*it).m_psf_filename << " -> " << (*it).m_hdf5_filename << std::endl;
+            }
+            else {
+                std::cout << "FAILED " << (*it).m_psf_filename << ": " << (*it).m_error << std::endl;
+                ++num_failed;
+            }
+        }
+        std::cout << results.size() - num_failed << " of " << results.size() << " files converted." << std::endl;
+        if (!stats_filename.empty()) {
+            write_stats(stats_filename, results);
+        }
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return (num_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+
+#include "psfgen.hpp"
+
+
+void print_usage() {
+    std::cout << "Usage: psfgen [options] <out_file>" << std::endl;
+    std::cout << "Write a synthetic binary PSF file, e.g. to benchmark or test conversion." << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -l <layout> none, simple, windowed or nested (default: windowed)." << std::endl;
+    std::cout << "  -n <num>    number of (inner) sweep points (default: 1000)." << std::endl;
+    std::cout << "  -d <num>    number of double traces (default: 10)." << std::endl;
+    std::cout << "  -c <num>    number of complex traces (default: 0)." << std::endl;
+    std::cout << "  -i <num>    number of int32 traces (default: 0)." << std::endl;
+    std::cout << "  -s <num>    number of struct traces (default: 0)." << std::endl;
+    std::cout << "  -w <bytes>  window size of windowed sweeps (default: 4096)." << std::endl;
+    std::cout << "  -r <num>    number of outer sweep points of nested sweeps (default: 1)." << std::endl;
+    std::cout << "  -g          list the traces in a group." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    psf::GenOptions opts;
+    std::string out_filename;
+
+    for (int idx = 1; idx < argc; ++idx) {
+        std::string arg = argv[idx];
+        if ((arg == "-l" || arg == "-n" || arg == "-d" || arg == "-c" || arg == "-i" || arg == "-s" ||
+            arg == "-w" || arg == "-r") && idx + 1 < argc) {
+            std::string val = argv[++idx];
+            uint32_t num = static_cast<uint32_t>(std::strtoul(val.c_str(), nullptr, 10));
+            if (arg == "-l") {
+                if (val == "none") {
+                    opts.m_layout = psf::GenOptions::layout::NO_SWEEP;
+                }
+                else if (val == "simple") {
+                    opts.m_layout = psf::GenOptions::layout::SIMPLE;
+                }
+                else if (val == "windowed") {
+                    opts.m_layout = psf::GenOptions::layout::WINDOWED;
+                }
+                else if (val == "nested") {
+                    opts.m_layout = psf::GenOptions::layout::NESTED;
+                }
+                else {
+                    print_usage();
+                    return 2;
+                }
+            }
+            else if (arg == "-n") {
+                opts.m_num_points = num;
+            }
+            else if (arg == "-d") {
+                opts.m_num_double = num;
+            }
+            else if (arg == "-c") {
+                opts.m_num_complex = num;
+            }
+            else if (arg == "-i") {
+                opts.m_num_int32 = num;
+            }
+            else if (arg == "-s") {
+                opts.m_num_struct = num;
+            }
+            else if (arg == "-r") {
+                opts.m_num_rows = num;
+            }
+            else {
+                opts.m_window_size = num;
+            }
+        }
+        else if (arg == "-g") {
+            opts.m_use_group = true;
+        }
+        else if (out_filename.empty() && arg[0] != '-') {
+            out_filename = arg;
+        }
+        else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (out_filename.empty()) {
+        print_usage();
+        return 2;
+    }
+
+    try {
+        uint64_t size = psf::write_synthetic_psf(out_filename, opts);
+        std::cout << out_filename << ": " << size << " bytes." << std::endl;
+    }
+    catch (std::exception & e) {
+        std::cout << "Exception caught: " << std::endl;
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
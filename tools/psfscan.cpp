@@ -0,0 +1,31 @@
+#include <iostream>
+#include <string>
+
+#include "psfscan.hpp"
+
+
+void print_usage() {
+    std::cout << "Usage: psfscan <psf_file> [<psf_file> ...]" << std::endl;
+    std::cout << "List the properties, types, sweeps and traces of PSF files without reading values." << std::endl;
+    std::cout << "Prints one JSON object per file and line." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        print_usage();
+        return 2;
+    }
+
+    int ans = 0;
+    for (int idx = 1; idx < argc; ++idx) {
+        std::string psf_filename = argv[idx];
+        try {
+            std::cout << psf::scan_psf(psf_filename)->to_json() << std::endl;
+        }
+        catch (std::exception & e) {
+            std::cerr << psf_filename << ": " << e.what() << std::endl;
+            ans = 1;
+        }
+    }
+    return ans;
+}